@@ -9,6 +9,7 @@ import android.os.Bundle;
 import android.os.Vibrator;
 import android.os.VibrationEffect;
 import android.util.Log;
+import android.view.KeyCharacterMap;
 import android.view.KeyEvent;
 import android.view.MotionEvent;
 import android.view.SurfaceHolder;
@@ -22,6 +23,8 @@ import java.io.InputStream;
 import java.io.OutputStream;
 import java.io.FileOutputStream;
 import java.io.File;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
 
 import android.app.AlertDialog;
 import android.app.AlertDialog.Builder;
@@ -45,8 +48,22 @@ public class NativeActivity extends Activity implements SurfaceHolder.Callback
 
     // Kept in cache to avoid micro allocation
     private NativeWrapper.Config mConfig = new NativeWrapper.Config();
-    private NativeWrapper.KeyEvent mKeyEvent = new NativeWrapper.KeyEvent();
-    private NativeWrapper.MotionEvent mMotionEvent = new NativeWrapper.MotionEvent();
+
+    // Input ring shared with native code, keep in sync with src/input_ring.h
+    private static final int INPUT_RING_SIZE = 64 * 1024;
+    private static final int INPUT_RECORD_WRAP = 0;
+    private static final int INPUT_RECORD_KEY = 1;
+    private static final int INPUT_RECORD_MOTION = 2;
+    private static final int INPUT_RECORD_TEXT = 3;
+    private static final int INPUT_MAX_POINTERS = 10;
+    private static final int INPUT_MAX_TEXT_SIZE = 256; // TEXT_EVENT_MAX_SIZE in src/event.h
+    private static final int INPUT_MAX_TEXT_RECORD_SIZE = 8 + INPUT_MAX_TEXT_SIZE;
+    private static final int INPUT_MAX_RECORD_SIZE = Math.max(4 * (5 + 4 * INPUT_MAX_POINTERS), INPUT_MAX_TEXT_RECORD_SIZE);
+
+    private ByteBuffer mInputRing = ByteBuffer.allocateDirect(INPUT_RING_SIZE).order(ByteOrder.nativeOrder());
+    private int mInputWriteOffset;
+    private int mInputBatchSize; // Bytes written since the last doorbell
+    private StringBuilder mInputChar = new StringBuilder(2); // Typed character of a key event
 
     private void copyFile(InputStream in, OutputStream out) throws IOException
     {
@@ -112,8 +129,10 @@ public class NativeActivity extends Activity implements SurfaceHolder.Callback
         mConfig.filesDir = getApplicationContext().getFilesDir().getAbsolutePath();
         mConfig.audioOutputSampleRate = Integer.parseInt(mAudioManager.getProperty(AudioManager.PROPERTY_OUTPUT_SAMPLE_RATE));
         mConfig.audioOutputFramesPerBuffer = Integer.parseInt(mAudioManager.getProperty(AudioManager.PROPERTY_OUTPUT_FRAMES_PER_BUFFER));
+        mConfig.displayRefreshRate = getWindowManager().getDefaultDisplay().getRefreshRate();
         
         mNativeHandle = NativeWrapper.onCreate(this, mConfig);
+        NativeWrapper.setInputBuffer(mNativeHandle, mInputRing);
     }
 
     @Override
@@ -177,34 +196,139 @@ public class NativeActivity extends Activity implements SurfaceHolder.Callback
         NativeWrapper.surfaceDestroyed(mNativeHandle);
     }
 
+    // Returns the offset of a record of `size` bytes, records never straddle the end of the ring
+    private int inputRing_Reserve(int size)
+    {
+        // Native code read everything up to the last doorbell, a batch can use the whole ring minus a wrap
+        // It must not fill it completely though, native code would see an empty ring
+        if (mInputBatchSize + 2 * INPUT_MAX_RECORD_SIZE > INPUT_RING_SIZE)
+            inputRing_Doorbell();
+
+        int remaining = INPUT_RING_SIZE - mInputWriteOffset;
+        if (remaining < size)
+        {
+            if (remaining >= 4)
+                mInputRing.putInt(mInputWriteOffset, INPUT_RECORD_WRAP);
+            mInputBatchSize += remaining;
+            mInputWriteOffset = 0;
+        }
+
+        int offset = mInputWriteOffset;
+        mInputWriteOffset += size;
+        mInputBatchSize += size;
+        return offset;
+    }
+
+    private void inputRing_Doorbell()
+    {
+        NativeWrapper.inputDoorbell(mNativeHandle, mInputWriteOffset);
+        mInputBatchSize = 0;
+    }
+
+    private void inputRing_WriteMotion(int action, int pointerCount, MotionEvent event, int historyIndex)
+    {
+        int size = 4 * (5 + 4 * pointerCount);
+        int offset = inputRing_Reserve(size);
+        long eventTime = historyIndex < 0 ? event.getEventTime() : event.getHistoricalEventTime(historyIndex);
+        mInputRing.putInt(offset, INPUT_RECORD_MOTION | (size << 16));
+        mInputRing.putInt(offset + 4, action);
+        mInputRing.putInt(offset + 8, pointerCount);
+        mInputRing.putLong(offset + 12, eventTime * 1000000L); // uptimeMillis() is CLOCK_MONOTONIC
+        for (int i = 0; i < pointerCount; ++i)
+        {
+            float x = historyIndex < 0 ? event.getX(i) : event.getHistoricalX(i, historyIndex);
+            float y = historyIndex < 0 ? event.getY(i) : event.getHistoricalY(i, historyIndex);
+            float pressure = historyIndex < 0 ? event.getPressure(i) : event.getHistoricalPressure(i, historyIndex);
+            mInputRing.putInt(offset + 20 + 4 * i, event.getPointerId(i));
+            mInputRing.putFloat(offset + 20 + 4 * (pointerCount + i), x);
+            mInputRing.putFloat(offset + 20 + 4 * (2 * pointerCount + i), y);
+            mInputRing.putFloat(offset + 20 + 4 * (3 * pointerCount + i), pressure);
+        }
+    }
+
+    // UTF-8 encoded in place, text longer than INPUT_MAX_TEXT_SIZE bytes is split between code points
+    private void inputRing_WriteText(CharSequence text)
+    {
+        int length = text.length();
+        int i = 0;
+        while (i < length)
+        {
+            // Reserved for the biggest record, then shrunk to the bytes actually written
+            int offset = inputRing_Reserve(INPUT_MAX_TEXT_RECORD_SIZE);
+            int bytes = offset + 8;
+            int textSize = 0;
+            while (i < length)
+            {
+                int c = Character.codePointAt(text, i);
+                int n = c < 0x80 ? 1 : c < 0x800 ? 2 : c < 0x10000 ? 3 : 4;
+                if (textSize + n > INPUT_MAX_TEXT_SIZE)
+                    break;
+
+                if (n == 1)
+                    mInputRing.put(bytes + textSize, (byte)c);
+                else
+                {
+                    mInputRing.put(bytes + textSize, (byte)((0xF00 >> n) | (c >> (6 * (n - 1)))));
+                    for (int k = 1; k < n; ++k)
+                        mInputRing.put(bytes + textSize + k, (byte)(0x80 | ((c >> (6 * (n - 1 - k))) & 0x3F)));
+                }
+                textSize += n;
+                i += Character.charCount(c);
+            }
+
+            int size = 8 + ((textSize + 3) & ~3);
+            mInputRing.putInt(offset, INPUT_RECORD_TEXT | (size << 16));
+            mInputRing.putInt(offset + 4, textSize);
+            mInputWriteOffset = offset + size;
+            mInputBatchSize -= INPUT_MAX_TEXT_RECORD_SIZE - size;
+        }
+    }
+
     @Override
     public boolean dispatchKeyEvent(KeyEvent event)
     {
         int keyCode = event.getKeyCode();
         int action = event.getAction();
 
+        // Text committed by the IME without an InputConnection, or pasted: the whole string in one record
+        if (action == KeyEvent.ACTION_MULTIPLE && keyCode == KeyEvent.KEYCODE_UNKNOWN)
+        {
+            inputRing_WriteText(event.getCharacters());
+            inputRing_Doorbell();
+            return super.dispatchKeyEvent(event);
+        }
+
         int unicodeChar = 0;
-        if (event.getAction() == KeyEvent.ACTION_DOWN)
+        if (action == KeyEvent.ACTION_DOWN)
             unicodeChar = event.getUnicodeChar(event.getMetaState());
 
-        // Hack to get at least some special characters
-        else if (event.getAction() == KeyEvent.ACTION_MULTIPLE && keyCode == 0)
-            unicodeChar = event.getCharacters().charAt(0);
-
-        mKeyEvent.action = action;
-        mKeyEvent.keyCode = keyCode;
-        mKeyEvent.scanCode = event.getScanCode();
-        mKeyEvent.unicodeChar = unicodeChar;
-        mKeyEvent.metaState = event.getMetaState();
+        int size = 4 * 6;
+        int offset = inputRing_Reserve(size);
+        mInputRing.putInt(offset, INPUT_RECORD_KEY | (size << 16));
+        mInputRing.putInt(offset + 4, action);
+        mInputRing.putInt(offset + 8, keyCode);
+        mInputRing.putInt(offset + 12, event.getScanCode());
+        mInputRing.putInt(offset + 16, unicodeChar);
+        mInputRing.putInt(offset + 20, event.getMetaState());
+
+        // Typed characters go through text records too, dead keys are dropped
+        if (unicodeChar != 0 && (unicodeChar & KeyCharacterMap.COMBINING_ACCENT) == 0)
+        {
+            mInputChar.setLength(0);
+            mInputChar.appendCodePoint(unicodeChar);
+            inputRing_WriteText(mInputChar);
+        }
+        inputRing_Doorbell();
 
-        return NativeWrapper.dispatchKeyEvent(mNativeHandle, mKeyEvent) || super.dispatchKeyEvent(event);
+        // Events are handled asynchronously by native code, the system keeps its default handling
+        return super.dispatchKeyEvent(event);
     }
     
     @Override
     public boolean dispatchTouchEvent(MotionEvent event)
     {
-        int x = (int)event.getRawX();
-        int y = (int)event.getRawY();
+        float x = event.getRawX();
+        float y = event.getRawY();
         int action = event.getAction();
 
         // Hack to correct location when view is not fullscreen...
@@ -216,15 +340,14 @@ public class NativeActivity extends Activity implements SurfaceHolder.Callback
             event.setLocation(x - offsets[0], y - offsets[1]);
         }
 
-        mMotionEvent.action = action;
-        mMotionEvent.pointerCount = event.getPointerCount();
-        for (int i = 0; i < mMotionEvent.pointerCount; ++i)
-        {
-            mMotionEvent.x[i] = (int)event.getX(i);
-            mMotionEvent.y[i] = (int)event.getY(i);
-        }
+        // Samples batched by the system since the last event first, native code merges them back into one event
+        int pointerCount = Math.min(event.getPointerCount(), INPUT_MAX_POINTERS);
+        for (int h = 0; h < event.getHistorySize(); ++h)
+            inputRing_WriteMotion(MotionEvent.ACTION_MOVE, pointerCount, event, h);
+        inputRing_WriteMotion(action, pointerCount, event, -1);
+        inputRing_Doorbell();
 
-        return NativeWrapper.dispatchTouchEvent(mNativeHandle, mMotionEvent) || super.dispatchTouchEvent(event);
+        return true;
     }
 
     public void showSoftInput()
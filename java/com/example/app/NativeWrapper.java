@@ -1,10 +1,12 @@
 package com.example.app;
 import android.app.Activity;
 import android.view.Surface;
+import java.nio.ByteBuffer;
+import dalvik.annotation.optimization.FastNative;
 //import android.view.KeyEvent;
 //import android.view.MotionEvent;
 
-// Wrapper for native library
+// Wrapper for native library, bound by RegisterNatives() in JNI_OnLoad() (see src/activity.c)
 public class NativeWrapper
 {
     static public class Config
@@ -12,6 +14,7 @@ public class NativeWrapper
         String filesDir;
         int audioOutputSampleRate;
         int audioOutputFramesPerBuffer;
+        float displayRefreshRate;
     }
 
     // Activity lifecycle
@@ -23,31 +26,10 @@ public class NativeWrapper
     public static native void onPause(long handle);
     public static native void onWindowFocusChanged(long handle, boolean hasFocus);
 
-    static public class KeyEvent
-    {
-        int action;
-        int keyCode;
-        int scanCode;
-        int unicodeChar;
-        int metaState;
-    }
-
-    static public class MotionEvent
-    {
-        MotionEvent()
-        {
-            x = new int[10];
-            y = new int[10];
-        }
-        int action;
-        int pointerCount;
-        int x[];
-        int y[];
-    }
-
-    // Input
-    public static native boolean dispatchKeyEvent(long handle, KeyEvent keyEvent);
-    public static native boolean dispatchTouchEvent(long handle, MotionEvent motionEvent);
+    // Input, packed records in a direct ByteBuffer read in place by native code (see src/input_ring.h)
+    public static native void setInputBuffer(long handle, ByteBuffer buffer);
+    @FastNative // No thread state transition from Android 8.0, the native side may still lock and allocate briefly
+    public static native void inputDoorbell(long handle, int writeOffset); // Once per batch of records
     
     // Surface lifecycle
     public static native void surfaceCreated(long handle, Surface s);
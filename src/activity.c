@@ -1,6 +1,6 @@
 
 #include <stdlib.h> // calloc/free
-#include <string.h> // memmove
+#include <string.h> // strncpy
 #include <unistd.h> // chdir
 #include <assert.h> // assert
 
@@ -14,32 +14,39 @@
 
 #define PACKAGE_PATH "com/example/app"
 
+// Simulation and GL submission on two threads, the simulation builds frame N+1 while frame N is rendered
+#define THREADED_RENDERING 0
+
+// Write the events consumed by the app thread to filesDir/events.rec, see tools/replay.c
+#define RECORD_EVENTS 0
+
+// Touches given to the game and ImGui are resampled for when the frame being built reaches the screen, in display refreshes
+#define TOUCH_PRESENT_OFFSET_FRAMES (THREADED_RENDERING ? 2 : 1)
+
+// Frame budget (jank threshold, touch present offset) when the display reports no refresh rate
+#define DEFAULT_REFRESH_RATE 60.f
+
 #include "common.h"
 #include "event.h"
 
+#include "app_event.h"
+#include "event_queue.h"
+#include "event_recording.h"
+#include "frame_pipeline.h"
+#include "gl_state.h"
+#include "input_ring.h"
+#include "platform_queue.h"
+#include "render_queue.h"
+#include "simulation.h"
 #include "sound_device.h"
+#include "telemetry.h"
+#include "timing.h"
 
 #include "game.h"
 
 #include "imgui_test.h"
 
 
-#include <time.h>
-int64_t getNow()
-{
-    static bool init = false;
-    static int64_t startTime = 0;
-    if (!init)
-    {
-        init = true;
-        startTime = getNow();
-    }
-
-    struct timespec t;
-    clock_gettime(CLOCK_MONOTONIC, &t);
-    return ((t.tv_nsec + (t.tv_sec * 1000000000)) / 1000000) - startTime;
-}
-
 typedef struct EGL
 {
     EGLDisplay display;
@@ -48,78 +55,6 @@ typedef struct EGL
     EGLSurface surface;
 } EGL;
 
-typedef enum EventType
-{
-    EventType_Create,
-    EventType_Destroy,
-    EventType_Start,
-    EventType_Stop,
-    EventType_Resume,
-    EventType_Pause,
-    EventType_WindowFocusChanged,
-    EventType_DispatchKeyEvent,
-    EventType_DispatchMotionEvent,
-    EventType_SurfaceCreated,
-    EventType_SurfaceChanged,
-    EventType_SurfaceDestroyed,
-} EventType;
-
-const char* eventTypeStr[] =
-{
-    "Create",
-    "Destroy",
-    "Start",
-    "Stop",
-    "Resume",
-    "Pause",
-    "WindowFocusChanged",
-    "DispatchKeyEvent",
-    "DispatchTouchEvent",
-    "SurfaceCreated",
-    "SurfaceChanged",
-    "SurfaceDestroyed",
-};
-
-typedef struct Config
-{
-    char filesDir[256];
-    int audioOutputSampleRate;
-    int audioOutputFramesPerBuffer;
-} Config;
-
-typedef struct Event
-{
-    EventType type;
-
-    union
-    {
-        struct Create
-        {
-            Config config;
-        } create;
-
-        struct WindowFocusChanged
-        {
-            bool hasFocus;
-        } windowFocusChanged;
-
-        InputEvent dispatchKeyEvent;
-        InputEvent dispatchTouchEvent;
-
-        struct SurfaceCreated
-        {
-            ANativeWindow* nativeWindow;
-        } surfaceCreated;
-
-        struct SurfaceChanged
-        {
-            int format;
-            int width;
-            int height;
-        } surfaceChanged;
-    };
-} Event;
-
 typedef struct NativeActivityProto
 {
     jclass clazz;
@@ -135,32 +70,12 @@ typedef struct ConfigProto
     jfieldID filesDir;
     jfieldID audioOutputSampleRate;
     jfieldID audioOutputFramesPerBuffer;
+    jfieldID displayRefreshRate;
 } ConfigProto;
 
-typedef struct KeyEventProto
-{
-    jclass clazz;
-    jfieldID action;
-    jfieldID keyCode;
-    jfieldID scanCode;
-    jfieldID unicodeChar;
-    jfieldID metaState;
-} KeyEventProto;
-
-typedef struct MotionEventProto
-{
-    jclass clazz;
-    jfieldID action;
-    jfieldID pointerCount;
-    jfieldID x;
-    jfieldID y;
-} MotionEventProto;
-
 typedef struct JavaClasses
 {
     NativeActivityProto nativeActivity;
-    KeyEventProto keyEvent;
-    MotionEventProto motionEvent;
     ConfigProto config;
 } JavaClasses;
 
@@ -172,25 +87,52 @@ typedef struct AppThread
     JavaClasses javaClasses;
 
     ANativeWindow* nativeWindow;
+    Config config;
+
+    InputRing inputRing; // UI thread only, shared with NativeActivity.java
 
-    // Simplest fifo using a static array (memmove to pop event)
-    Event events[64];
-    int eventCount;
-    pthread_mutex_t mutex;
-    pthread_cond_t eventAddedCond;
-    pthread_cond_t allEventsProcessed;
+    // Written by the Java UI thread only, read by the app thread only
+    EventQueue* eventQueue;
+    PlatformQueue* platformQueue; // Written by the app thread only, executed on the UI thread
+    EventRecorder* eventRecorder; // App thread only, NULL unless RECORD_EVENTS
+
+    // Completion of synchronous events, the UI thread waits for its own event only
+    uint16_t lastFence;       // UI thread only
+    uint16_t completedFence;  // Protected by fenceMutex
+    pthread_mutex_t fenceMutex;
+    pthread_cond_t fenceCond;
+    int64_t maxBlockedTime[EventType_Count]; // In ns, UI thread only
 } AppThread;
 
+// Immutable once submitted, rendered while the next one is filled (see frame_pipeline.h)
+typedef struct FramePacket
+{
+    GameFrame game;
+    ImGuiTestFrame* imgui;
+    int swapInterval; // -1 to keep the current one
+    uint64_t frameIndex; // For time_MarkPhase()
+    int64_t inputTime;   // Oldest input handled for this frame, 0 if none
+} FramePacket;
+
 typedef struct App
 {
     bool activityPaused;
     bool canRender;
 
+    // Only touched by the GL thread once the pipeline is created
     EGL egl;
+    ANativeWindow* nativeWindow;
+    RenderQueue renderQueue;
+
+    FramePipeline* framePipeline;
+    FramePacket framePackets[FRAME_PIPELINE_PACKET_COUNT];
+    int swapInterval; // Applied by the next packet, -1 if unchanged
+    int renderSwapInterval; // Render side, the one currently set
+    int64_t inputTime;      // Oldest input handled since the last packet, 0 if none
 
+    Simulation sim; // Shared with tools/replay.c
+    TelemetrySnapshot* pauseTelemetry; // Taken on pause, logged and saved once the UI thread stopped waiting
     sound_device_t* soundDevice;
-    Game* game;
-    GameInputs gameInputs;
     ImGuiTest* imguiTest;
 } App;
 
@@ -350,71 +292,51 @@ static void nativeActivity_Vibrate(JNIEnv* env, const NativeActivityProto* proto
     (*env)->CallVoidMethod(env, proto->object, proto->vibrate, effectId);
 }
 
-static void nativeActivity_Register(JNIEnv* env, NativeActivityProto* proto)
+// A missing class or member fails the library load instead of crashing on first use
+static bool jni_Check(JNIEnv* env, const void* id, const char* name)
 {
-    assert(proto->object);
-    proto->clazz = (*env)->GetObjectClass(env, proto->object);
-    proto->showSoftInput = (*env)->GetMethodID(env, proto->clazz, "showSoftInput", "()V");
-    proto->hideSoftInput = (*env)->GetMethodID(env, proto->clazz, "hideSoftInput", "()V");
-    proto->vibrate = (*env)->GetMethodID(env, proto->clazz, "vibrate", "(I)V");
-}
+    if (id)
+        return true;
 
-static void keyEvent_Register(JNIEnv* env, KeyEventProto* proto)
-{
-    proto->clazz = (*env)->FindClass(env, PACKAGE_PATH "/NativeWrapper$KeyEvent");
-    proto->action = (*env)->GetFieldID(env, proto->clazz, "action", "I");
-    proto->keyCode = (*env)->GetFieldID(env, proto->clazz, "keyCode", "I");
-    proto->scanCode = (*env)->GetFieldID(env, proto->clazz, "scanCode", "I");
-    proto->unicodeChar = (*env)->GetFieldID(env, proto->clazz, "unicodeChar", "I");
-    proto->metaState = (*env)->GetFieldID(env, proto->clazz, "metaState", "I");
+    (*env)->ExceptionClear(env);
+    ALOGE("JNI lookup failed: %s", name);
+    return false;
 }
 
-static InputEvent keyEvent_FromJava(JNIEnv* env, KeyEventProto* proto, jobject object)
+static bool nativeActivity_Register(JNIEnv* env, NativeActivityProto* proto)
 {
-    InputEvent event = { AINPUT_EVENT_TYPE_KEY };
-    event.keyEvent.action = (*env)->GetIntField(env, object, proto->action);
-    event.keyEvent.keyCode = (*env)->GetIntField(env, object, proto->keyCode);
-    event.keyEvent.scanCode = (*env)->GetIntField(env, object, proto->scanCode);
-    event.keyEvent.unicodeChar = (*env)->GetIntField(env, object, proto->unicodeChar);
-    event.keyEvent.metaState = (*env)->GetIntField(env, object, proto->metaState);
-    return event;
-}
+    jclass clazz = (*env)->FindClass(env, PACKAGE_PATH "/NativeActivity");
+    if (!jni_Check(env, clazz, PACKAGE_PATH "/NativeActivity"))
+        return false;
 
-static void motionEvent_Register(JNIEnv* env, MotionEventProto* proto)
-{
-    proto->clazz = (*env)->FindClass(env, PACKAGE_PATH "/NativeWrapper$MotionEvent");
-    proto->action = (*env)->GetFieldID(env, proto->clazz, "action", "I");
-    proto->pointerCount = (*env)->GetFieldID(env, proto->clazz, "pointerCount", "I");
-    proto->x = (*env)->GetFieldID(env, proto->clazz, "x", "[I");
-    proto->y = (*env)->GetFieldID(env, proto->clazz, "y", "[I");
-}
+    proto->clazz = (*env)->NewGlobalRef(env, clazz);
+    (*env)->DeleteLocalRef(env, clazz);
+    proto->showSoftInput = (*env)->GetMethodID(env, proto->clazz, "showSoftInput", "()V");
+    proto->hideSoftInput = (*env)->GetMethodID(env, proto->clazz, "hideSoftInput", "()V");
+    proto->vibrate = (*env)->GetMethodID(env, proto->clazz, "vibrate", "(I)V");
 
-static void jni_FillIntArray(int* dst, int size, JNIEnv* env, jobject object, jfieldID field)
-{
-    jintArray intArrJava = (*env)->GetObjectField(env, object, field);
-    int* intArrNative = (*env)->GetIntArrayElements(env, intArrJava, NULL);
-    memcpy(dst, intArrNative, size * sizeof(int));
-    (*env)->ReleaseIntArrayElements(env, intArrJava, intArrNative, 0);
+    return jni_Check(env, proto->showSoftInput, "NativeActivity.showSoftInput")
+        && jni_Check(env, proto->hideSoftInput, "NativeActivity.hideSoftInput")
+        && jni_Check(env, proto->vibrate, "NativeActivity.vibrate");
 }
 
-static InputEvent motionEvent_FromJava(JNIEnv* env, MotionEventProto* proto, jobject object)
+static bool config_Register(JNIEnv* env, ConfigProto* proto)
 {
-    InputEvent event = { AINPUT_EVENT_TYPE_MOTION };
+    jclass clazz = (*env)->FindClass(env, PACKAGE_PATH "/NativeWrapper$Config");
+    if (!jni_Check(env, clazz, PACKAGE_PATH "/NativeWrapper$Config"))
+        return false;
 
-    event.motionEvent.pointerCount = (*env)->GetIntField(env, object, proto->pointerCount);
-    jni_FillIntArray(event.motionEvent.x, event.motionEvent.pointerCount, env, object, proto->x);
-    jni_FillIntArray(event.motionEvent.y, event.motionEvent.pointerCount, env, object, proto->y);
-    event.motionEvent.action = (*env)->GetIntField(env, object, proto->action);
-
-    return event;
-}
-
-static void config_Register(JNIEnv* env, ConfigProto* proto)
-{
-    proto->clazz = (*env)->FindClass(env, PACKAGE_PATH "/NativeWrapper$Config");
+    proto->clazz = (*env)->NewGlobalRef(env, clazz);
+    (*env)->DeleteLocalRef(env, clazz);
     proto->filesDir = (*env)->GetFieldID(env, proto->clazz, "filesDir", "Ljava/lang/String;");
     proto->audioOutputSampleRate = (*env)->GetFieldID(env, proto->clazz, "audioOutputSampleRate", "I");
     proto->audioOutputFramesPerBuffer = (*env)->GetFieldID(env, proto->clazz, "audioOutputFramesPerBuffer", "I");
+    proto->displayRefreshRate = (*env)->GetFieldID(env, proto->clazz, "displayRefreshRate", "F");
+
+    return jni_Check(env, proto->filesDir, "NativeWrapper$Config.filesDir")
+        && jni_Check(env, proto->audioOutputSampleRate, "NativeWrapper$Config.audioOutputSampleRate")
+        && jni_Check(env, proto->audioOutputFramesPerBuffer, "NativeWrapper$Config.audioOutputFramesPerBuffer")
+        && jni_Check(env, proto->displayRefreshRate, "NativeWrapper$Config.displayRefreshRate");
 }
 
 static Config config_FromJava(JNIEnv* env, ConfigProto* proto, jobject object)
@@ -428,71 +350,202 @@ static Config config_FromJava(JNIEnv* env, ConfigProto* proto, jobject object)
 
     config.audioOutputSampleRate = (*env)->GetIntField(env, object, proto->audioOutputSampleRate);
     config.audioOutputFramesPerBuffer = (*env)->GetIntField(env, object, proto->audioOutputFramesPerBuffer);
+    config.displayRefreshRate = (*env)->GetFloatField(env, object, proto->displayRefreshRate);
 
     return config;
 }
 
-static void javaClasses_Register(JNIEnv* env, JavaClasses* classes)
+// Resolved once in JNI_OnLoad(), copied by each AppThread
+static JavaClasses g_javaClasses;
+
+static bool javaClasses_Register(JNIEnv* env, JavaClasses* classes)
 {
-    nativeActivity_Register(env, &classes->nativeActivity);
-    keyEvent_Register(env, &classes->keyEvent);
-    motionEvent_Register(env, &classes->motionEvent);
-    config_Register(env, &classes->config);
+    return nativeActivity_Register(env, &classes->nativeActivity)
+        && config_Register(env, &classes->config);
 }
 
-static bool appThread_PollEvent(AppThread* appThread, Event* event, bool waitForEvent)
+// UI thread, posted by the app thread through platformQueue_Post()
+static void appThread_ExecutePlatformCommand(const PlatformCommand* command, void* userData)
 {
-    pthread_mutex_lock(&appThread->mutex);
-    //ALOGV("appThread_PollEvent() %d (count=%d)", waitForEvent, appThread->eventCount);
+    AppThread* appThread = userData;
+    const NativeActivityProto* proto = &appThread->javaClasses.nativeActivity;
 
-    if (appThread->eventCount == 0)
-        pthread_cond_signal(&appThread->allEventsProcessed);
+    JNIEnv* env;
+    (*appThread->javaVM)->GetEnv(appThread->javaVM, (void**)&env, JNI_VERSION_1_6);
 
-    while (appThread->eventCount == 0 && waitForEvent)
-        pthread_cond_wait(&appThread->eventAddedCond, &appThread->mutex);
-
-    bool result = false;
-    if (appThread->eventCount > 0)
+    switch (command->type)
     {
-        // Pop front event
-        *event = appThread->events[0];
-        appThread->eventCount--;
-        if (appThread->eventCount > 0)
-            memmove(appThread->events, appThread->events + 1, appThread->eventCount * sizeof(Event));
+        case PlatformCommandType_ShowSoftInput:
+            nativeActivity_ShowSoftInput(env, proto);
+            break;
+        case PlatformCommandType_HideSoftInput:
+            nativeActivity_HideSoftInput(env, proto);
+            break;
+        case PlatformCommandType_Vibrate:
+            nativeActivity_Vibrate(env, proto, command->vibrate.effectId);
+            break;
+        default:
+            assert(false);
+    }
+}
 
-        result = true;
+static bool appThread_PollEvent(AppThread* appThread, Event* event, bool waitForEvent)
+{
+    uint32_t size;
+    const void* record;
+    while ((record = eventQueue_Peek(appThread->eventQueue, &size)) == NULL)
+    {
+        if (!waitForEvent)
+            return false;
+        eventQueue_Wait(appThread->eventQueue);
     }
 
-    pthread_mutex_unlock(&appThread->mutex);
-    return result;
+    if (appThread->eventRecorder)
+        eventRecorder_AddEvent(appThread->eventRecorder, time_Now(), record, size);
+
+    event_Decode(event, record);
+    eventQueue_Release(appThread->eventQueue);
+    return true;
+}
+
+// Called by the app thread once an event is handled
+static void appThread_SignalFence(AppThread* appThread, uint16_t fence)
+{
+    if (fence == 0)
+        return;
+
+    pthread_mutex_lock(&appThread->fenceMutex);
+    appThread->completedFence = fence;
+    pthread_cond_broadcast(&appThread->fenceCond);
+    pthread_mutex_unlock(&appThread->fenceMutex);
+}
+
+// Events are handled in order, a fence is reached once completedFence caught up with it (wrap safe)
+static void appThread_WaitFence(AppThread* appThread, uint16_t fence)
+{
+    pthread_mutex_lock(&appThread->fenceMutex);
+    while ((int16_t)(appThread->completedFence - fence) < 0)
+        pthread_cond_wait(&appThread->fenceCond, &appThread->fenceMutex);
+    pthread_mutex_unlock(&appThread->fenceMutex);
 }
 
-static void appThread_AddEvent(AppThread* appThread, Event event, bool synchronous)
+// A synchronous event only waits for itself to be handled, not for the queue to be drained
+static void appThread_AddEvent(AppThread* appThread, const Event* event, bool synchronous)
 {
-    pthread_mutex_lock(&appThread->mutex);
-    //ALOGV("appThread_AddEvent() %s (count=%d)", eventTypeStr[event.type], appThread->eventCount);
+    //ALOGV("appThread_AddEvent() %s", eventTypeStr[event->type]);
 
-    if (appThread->eventCount == ARRAYSIZE(appThread->events))
+    Event fencedEvent;
+    if (synchronous)
     {
-        ALOGE("appThread_AddEvent() MAX_EVENT_COUNT reached");
+        fencedEvent = *event;
+        fencedEvent.fence = ++appThread->lastFence;
+        if (fencedEvent.fence == 0)
+            fencedEvent.fence = ++appThread->lastFence;
+        event = &fencedEvent;
     }
-    else
+
+    int64_t startTime = time_Now();
+
+    unsigned char record[EVENT_MAX_ENCODED_SIZE];
+    uint32_t size = event_Encode(event, record);
+    if (!eventQueue_Push(appThread->eventQueue, record, size))
+        ALOGE("appThread_AddEvent() %s dropped", eventTypeStr[event->type]);
+
+    if (synchronous)
+    {
+        appThread_WaitFence(appThread, event->fence);
+
+        int64_t blockedTime = time_Now() - startTime;
+        int64_t* maxBlockedTime = &appThread->maxBlockedTime[event->type];
+        if (blockedTime > *maxBlockedTime)
+            *maxBlockedTime = blockedTime;
+        ALOGV("%s blocked the UI thread %.3f ms (max %.3f ms)", eventTypeStr[event->type],
+            time_ToMs(blockedTime), time_ToMs(*maxBlockedTime));
+    }
+}
+
+/*
+================================================================================
+GL thread
+================================================================================
+*/
+
+// Everything touching EGL/GL goes through the frame pipeline, see framePipeline_Run()
+
+static void app_BindSurfaceGL(void* userData)
+{
+    App* app = userData;
+    bool onContextCreation = (app->egl.context == NULL);
+    egl_MakeCurrent(&app->egl, app->nativeWindow);
+
+    if (onContextCreation)
     {
-        appThread->events[appThread->eventCount++] = event;
-        pthread_cond_signal(&appThread->eventAddedCond);
+        glState_Reset(); // Fresh context, the first make current also set its viewport
+        renderQueue_Init(&app->renderQueue);
+        game_LoadGPUData(app->sim.game);
+        test_LoadGPUData(app->imguiTest);
     }
+}
 
-    while (appThread->eventCount != 0 && synchronous)
-        pthread_cond_wait(&appThread->allEventsProcessed, &appThread->mutex);
+static void app_UnbindSurfaceGL(void* userData)
+{
+    App* app = userData;
+    egl_DestroyAndUnbindSurface(&app->egl);
+}
 
-    pthread_mutex_unlock(&appThread->mutex);
+static void app_TerminateGL(void* userData)
+{
+    App* app = userData;
+    game_UnloadGPUData(app->sim.game);
+    test_UnloadGPUData(app->imguiTest);
+    renderQueue_Free(&app->renderQueue);
+    eglTerminate(app->egl.display);
+}
+
+static void app_DrawImGui(void* userData, const void* data)
+{
+    App* app = userData;
+    test_Draw(app->imguiTest, data);
+}
+
+static void app_RenderFrame(void* packetPtr, void* userData)
+{
+    App* app = userData;
+    const FramePacket* packet = packetPtr;
+
+    if (packet->swapInterval >= 0)
+    {
+        eglSwapInterval(app->egl.display, packet->swapInterval);
+        app->renderSwapInterval = packet->swapInterval;
+    }
+
+    glClearColor(0.2f, 0.2f, 0.2f, 1.f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    game_Draw(app->sim.game, &packet->game, &app->renderQueue);
+    RenderPacket* imguiPacket = renderQueue_Append(&app->renderQueue, renderKey_Make(RenderPass_UI, 0, 0, 0.f));
+    imguiPacket->callback = app_DrawImGui;
+    imguiPacket->userData = app;
+    imguiPacket->data = packet->imgui;
+    renderQueue_Submit(&app->renderQueue);
+
+#if GL_STATE_VERIFY
+    glState_Verify();
+#endif
+    eglSwapBuffers(app->egl.display, app->egl.surface);
+    time_MarkPhase(packet->frameIndex, FramePhase_Swap);
+
+    // Until the swap returned, the frame showing the effect of the input is not queued for display yet
+    if (packet->inputTime)
+        telemetry_RecordLatency(app->sim.telemetry, time_Now() - packet->inputTime, app->renderSwapInterval != 0);
 }
 
 static bool filterLogEvents(EventType type)
 {
     return true;
     return type == EventType_DispatchKeyEvent
-        || type == EventType_DispatchMotionEvent;
+        || type == EventType_DispatchMotionEvent
+        || type == EventType_CommitText;
 }
 
 #include <math.h>
@@ -533,8 +586,7 @@ static bool appThread_HandleEvents(AppThread* appThread, App* app)
         {
             case EventType_Create:
                 
-                app->soundDevice = SoundDevice_Create(event.create.config.audioOutputFramesPerBuffer, event.create.config.audioOutputSampleRate);
-                app->game = game_Init();
+                app->soundDevice = SoundDevice_Create(event.create.config->audioOutputFramesPerBuffer, event.create.config->audioOutputSampleRate);
                 app->imguiTest = test_Init();
 
                 SoundDevice_SetCallback(app->soundDevice, SoundCallback, NULL);
@@ -542,13 +594,12 @@ static bool appThread_HandleEvents(AppThread* appThread, App* app)
                 break;
 
             case EventType_Destroy:
-                game_UnloadGPUData(app->game);
-                test_UnloadGPUData(app->imguiTest);
-                eglTerminate(app->egl.display);
+                framePipeline_Run(app->framePipeline, app_TerminateGL, app);
 
                 test_Terminate(app->imguiTest);
-                game_Terminate(app->game);
                 SoundDevice_Destroy(app->soundDevice);
+                simulation_HandleEvent(&app->sim, &event);
+                appThread_SignalFence(appThread, event.fence);
                 return false;
 
             case EventType_Start:
@@ -558,27 +609,17 @@ static bool appThread_HandleEvents(AppThread* appThread, App* app)
                 break;
 
             case EventType_SurfaceCreated:
-                {
-                    bool onContextCreation = (app->egl.context == NULL);
-                    egl_MakeCurrent(&app->egl, event.surfaceCreated.nativeWindow);
-
-                    if (onContextCreation)
-                    {
-                        game_LoadGPUData(app->game);
-                        test_LoadGPUData(app->imguiTest);
-                    }
-                }
+                app->nativeWindow = event.surfaceCreated.nativeWindow;
+                framePipeline_Run(app->framePipeline, app_BindSurfaceGL, app);
                 break;
 
             case EventType_SurfaceChanged:
-                app->gameInputs.displayWidth = event.surfaceChanged.width;
-                app->gameInputs.displayHeight = event.surfaceChanged.height;
                 test_SizeChanged(event.surfaceChanged.width, event.surfaceChanged.height);
                 app->canRender = true;
                 break;
 
             case EventType_SurfaceDestroyed:
-                egl_DestroyAndUnbindSurface(&app->egl);
+                framePipeline_Run(app->framePipeline, app_UnbindSurfaceGL, app);
                 app->canRender = false;
                 break;
 
@@ -590,6 +631,7 @@ static bool appThread_HandleEvents(AppThread* appThread, App* app)
             case EventType_Pause:
                 app->activityPaused = true;
                 SoundDevice_Pause(app->soundDevice);
+                telemetry_TakeSnapshot(app->sim.telemetry, app->pauseTelemetry);
                 break;
 
             case EventType_WindowFocusChanged:
@@ -597,29 +639,43 @@ static bool appThread_HandleEvents(AppThread* appThread, App* app)
 
             case EventType_DispatchKeyEvent:
                 test_HandleEvent(app->imguiTest, &event.dispatchKeyEvent);
-                if (event.dispatchKeyEvent.keyEvent.unicodeChar != 0)
-                    test_InputUnicodeChar(app->imguiTest, event.dispatchKeyEvent.keyEvent.unicodeChar);
+                break;
+
+            case EventType_CommitText:
+                test_InputText(app->imguiTest, event.commitText.textEvent.utf8);
                 break;
 
             case EventType_DispatchMotionEvent:
 
                 if (event.dispatchTouchEvent.type == AINPUT_EVENT_TYPE_MOTION)
                 test_HandleEvent(app->imguiTest, &event.dispatchTouchEvent);
-                app->gameInputs.touchX = event.dispatchTouchEvent.motionEvent.x[0];
-                app->gameInputs.touchY = event.dispatchTouchEvent.motionEvent.y[0];
+                if (app->inputTime == 0 || event.dispatchTouchEvent.motionEvent.receivedTime < app->inputTime)
+                    app->inputTime = event.dispatchTouchEvent.motionEvent.receivedTime;
 
                 if (test_GetIO(app->imguiTest)->disableVSYNCOnMotion)
                 {
                     if (event.dispatchTouchEvent.motionEvent.action == AMOTION_EVENT_ACTION_DOWN)
-                        eglSwapInterval(app->egl.display, 0);
+                        app->swapInterval = 0;
                     if (event.dispatchTouchEvent.motionEvent.action == AMOTION_EVENT_ACTION_UP)
-                        eglSwapInterval(app->egl.display, 1);
+                        app->swapInterval = 1;
                 }
 
                 //ALOGV("Touch pressed: %d %d %d", event.dispatchTouchEvent.motionEvent.x, event.dispatchTouchEvent.motionEvent.y, event.dispatchTouchEvent.motionEvent.action);
                 break;
             default:;
         }
+
+        simulation_HandleEvent(&app->sim, &event);
+        appThread_SignalFence(appThread, event.fence);
+
+        // Storage I/O once the UI thread no longer waits for the event
+        if (event.type == EventType_Pause)
+        {
+            telemetry_LogSnapshot(app->pauseTelemetry);
+            telemetry_SaveSnapshot(app->pauseTelemetry, "telemetry.bin"); // In filesDir, the working directory
+        }
+        if (appThread->eventRecorder && (event.type == EventType_Pause || event.type == EventType_Stop))
+            eventRecorder_Flush(appThread->eventRecorder); // The tail of the session survives the process being killed
     }
 
     return true;
@@ -634,37 +690,100 @@ static void* appThread_Func(void* arg)
     (*appThread->javaVM)->AttachCurrentThread(appThread->javaVM, &appThread->jniEnv, NULL);
 
     App* app = calloc(1, sizeof(App));
-    int frameIndex = 0;
 
-    while (appThread_HandleEvents(appThread, app))
+    if (RECORD_EVENTS)
+        appThread->eventRecorder = eventRecorder_Create("events.rec"); // In filesDir, the working directory
+
+    app->swapInterval = -1;
+    app->renderSwapInterval = 1; // EGL default
+    FramePipelineDesc pipelineDesc = {
+        .threaded = THREADED_RENDERING,
+        .render = app_RenderFrame,
+        .userData = app,
+    };
+    for (int i = 0; i < FRAME_PIPELINE_PACKET_COUNT; ++i)
+    {
+        app->framePackets[i].imgui = test_CreateFrame();
+        pipelineDesc.packets[i] = &app->framePackets[i];
+    }
+    app->framePipeline = framePipeline_Create(&pipelineDesc);
+
+    // One display refresh per frame, 90 and 120 Hz panels have a tighter budget
+    float refreshRate = appThread->config.displayRefreshRate > 0.f ? appThread->config.displayRefreshRate : DEFAULT_REFRESH_RATE;
+    int64_t framePeriodNs = (int64_t)(TIME_NS_PER_SECOND / refreshRate);
+    ALOGV("Display refresh rate %.1f Hz", refreshRate);
+
+    simulation_Init(&app->sim, &(SimulationDesc){
+        .framePeriodNs = framePeriodNs,
+        .presentOffsetNs = TOUCH_PRESENT_OFFSET_FRAMES * framePeriodNs,
+        .touchLatencyNs = 5 * TIME_NS_PER_MS,
+    });
+    app->pauseTelemetry = malloc(sizeof(TelemetrySnapshot));
+
+    for (;;)
     {
+        uint64_t frameIndex = time_BeginFrame();
+        simulation_BeginFrame(&app->sim);
+        if (!appThread_HandleEvents(appThread, app))
+            break;
+        time_MarkPhase(frameIndex, FramePhase_Poll);
+
+        FramePacket* packet = framePipeline_AcquirePacket(app->framePipeline);
+
+        // The frame that last used this packet is fully rendered
+        FrameTimestamps timestamps;
+        if (frameIndex > FRAME_PIPELINE_PACKET_COUNT && time_GetFrame(frameIndex - FRAME_PIPELINE_PACKET_COUNT, &timestamps)
+            && timestamps.phases[FramePhase_Swap] != 0)
+        {
+            telemetry_Record(app->sim.telemetry, &timestamps);
+        }
+
         // update
-        app->gameInputs.deltaTime = 1.f / 60.f;
-        game_Update(app->game, &app->gameInputs);
+        simulation_Update(&app->sim, &packet->game);
+        if (appThread->eventRecorder)
+            eventRecorder_AddFrame(appThread->eventRecorder, app->sim.frameClock.lastTime);
+        time_MarkPhase(frameIndex, FramePhase_Update);
 
         assert(app->imguiTest);
         {
             ImGuiTestIO* io = test_GetIO(app->imguiTest);
             
-            test_UpdateAndDraw(app->imguiTest);
+            test_SetTouches(app->imguiTest, &app->sim.gameInputs.touches);
+            test_Update(app->imguiTest, packet->imgui);
+            time_MarkPhase(frameIndex, FramePhase_ImGui);
             if (io->showKeyboard)
             {
-                nativeActivity_Vibrate(appThread->jniEnv, &appThread->javaClasses.nativeActivity, 2);
-                nativeActivity_ShowSoftInput(appThread->jniEnv, &appThread->javaClasses.nativeActivity);
+                platformQueue_Post(appThread->platformQueue, &(PlatformCommand){
+                    .type = PlatformCommandType_Vibrate,
+                    .vibrate = { 2 } // VibrationEffect.EFFECT_TICK
+                });
+                platformQueue_Post(appThread->platformQueue, &(PlatformCommand){ PlatformCommandType_ShowSoftInput });
             }
             if (io->hideKeyboard)
             {
-                nativeActivity_HideSoftInput(appThread->jniEnv, &appThread->javaClasses.nativeActivity);
-            }    
+                platformQueue_Post(appThread->platformQueue, &(PlatformCommand){ PlatformCommandType_HideSoftInput });
+            }
         }
 
-        eglSwapBuffers(app->egl.display, app->egl.surface);
-        
-        frameIndex++;
+        packet->swapInterval = app->swapInterval;
+        packet->frameIndex = frameIndex;
+        packet->inputTime = app->inputTime;
+        app->inputTime = 0;
+        app->swapInterval = -1;
 
-        // We should try to render everything that is not related to input before polling inputs
-        glClearColor(0.2f, 0.2f, 0.2f, 1.f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        // Threaded: returns as soon as the render thread took the packet, inputs are polled while it renders
+        framePipeline_Submit(app->framePipeline);
+    }
+
+    framePipeline_Destroy(app->framePipeline);
+    simulation_Terminate(&app->sim);
+    free(app->pauseTelemetry);
+    if (appThread->eventRecorder)
+        eventRecorder_Destroy(appThread->eventRecorder);
+    for (int i = 0; i < FRAME_PIPELINE_PACKET_COUNT; ++i)
+    {
+        test_DestroyFrame(app->framePackets[i].imgui);
+        game_FreeFrame(&app->framePackets[i].game);
     }
 
     (*appThread->javaVM)->DetachCurrentThread(appThread->javaVM);
@@ -680,91 +799,95 @@ Activity lifecycle
 ================================================================================
 */
 
-JNIEXPORT jlong JNICALL
-Java_com_example_app_NativeWrapper_onCreate(JNIEnv* jniEnv, jobject obj, jobject activity, jobject configJava)
+static jlong nativeWrapper_OnCreate(JNIEnv* jniEnv, jclass clazz, jobject activity, jobject configJava)
 {
     ALOGV("NativeWrapper::onCreate()");
 
     AppThread* appThread = calloc(1, sizeof(AppThread));
     (*jniEnv)->GetJavaVM(jniEnv, &appThread->javaVM);
 
+    appThread->javaClasses = g_javaClasses;
     appThread->javaClasses.nativeActivity.object = (*jniEnv)->NewGlobalRef(jniEnv, activity);
-    javaClasses_Register(jniEnv, &appThread->javaClasses);
-
-    Config config = config_FromJava(jniEnv, &appThread->javaClasses.config, configJava);
-
-    ALOGV("chdir to '%s'", config.filesDir);
-    chdir(config.filesDir);
 
-    pthread_mutex_init(&appThread->mutex, NULL);
-    pthread_cond_init(&appThread->eventAddedCond, NULL);
-    pthread_cond_init(&appThread->allEventsProcessed, NULL);
+    appThread->config = config_FromJava(jniEnv, &appThread->javaClasses.config, configJava);
+
+    ALOGV("chdir to '%s'", appThread->config.filesDir);
+    chdir(appThread->config.filesDir);
+
+    appThread->eventQueue = eventQueue_Create(&(EventQueueDesc){
+        .capacity = 4096,
+        .maxElementSize = EVENT_MAX_ENCODED_SIZE,
+        .overflow = EventQueueOverflow_Grow, // Lifecycle events must never be lost
+    });
+    appThread->platformQueue = platformQueue_Create(&(PlatformQueueDesc){
+        .capacity = 64,
+        .execute = appThread_ExecutePlatformCommand,
+        .userData = appThread,
+    });
+    assert(appThread->platformQueue);
+    pthread_mutex_init(&appThread->fenceMutex, NULL);
+    pthread_cond_init(&appThread->fenceCond, NULL);
 
     pthread_create(&appThread->thread, NULL, appThread_Func, appThread);
 
-    appThread_AddEvent(appThread, (Event){ 
+    appThread_AddEvent(appThread, &(Event){ 
         .type = EventType_Create,
-        .create = { config }
+        .create = { &appThread->config }
     }, true);
 
     ALOGV("NativeWrapper::onCreate() ended");
     return (jlong)((size_t)appThread);
 }
 
-JNIEXPORT void JNICALL
-Java_com_example_app_NativeWrapper_onDestroy(JNIEnv* jniEnv, jobject obj, jlong handle)
+static void nativeWrapper_OnDestroy(JNIEnv* jniEnv, jclass clazz, jlong handle)
 {
     ALOGV("NativeWrapper::onDestroy() begin");
 
     AppThread* appThread = (AppThread*)((size_t)handle);
-    appThread_AddEvent(appThread, (Event){ EventType_Destroy }, true);
+    appThread_AddEvent(appThread, &(Event){ EventType_Destroy }, true);
 
     // We usually never reach this point because app is killed before
 
     pthread_join(appThread->thread, NULL);
+    platformQueue_Destroy(appThread->platformQueue);
     (*jniEnv)->DeleteGlobalRef(jniEnv, appThread->javaClasses.nativeActivity.object);
-    appThread->javaClasses.nativeActivity = (NativeActivityProto){};
+    appThread->javaClasses.nativeActivity.object = NULL;
 
-    pthread_mutex_destroy(&appThread->mutex);
-    pthread_cond_destroy(&appThread->eventAddedCond);
-    pthread_cond_destroy(&appThread->allEventsProcessed);
+    eventQueue_Destroy(appThread->eventQueue);
+    pthread_mutex_destroy(&appThread->fenceMutex);
+    pthread_cond_destroy(&appThread->fenceCond);
 
     free(appThread);
 }
 
-JNIEXPORT void JNICALL
-Java_com_example_app_NativeWrapper_onStart(JNIEnv* jniEnv, jobject obj, jlong handle)
+static void nativeWrapper_OnStart(JNIEnv* jniEnv, jclass clazz, jlong handle)
 {
     ALOGV("NativeWrapper::onStart()");
-    appThread_AddEvent((AppThread*)((size_t)handle), (Event){ EventType_Start }, false);
+    appThread_AddEvent((AppThread*)((size_t)handle), &(Event){ EventType_Start }, false);
 }
 
-JNIEXPORT void JNICALL
-Java_com_example_app_NativeWrapper_onStop(JNIEnv* jniEnv, jobject obj, jlong handle)
+static void nativeWrapper_OnStop(JNIEnv* jniEnv, jclass clazz, jlong handle)
 {
     ALOGV("NativeWrapper::onStop()");
-    appThread_AddEvent((AppThread*)((size_t)handle), (Event){ EventType_Stop }, true);
+    appThread_AddEvent((AppThread*)((size_t)handle), &(Event){ EventType_Stop }, true);
 }
 
-JNIEXPORT void JNICALL
-Java_com_example_app_NativeWrapper_onResume(JNIEnv* jniEnv, jobject obj, jlong handle)
+static void nativeWrapper_OnResume(JNIEnv* jniEnv, jclass clazz, jlong handle)
 {
     ALOGV("NativeWrapper::onResume()");
-    appThread_AddEvent((AppThread*)((size_t)handle), (Event){ EventType_Resume }, false);
+    appThread_AddEvent((AppThread*)((size_t)handle), &(Event){ EventType_Resume }, false);
 }
 
-JNIEXPORT void JNICALL
-Java_com_example_app_NativeWrapper_onPause(JNIEnv* jniEnv, jobject obj, jlong handle)
+static void nativeWrapper_OnPause(JNIEnv* jniEnv, jclass clazz, jlong handle)
 {
     ALOGV("NativeWrapper::onPause()");
-    appThread_AddEvent((AppThread*)((size_t)handle), (Event){ EventType_Pause }, true);
+    appThread_AddEvent((AppThread*)((size_t)handle), &(Event){ EventType_Pause }, true);
 }
 
-JNIEXPORT void JNICALL
-Java_com_example_app_NativeWrapper_onWindowFocusChanged(JNIEnv* jniEnv, jobject obj, jlong handle, bool hasFocus)
+static void nativeWrapper_OnWindowFocusChanged(JNIEnv* jniEnv, jclass clazz, jlong handle, bool hasFocus)
 {
     ALOGV("NativeWrapper::onWindowFocusChanged(%d)", hasFocus);
-    appThread_AddEvent((AppThread*)((size_t)handle), (Event){
+    appThread_AddEvent((AppThread*)((size_t)handle), &(Event){
         .type = EventType_WindowFocusChanged,
         .windowFocusChanged = { hasFocus }
     }, false);
@@ -776,27 +899,25 @@ Surface lifecycle
 ================================================================================
 */
 
-JNIEXPORT void JNICALL
-Java_com_example_app_NativeWrapper_surfaceCreated(JNIEnv* jniEnv, jobject obj, jlong handle, jobject surface)
+static void nativeWrapper_SurfaceCreated(JNIEnv* jniEnv, jclass clazz, jlong handle, jobject surface)
 {
     ALOGV("NativeWrapper::surfaceCreated()");
     AppThread* appThread = (AppThread*)((size_t)handle);
     appThread->nativeWindow = ANativeWindow_fromSurface(jniEnv, surface);
 
-    appThread_AddEvent(appThread, (Event){ 
+    appThread_AddEvent(appThread, &(Event){ 
         .type = EventType_SurfaceCreated,
         .surfaceCreated = {
             .nativeWindow = appThread->nativeWindow
         }}, true);
 }
 
-JNIEXPORT void JNICALL
-Java_com_example_app_NativeWrapper_surfaceChanged(JNIEnv* jniEnv, jobject obj, jlong handle, int format, int width, int height)
+static void nativeWrapper_SurfaceChanged(JNIEnv* jniEnv, jclass clazz, jlong handle, int format, int width, int height)
 {
     ALOGV("NativeWrapper::surfaceChanged()");
     AppThread* appThread = (AppThread*)((size_t)handle);
 
-    appThread_AddEvent(appThread, (Event){ 
+    appThread_AddEvent(appThread, &(Event){ 
         .type = EventType_SurfaceChanged,
         .surfaceChanged = {
             .format = format,
@@ -805,13 +926,12 @@ Java_com_example_app_NativeWrapper_surfaceChanged(JNIEnv* jniEnv, jobject obj, j
         } }, false);
 }
 
-JNIEXPORT void JNICALL
-Java_com_example_app_NativeWrapper_surfaceDestroyed(JNIEnv* jniEnv, jobject obj, jlong handle)
+static void nativeWrapper_SurfaceDestroyed(JNIEnv* jniEnv, jclass clazz, jlong handle)
 {
     ALOGV("NativeWrapper::surfaceDestroyed()");
     AppThread* appThread = (AppThread*)((size_t)handle);
 
-    appThread_AddEvent(appThread, (Event){ EventType_SurfaceDestroyed }, true);
+    appThread_AddEvent(appThread, &(Event){ EventType_SurfaceDestroyed }, true);
 
     ANativeWindow_release(appThread->nativeWindow);
     appThread->nativeWindow = NULL;
@@ -823,39 +943,111 @@ Input
 ================================================================================
 */
 
-JNIEXPORT bool JNICALL
-Java_com_example_app_NativeWrapper_dispatchKeyEvent(JNIEnv* jniEnv, jobject obj, jlong handle, jobject keyEvent)
+static void nativeWrapper_SetInputBuffer(JNIEnv* jniEnv, jclass clazz, jlong handle, jobject buffer)
 {
     AppThread* appThread = (AppThread*)((size_t)handle);
-    InputEvent keyEventNative = keyEvent_FromJava(jniEnv, &appThread->javaClasses.keyEvent, keyEvent);
-    ALOGV("NativeWrapper::dispatchKeyEvent(%d, %d)", keyEventNative.keyEvent.keyCode, keyEventNative.keyEvent.action);
+    void* base = (*jniEnv)->GetDirectBufferAddress(jniEnv, buffer);
+    jlong capacity = (*jniEnv)->GetDirectBufferCapacity(jniEnv, buffer);
+    assert(base && capacity > 0);
 
-    bool isHandled = false; // TODO: Remove? Seems not used anymore (event is async)
-    keyEventNative.isHandled = &isHandled;
+    inputRing_Init(&appThread->inputRing, base, (uint32_t)capacity);
+}
 
-    appThread_AddEvent(appThread, (Event){
-        .type = EventType_DispatchKeyEvent,
-        .dispatchKeyEvent = keyEventNative
-    }, false);
+// Called once per batch of records, which are read in place
+// @FastNative: the garbage collector waits for it to return, keep it short (no logging per record)
+static void nativeWrapper_InputDoorbell(JNIEnv* jniEnv, jclass clazz, jlong handle, jint writeOffset)
+{
+    int64_t receivedTime = time_Now();
+    AppThread* appThread = (AppThread*)((size_t)handle);
 
-    return isHandled;
+    InputEvent inputEvent;
+    while (inputRing_Read(&appThread->inputRing, (uint32_t)writeOffset, &inputEvent))
+    {
+        if (inputEvent.type == AINPUT_EVENT_TYPE_KEY)
+        {
+            appThread_AddEvent(appThread, &(Event){
+                .type = EventType_DispatchKeyEvent,
+                .dispatchKeyEvent = inputEvent
+            }, false);
+        }
+        else if (inputEvent.type == INPUT_EVENT_TYPE_TEXT)
+        {
+            appThread_AddEvent(appThread, &(Event){
+                .type = EventType_CommitText,
+                .commitText = inputEvent
+            }, false);
+        }
+        else
+        {
+            inputEvent.motionEvent.receivedTime = receivedTime;
+
+            unsigned char record[EVENT_MAX_ENCODED_SIZE];
+            uint32_t size = event_Encode(&(Event){
+                .type = EventType_DispatchMotionEvent,
+                .dispatchTouchEvent = inputEvent,
+            }, record);
+            if (!eventQueue_PushMerge(appThread->eventQueue, record, size, event_MergeMotion, NULL))
+                ALOGE("inputDoorbell() motion event dropped");
+        }
+    }
 }
 
-JNIEXPORT bool JNICALL
-Java_com_example_app_NativeWrapper_dispatchTouchEvent(JNIEnv* jniEnv, jobject obj, jlong handle, jobject motionEvent)
+/*
+================================================================================
+JNI bindings
+================================================================================
+*/
+
+// X(javaName, signature, function), must match NativeWrapper.java
+#define NATIVE_WRAPPER_METHODS(X) \
+    X("onCreate", "(Landroid/app/Activity;L" PACKAGE_PATH "/NativeWrapper$Config;)J", nativeWrapper_OnCreate) \
+    X("onDestroy", "(J)V", nativeWrapper_OnDestroy) \
+    X("onStart", "(J)V", nativeWrapper_OnStart) \
+    X("onStop", "(J)V", nativeWrapper_OnStop) \
+    X("onResume", "(J)V", nativeWrapper_OnResume) \
+    X("onPause", "(J)V", nativeWrapper_OnPause) \
+    X("onWindowFocusChanged", "(JZ)V", nativeWrapper_OnWindowFocusChanged) \
+    X("setInputBuffer", "(JLjava/nio/ByteBuffer;)V", nativeWrapper_SetInputBuffer) \
+    X("inputDoorbell", "(JI)V", nativeWrapper_InputDoorbell) \
+    X("surfaceCreated", "(JLandroid/view/Surface;)V", nativeWrapper_SurfaceCreated) \
+    X("surfaceChanged", "(JIII)V", nativeWrapper_SurfaceChanged) \
+    X("surfaceDestroyed", "(J)V", nativeWrapper_SurfaceDestroyed)
+
+#define NATIVE_METHOD(name, signature, function) { name, signature, (void*)function },
+
+static const JNINativeMethod nativeWrapperMethods[] = { NATIVE_WRAPPER_METHODS(NATIVE_METHOD) };
+
+static bool nativeWrapper_Register(JNIEnv* env)
 {
-    //ALOGV("NativeWrapper::dispatchTouchEvent()");
-    AppThread* appThread = (AppThread*)((size_t)handle);
+    jclass clazz = (*env)->FindClass(env, PACKAGE_PATH "/NativeWrapper");
+    if (!jni_Check(env, clazz, PACKAGE_PATH "/NativeWrapper"))
+        return false;
 
-    InputEvent motionEventNative = motionEvent_FromJava(jniEnv, &appThread->javaClasses.motionEvent, motionEvent);
+    // @FastNative keeps the regular calling convention, ignored before Android 8.0
+    bool registered = (*env)->RegisterNatives(env, clazz, nativeWrapperMethods, ARRAYSIZE(nativeWrapperMethods)) == JNI_OK;
+    (*env)->DeleteLocalRef(env, clazz);
 
-    bool isHandled = true; // TODO: Remove? Seems not used anymore (event is async)
-    motionEventNative.isHandled = &isHandled;
+    if (!registered)
+    {
+        (*env)->ExceptionClear(env);
+        ALOGE("RegisterNatives() failed for " PACKAGE_PATH "/NativeWrapper");
+        return false;
+    }
 
-    appThread_AddEvent(appThread, (Event){
-        .type = EventType_DispatchMotionEvent,
-        .dispatchTouchEvent = motionEventNative,
-    }, false);
+    return true;
+}
+
+// The only exported symbol, natives are bound by RegisterNatives() instead of dlsym() lookups
+JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM* vm, void* reserved)
+{
+    ALOGV("JNI_OnLoad()");
+
+    JNIEnv* env;
+    if ((*vm)->GetEnv(vm, (void**)&env, JNI_VERSION_1_6) != JNI_OK)
+        return JNI_ERR;
+
+    if (!javaClasses_Register(env, &g_javaClasses) || !nativeWrapper_Register(env))
+        return JNI_ERR;
 
-    return isHandled;
+    return JNI_VERSION_1_6;
 }
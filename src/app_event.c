@@ -0,0 +1,207 @@
+
+#include <string.h> // memcpy
+
+#include "common.h"
+#include "app_event.h"
+
+const char* eventTypeStr[EventType_Count] =
+{
+    "Create",
+    "Destroy",
+    "Start",
+    "Stop",
+    "Resume",
+    "Pause",
+    "WindowFocusChanged",
+    "DispatchKeyEvent",
+    "DispatchTouchEvent",
+    "CommitText",
+    "SurfaceCreated",
+    "SurfaceChanged",
+    "SurfaceDestroyed",
+};
+
+static uint32_t motionEvent_Pack(const MotionEvent* motionEvent, unsigned char* buffer)
+{
+    PackedMotionEvent packed = { motionEvent->action, motionEvent->pointerCount, motionEvent->historySize, motionEvent->receivedTime, motionEvent->eventTime };
+    int n = motionEvent->pointerCount;
+    unsigned char* p = buffer;
+    memcpy(p, &packed, sizeof(packed));                       p += sizeof(packed);
+    memcpy(p, motionEvent->pointerId, n * sizeof(int32_t));   p += n * sizeof(int32_t);
+    memcpy(p, motionEvent->x, n * sizeof(float));             p += n * sizeof(float);
+    memcpy(p, motionEvent->y, n * sizeof(float));             p += n * sizeof(float);
+    memcpy(p, motionEvent->pressure, n * sizeof(float));      p += n * sizeof(float);
+
+    for (int i = 0; i < motionEvent->historySize; ++i)
+    {
+        memcpy(p, &motionEvent->historyTime[i], sizeof(int64_t));
+        p += sizeof(int64_t);
+        for (int j = i * n; j < (i + 1) * n; ++j)
+        {
+            float pair[2] = { motionEvent->historyX[j], motionEvent->historyY[j] };
+            memcpy(p, pair, sizeof(pair));
+            p += sizeof(pair);
+        }
+    }
+    return p - buffer;
+}
+
+static void motionEvent_Unpack(MotionEvent* motionEvent, const unsigned char* buffer)
+{
+    PackedMotionEvent packed;
+    const unsigned char* p = buffer;
+    memcpy(&packed, p, sizeof(packed));                       p += sizeof(packed);
+    motionEvent->action = packed.action;
+    motionEvent->pointerCount = packed.pointerCount;
+    motionEvent->historySize = packed.historySize;
+    motionEvent->receivedTime = packed.receivedTime;
+    motionEvent->eventTime = packed.eventTime;
+
+    int n = packed.pointerCount;
+    memcpy(motionEvent->pointerId, p, n * sizeof(int32_t));   p += n * sizeof(int32_t);
+    memcpy(motionEvent->x, p, n * sizeof(float));             p += n * sizeof(float);
+    memcpy(motionEvent->y, p, n * sizeof(float));             p += n * sizeof(float);
+    memcpy(motionEvent->pressure, p, n * sizeof(float));      p += n * sizeof(float);
+
+    for (int i = 0; i < packed.historySize; ++i)
+    {
+        memcpy(&motionEvent->historyTime[i], p, sizeof(int64_t));
+        p += sizeof(int64_t);
+        for (int j = i * n; j < (i + 1) * n; ++j)
+        {
+            float pair[2];
+            memcpy(pair, p, sizeof(pair));
+            p += sizeof(pair);
+            motionEvent->historyX[j] = pair[0];
+            motionEvent->historyY[j] = pair[1];
+        }
+    }
+}
+
+static uint32_t textEvent_Pack(const TextEvent* textEvent, unsigned char* buffer)
+{
+    int16_t size = (int16_t)textEvent->size;
+    memcpy(buffer, &size, sizeof(size));
+    memcpy(buffer + sizeof(size), textEvent->utf8, size);
+    return sizeof(size) + size;
+}
+
+static void textEvent_Unpack(TextEvent* textEvent, const unsigned char* buffer)
+{
+    int16_t size;
+    memcpy(&size, buffer, sizeof(size));
+    textEvent->size = size;
+    memcpy(textEvent->utf8, buffer + sizeof(size), size);
+    textEvent->utf8[size] = 0;
+}
+
+#define EVENT_ENCODE(member) memcpy(p, &event->member, sizeof(event->member)); p += sizeof(event->member)
+#define EVENT_DECODE(member) memcpy(&event->member, p, sizeof(event->member))
+
+uint32_t event_Encode(const Event* event, unsigned char* buffer)
+{
+    unsigned char* p = buffer;
+    PackedEventHeader header = { event->type, event->fence };
+    memcpy(p, &header, sizeof(header));
+    p += sizeof(header);
+
+    switch (event->type)
+    {
+        case EventType_Create:              EVENT_ENCODE(create); break;
+        case EventType_WindowFocusChanged:  EVENT_ENCODE(windowFocusChanged); break;
+        case EventType_DispatchKeyEvent:    EVENT_ENCODE(dispatchKeyEvent.keyEvent); break;
+        case EventType_DispatchMotionEvent: p += motionEvent_Pack(&event->dispatchTouchEvent.motionEvent, p); break;
+        case EventType_CommitText:          p += textEvent_Pack(&event->commitText.textEvent, p); break;
+        case EventType_SurfaceCreated:      EVENT_ENCODE(surfaceCreated); break;
+        case EventType_SurfaceChanged:      EVENT_ENCODE(surfaceChanged); break;
+        default: break;
+    }
+
+    return p - buffer;
+}
+
+void event_Decode(Event* event, const unsigned char* buffer)
+{
+    const unsigned char* p = buffer;
+    PackedEventHeader header;
+    memcpy(&header, p, sizeof(header));
+    p += sizeof(header);
+    event->type = header.type;
+    event->fence = header.fence;
+
+    switch (event->type)
+    {
+        case EventType_Create:             EVENT_DECODE(create); break;
+        case EventType_WindowFocusChanged: EVENT_DECODE(windowFocusChanged); break;
+        case EventType_DispatchKeyEvent:
+            event->dispatchKeyEvent.type = AINPUT_EVENT_TYPE_KEY;
+            event->dispatchKeyEvent.isHandled = NULL;
+            EVENT_DECODE(dispatchKeyEvent.keyEvent);
+            break;
+        case EventType_DispatchMotionEvent:
+            event->dispatchTouchEvent.type = AINPUT_EVENT_TYPE_MOTION;
+            event->dispatchTouchEvent.isHandled = NULL;
+            motionEvent_Unpack(&event->dispatchTouchEvent.motionEvent, p);
+            break;
+        case EventType_CommitText:
+            event->commitText.type = INPUT_EVENT_TYPE_TEXT;
+            event->commitText.isHandled = NULL;
+            textEvent_Unpack(&event->commitText.textEvent, p);
+            break;
+        case EventType_SurfaceCreated:     EVENT_DECODE(surfaceCreated); break;
+        case EventType_SurfaceChanged:     EVENT_DECODE(surfaceChanged); break;
+        default: break;
+    }
+}
+
+// Consecutive MOVE events with the same pointers share one queue record, previous positions go to the history
+uint32_t event_MergeMotion(void* last, uint32_t lastSize, uint32_t maxSize, const void* event, uint32_t eventSize, void* userData)
+{
+    PackedEventHeader lastHeader, eventHeader;
+    memcpy(&lastHeader, last, sizeof(PackedEventHeader));
+    memcpy(&eventHeader, event, sizeof(PackedEventHeader));
+    if (lastHeader.type != EventType_DispatchMotionEvent || eventHeader.type != EventType_DispatchMotionEvent
+        || lastHeader.fence || eventHeader.fence)
+        return 0;
+
+    unsigned char* dst = (unsigned char*)last + sizeof(PackedEventHeader);
+    const unsigned char* src = (const unsigned char*)event + sizeof(PackedEventHeader);
+    PackedMotionEvent dstHeader, srcHeader;
+    memcpy(&dstHeader, dst, sizeof(PackedMotionEvent));
+    memcpy(&srcHeader, src, sizeof(PackedMotionEvent));
+    if (dstHeader.action != AMOTION_EVENT_ACTION_MOVE || srcHeader.action != AMOTION_EVENT_ACTION_MOVE
+        || dstHeader.pointerCount != srcHeader.pointerCount)
+        return 0;
+
+    // Same pointers in the same order, the history is indexed by pointer index
+    int pointerCount = dstHeader.pointerCount;
+    unsigned char* dstPointers = dst + sizeof(PackedMotionEvent);
+    const unsigned char* srcPointers = src + sizeof(PackedMotionEvent);
+    if (memcmp(dstPointers, srcPointers, pointerCount * sizeof(int32_t)) != 0)
+        return 0;
+
+    uint32_t newSize = lastSize + sizeof(int64_t) + pointerCount * 2 * sizeof(float);
+    if ((dstHeader.historySize + 1) * pointerCount > MOTION_EVENT_MAX_HISTORY || newSize > maxSize)
+        return 0;
+
+    // Current positions are appended to the history, then replaced by the new ones with their pressure
+    unsigned char* dstX = dstPointers + pointerCount * sizeof(int32_t);
+    unsigned char* dstY = dstX + pointerCount * sizeof(float);
+    const unsigned char* srcX = srcPointers + pointerCount * sizeof(int32_t);
+
+    unsigned char* history = (unsigned char*)last + lastSize;
+    memcpy(history, &dstHeader.eventTime, sizeof(int64_t));
+    history += sizeof(int64_t);
+    for (int i = 0; i < pointerCount; ++i)
+    {
+        memcpy(history + i * 2 * sizeof(float), dstX + i * sizeof(float), sizeof(float));
+        memcpy(history + (i * 2 + 1) * sizeof(float), dstY + i * sizeof(float), sizeof(float));
+    }
+    memcpy(dstX, srcX, pointerCount * 3 * sizeof(float));
+
+    dstHeader.historySize++;
+    dstHeader.eventTime = srcHeader.eventTime;
+    memcpy(dst, &dstHeader, sizeof(PackedMotionEvent));
+
+    return newSize;
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "event.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Events sent from the Java UI thread to the app thread, and their compact encoding in the event queue
+// Also used by the host tools to replay recorded sessions
+
+typedef enum EventType
+{
+    EventType_Create,
+    EventType_Destroy,
+    EventType_Start,
+    EventType_Stop,
+    EventType_Resume,
+    EventType_Pause,
+    EventType_WindowFocusChanged,
+    EventType_DispatchKeyEvent,
+    EventType_DispatchMotionEvent,
+    EventType_CommitText,
+    EventType_SurfaceCreated,
+    EventType_SurfaceChanged,
+    EventType_SurfaceDestroyed,
+    EventType_Count,
+} EventType;
+
+extern const char* eventTypeStr[EventType_Count];
+
+typedef struct Config
+{
+    char filesDir[256];
+    int audioOutputSampleRate;
+    int audioOutputFramesPerBuffer;
+    float displayRefreshRate; // Hz, when the app was created
+} Config;
+
+typedef struct Event
+{
+    EventType type;
+    uint16_t fence; // Signaled once the event is handled, 0 if nobody waits for it
+
+    union
+    {
+        // Passed by reference, owned by AppThread
+        struct Create
+        {
+            const Config* config;
+        } create;
+
+        struct WindowFocusChanged
+        {
+            bool hasFocus;
+        } windowFocusChanged;
+
+        InputEvent dispatchKeyEvent;
+        InputEvent dispatchTouchEvent;
+        InputEvent commitText; // INPUT_EVENT_TYPE_TEXT, a whole IME commit or paste in one event
+
+        struct SurfaceCreated
+        {
+            struct ANativeWindow* nativeWindow;
+        } surfaceCreated;
+
+        struct SurfaceChanged
+        {
+            int format;
+            int width;
+            int height;
+        } surfaceChanged;
+    };
+} Event;
+
+// Events are queued as a PackedEventHeader followed by the bytes used by their type only,
+// the Event union is as big as its biggest member
+
+typedef struct PackedEventHeader
+{
+    uint16_t type;
+    uint16_t fence;
+} PackedEventHeader;
+
+// Followed by int32 pointerId[pointerCount], float x[pointerCount], y[pointerCount], pressure[pointerCount]
+// then historySize samples made of an int64 time and pointerCount float (x, y) pairs
+typedef struct PackedMotionEvent
+{
+    int32_t action;
+    int16_t pointerCount;
+    int16_t historySize;
+    int64_t receivedTime; // Merging keeps the oldest one
+    int64_t eventTime;
+} PackedMotionEvent;
+
+// Text is packed as an int16 size followed by the UTF-8 bytes, smaller than the biggest motion event
+#define EVENT_MAX_ENCODED_SIZE (sizeof(PackedEventHeader) + sizeof(PackedMotionEvent) \
+    + MOTION_EVENT_MAX_POINTERS * (sizeof(int32_t) + 3 * sizeof(float)) + MOTION_EVENT_MAX_HISTORY * (sizeof(int64_t) + 2 * sizeof(float)))
+
+uint32_t event_Encode(const Event* event, unsigned char* buffer); // Returns the size written, at most EVENT_MAX_ENCODED_SIZE
+void event_Decode(Event* event, const unsigned char* buffer);     // Only the members used by the event type are written
+
+// EventQueueMergeFunc for eventQueue_PushMerge()
+uint32_t event_MergeMotion(void* last, uint32_t lastSize, uint32_t maxSize, const void* event, uint32_t eventSize, void* userData);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,7 +1,11 @@
 
 #include <stdbool.h>
 
-#include <android/log.h> // TODO: Remove? Or #ifdef it
+#ifdef __ANDROID__
+#include <android/log.h>
+#else
+#include <stdio.h> // Headless Linux builds log to stderr
+#endif
 
 #define ARRAYSIZE(arr) (sizeof(arr)/sizeof(arr[0]))
 #define OFFSETOF(type, member) __builtin_offsetof(type, member)
@@ -9,9 +13,17 @@
 #define DEBUG 1
 #define LOG_TAG "EmptyApp"
 
-#define ALOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#ifdef __ANDROID__
+#define ALOG(priority, ...) __android_log_print(priority, LOG_TAG, __VA_ARGS__)
+#else
+#define ANDROID_LOG_VERBOSE 2
+#define ANDROID_LOG_ERROR 6
+#define ALOG(priority, ...) (fprintf(stderr, "%c/" LOG_TAG ": ", (priority) == ANDROID_LOG_ERROR ? 'E' : 'V'), fprintf(stderr, __VA_ARGS__), fputc('\n', stderr))
+#endif
+
+#define ALOGE(...) ALOG(ANDROID_LOG_ERROR, __VA_ARGS__)
 #if DEBUG
-#define ALOGV(...) __android_log_print(ANDROID_LOG_VERBOSE, LOG_TAG, __VA_ARGS__)
+#define ALOGV(...) ALOG(ANDROID_LOG_VERBOSE, __VA_ARGS__)
 #else
 #define ALOGV(...)
 #endif
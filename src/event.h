@@ -1,6 +1,61 @@
+#pragma once
+
+#include <stdbool.h>
 #include <stdint.h>
 
+#ifdef __ANDROID__
 #include <android/input.h>
+#else
+// Headless Linux builds (tools/), values from android/input.h
+enum { AINPUT_EVENT_TYPE_KEY = 1, AINPUT_EVENT_TYPE_MOTION = 2 };
+enum { AMOTION_EVENT_ACTION_DOWN = 0, AMOTION_EVENT_ACTION_UP = 1, AMOTION_EVENT_ACTION_MOVE = 2, AMOTION_EVENT_ACTION_CANCEL = 3,
+       AMOTION_EVENT_ACTION_POINTER_DOWN = 5, AMOTION_EVENT_ACTION_POINTER_UP = 6, AMOTION_EVENT_ACTION_HOVER_MOVE = 7 };
+enum { AMOTION_EVENT_ACTION_MASK = 0xff, AMOTION_EVENT_ACTION_POINTER_INDEX_MASK = 0xff00, AMOTION_EVENT_ACTION_POINTER_INDEX_SHIFT = 8 };
+#endif
+
+#define MOTION_EVENT_MAX_POINTERS 10
+#define MOTION_EVENT_MAX_HISTORY 64 // Positions, shared by all pointers
+
+#define INPUT_EVENT_TYPE_TEXT 0x100 // Not an AINPUT_EVENT_TYPE_*, text committed by the IME or pasted
+#define TEXT_EVENT_MAX_SIZE 256     // UTF-8 bytes, longer text is split between code points into several events
+
+typedef struct KeyEvent
+{
+    int action;
+    int keyCode;
+    int scanCode;
+    int unicodeChar;
+    int metaState;
+} KeyEvent;
+
+typedef struct MotionEvent
+{
+    int action; // AMOTION_EVENT_ACTION_*, POINTER_DOWN/UP carry the index of their pointer, see motionEvent_GetActionIndex()
+    int pointerCount;
+
+    // Indexed by pointer index, which changes as pointers go down and up, ids stay the same from down to up
+    int32_t pointerId[MOTION_EVENT_MAX_POINTERS];
+    float x[MOTION_EVENT_MAX_POINTERS]; // In pixels, sub-pixel precision
+    float y[MOTION_EVENT_MAX_POINTERS];
+    float pressure[MOTION_EVENT_MAX_POINTERS];
+
+    int64_t eventTime; // When the positions were sampled, CLOCK_MONOTONIC ns (millisecond precision, from MotionEvent.getEventTime())
+
+    // Positions of the MOVE events merged into this one, oldest first
+    // Sample i of pointer p is at [i * pointerCount + p], sample i was taken at historyTime[i]
+    int historySize;
+    float historyX[MOTION_EVENT_MAX_HISTORY];
+    float historyY[MOTION_EVENT_MAX_HISTORY];
+    int64_t historyTime[MOTION_EVENT_MAX_HISTORY];
+
+    int64_t receivedTime; // time_Now() when the UI thread received it, the oldest one if MOVE events were merged
+} MotionEvent;
+
+typedef struct TextEvent
+{
+    int size; // In bytes, without the terminating 0
+    char utf8[TEXT_EVENT_MAX_SIZE + 1];
+} TextEvent;
 
 typedef struct InputEvent
 {
@@ -8,21 +63,28 @@ typedef struct InputEvent
     bool* isHandled;
     union
     {
-        struct 
-        {
-            int action;
-            int keyCode;
-            int scanCode;
-            int unicodeChar;
-            int metaState;
-        } keyEvent;
-
-        struct 
-        {
-            int action;
-            int pointerCount;
-            int x[10];
-            int y[10];
-        } motionEvent;
+        KeyEvent keyEvent;
+        MotionEvent motionEvent;
+        TextEvent textEvent;
     };
 } InputEvent;
+
+static inline int motionEvent_GetActionMasked(const MotionEvent* motionEvent)
+{
+    return motionEvent->action & AMOTION_EVENT_ACTION_MASK;
+}
+
+// Pointer index of POINTER_DOWN/UP events
+static inline int motionEvent_GetActionIndex(const MotionEvent* motionEvent)
+{
+    return (motionEvent->action & AMOTION_EVENT_ACTION_POINTER_INDEX_MASK) >> AMOTION_EVENT_ACTION_POINTER_INDEX_SHIFT;
+}
+
+// Pointer index of `pointerId`, -1 if it is not in the event
+static inline int motionEvent_FindPointer(const MotionEvent* motionEvent, int32_t pointerId)
+{
+    for (int i = 0; i < motionEvent->pointerCount; ++i)
+        if (motionEvent->pointerId[i] == pointerId)
+            return i;
+    return -1;
+}
@@ -0,0 +1,531 @@
+
+#include <stdlib.h> // calloc/free
+#include <string.h> // memcpy
+#include <assert.h> // assert
+#include <stdatomic.h>
+#include <sched.h> // sched_yield
+
+#include <pthread.h>
+
+#include "common.h"
+#include "event_queue.h"
+
+#define CACHE_LINE_SIZE 64
+
+// Records are [RecordHeader][payload] aligned on 8 bytes, they never straddle the end of the ring:
+// when a record does not fit before the end, a wrap marker fills the remaining bytes
+typedef struct RecordHeader
+{
+    uint32_t size; // Payload size or RECORD_WRAP
+    uint32_t unused;
+} RecordHeader;
+
+#define RECORD_WRAP 0xFFFFFFFFu
+#define RECORD_ALIGN(size) (((size) + 7u) & ~7u)
+#define RECORD_TOTAL_SIZE(size) ((uint32_t)sizeof(RecordHeader) + RECORD_ALIGN(size))
+
+// Indices are free running byte offsets, (index & mask) gives the position in data
+typedef struct EventRing EventRing;
+struct EventRing
+{
+    // Written by the consumer
+    _Atomic uint32_t head;
+    uint32_t cachedTail;
+    _Atomic uint64_t reading; // Index + 1 of the record being read
+    char padHead[CACHE_LINE_SIZE - 2 * sizeof(uint32_t) - sizeof(uint64_t)];
+
+    // Written by the producer
+    _Atomic uint32_t tail;
+    uint32_t cachedHead;
+    _Atomic uint64_t merging; // Index + 1 of the record being merged into, 0 if none
+    uint32_t lastRecord;      // Index of the last record pushed
+    bool hasLastRecord;
+    char padTail[CACHE_LINE_SIZE - 4 * sizeof(uint32_t) - sizeof(uint64_t)];
+
+    // Set by the producer when it moved to a bigger ring, the old one is never written again
+    _Atomic(EventRing*) next;
+    uint32_t mask;
+    unsigned char data[];
+};
+
+struct EventQueue
+{
+    uint32_t maxElementSize;
+    EventQueueOverflow overflow;
+    EventQueueMergeFunc coalesce;
+    void* coalesceUserData;
+
+    // Producer side
+    EventRing* writeRing;
+    uint64_t pushCount;
+    uint32_t pendingSize; // 0 if no pending element
+    unsigned char* pending;
+    _Atomic uint32_t receivedCount;
+    _Atomic uint32_t mergedCount;
+    _Atomic uint32_t droppedCount;
+    _Atomic uint64_t writtenBytes;
+    char padProducer[CACHE_LINE_SIZE];
+
+    // Consumer side
+    EventRing* readRing;
+    uint32_t peekedTotalSize; // Record being read, 0 if none
+    uint64_t popCount;
+    _Atomic uint64_t emptyAt; // popCount the last time the consumer found the queue empty
+    char padConsumer[CACHE_LINE_SIZE];
+
+    // Only used when one side has to sleep
+    _Atomic bool consumerSleeping;
+    _Atomic bool producerSleeping;
+    pthread_mutex_t mutex;
+    pthread_cond_t consumerCond;
+    pthread_cond_t producerCond;
+};
+
+static uint32_t nextPowerOfTwo(uint32_t v)
+{
+    v--;
+    v |= v >> 1;
+    v |= v >> 2;
+    v |= v >> 4;
+    v |= v >> 8;
+    v |= v >> 16;
+    return v + 1;
+}
+
+// Counters only have one writer, no need for an atomic read-modify-write
+static void counter_Increment(_Atomic uint32_t* counter)
+{
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + 1, memory_order_relaxed);
+}
+
+static void counter_Add64(_Atomic uint64_t* counter, uint64_t value)
+{
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + value, memory_order_relaxed);
+}
+
+static EventRing* ring_Create(uint32_t capacity)
+{
+    EventRing* ring = calloc(1, sizeof(EventRing) + capacity);
+    if (ring == NULL)
+        return NULL;
+
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->reading, 0);
+    atomic_init(&ring->merging, 0);
+    atomic_init(&ring->next, NULL);
+    ring->mask = capacity - 1;
+    return ring;
+}
+
+static RecordHeader* ring_Header(EventRing* ring, uint32_t index)
+{
+    return (RecordHeader*)(ring->data + (index & ring->mask));
+}
+
+// Returns the number of bytes written, 0 if there is not enough space
+static uint32_t ring_TryPush(EventRing* ring, const void* element, uint32_t size)
+{
+    uint32_t capacity = ring->mask + 1;
+    uint32_t totalSize = RECORD_TOTAL_SIZE(size);
+
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t toEnd = capacity - (tail & ring->mask);
+    uint32_t wrapSize = (toEnd < totalSize) ? toEnd : 0;
+
+    if (capacity - (tail - ring->cachedHead) < wrapSize + totalSize)
+    {
+        ring->cachedHead = atomic_load_explicit(&ring->head, memory_order_acquire);
+        if (capacity - (tail - ring->cachedHead) < wrapSize + totalSize)
+            return 0;
+    }
+
+    if (wrapSize)
+    {
+        ring_Header(ring, tail)->size = RECORD_WRAP;
+        tail += wrapSize;
+    }
+
+    RecordHeader* header = ring_Header(ring, tail);
+    header->size = size;
+    memcpy(header + 1, element, size);
+
+    ring->lastRecord = tail;
+    ring->hasLastRecord = true;
+    atomic_store_explicit(&ring->tail, tail + totalSize, memory_order_release);
+    return wrapSize + totalSize;
+}
+
+// Merge into the last pushed record if the consumer did not claim it yet, the record can grow in place
+// Same pattern as the sleeping flags: either the consumer sees `merging` and waits, or we see its claim and give up
+// Returns the number of bytes added to the ring, -1 if not merged
+static int32_t ring_TryMergeLast(EventRing* ring, EventQueueMergeFunc merge, const void* element, uint32_t size, void* userData)
+{
+    if (!ring->hasLastRecord)
+        return -1;
+
+    uint32_t last = ring->lastRecord;
+    atomic_store(&ring->merging, (uint64_t)last + 1);
+
+    uint32_t lastClaimed = (uint32_t)(atomic_load(&ring->reading) - 1);
+    bool claimed = (int32_t)(lastClaimed - last) >= 0;
+
+    int32_t addedBytes = -1;
+    if (!claimed)
+    {
+        // The last record ends at tail, it can only grow up to the end of the ring or of the free space
+        uint32_t capacity = ring->mask + 1;
+        uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        uint32_t toEnd = (tail & ring->mask) ? capacity - (tail & ring->mask) : 0;
+
+        // Refresh cachedHead too: growing tail against a fresher head than cachedHead
+        // would otherwise let ring_TryPush() see more than a full ring of used space
+        ring->cachedHead = atomic_load_explicit(&ring->head, memory_order_acquire);
+        uint32_t freeSize = capacity - (tail - ring->cachedHead);
+        uint32_t growth = toEnd < freeSize ? toEnd : freeSize;
+
+        RecordHeader* header = ring_Header(ring, last);
+        uint32_t oldTotalSize = RECORD_TOTAL_SIZE(header->size);
+        uint32_t newSize = merge(header + 1, header->size, RECORD_ALIGN(header->size) + growth, element, size, userData);
+        if (newSize)
+        {
+            assert(RECORD_TOTAL_SIZE(newSize) >= oldTotalSize && RECORD_TOTAL_SIZE(newSize) - oldTotalSize <= growth);
+            header->size = newSize;
+            addedBytes = RECORD_TOTAL_SIZE(newSize) - oldTotalSize;
+            atomic_store_explicit(&ring->tail, tail + addedBytes, memory_order_release);
+        }
+    }
+
+    atomic_store_explicit(&ring->merging, 0, memory_order_release);
+    return addedBytes;
+}
+
+// The fence pairs with the one following the store of the sleeping flag (Dekker style):
+// either the sleeper sees the new state, or we see the flag and take the mutex to signal it
+static void eventQueue_WakeConsumer(EventQueue* queue)
+{
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&queue->consumerSleeping, memory_order_relaxed))
+    {
+        pthread_mutex_lock(&queue->mutex);
+        pthread_cond_signal(&queue->consumerCond);
+        pthread_mutex_unlock(&queue->mutex);
+    }
+}
+
+static void eventQueue_WakeProducer(EventQueue* queue)
+{
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&queue->producerSleeping, memory_order_relaxed))
+    {
+        pthread_mutex_lock(&queue->mutex);
+        pthread_cond_signal(&queue->producerCond);
+        pthread_mutex_unlock(&queue->mutex);
+    }
+}
+
+EventQueue* eventQueue_Create(const EventQueueDesc* desc)
+{
+    assert(desc->maxElementSize > 0);
+    assert(desc->overflow != EventQueueOverflow_Coalesce || desc->coalesce);
+
+    EventQueue* queue = calloc(1, sizeof(EventQueue));
+    queue->maxElementSize = desc->maxElementSize;
+    queue->overflow = desc->overflow;
+    queue->coalesce = desc->coalesce;
+    queue->coalesceUserData = desc->coalesceUserData;
+
+    // The biggest record and a wrap marker always fit
+    uint32_t minCapacity = 2 * RECORD_TOTAL_SIZE(desc->maxElementSize);
+    uint32_t capacity = nextPowerOfTwo(desc->capacity < minCapacity ? minCapacity : desc->capacity);
+    queue->writeRing = queue->readRing = ring_Create(capacity);
+    assert(queue->writeRing);
+
+    if (desc->overflow == EventQueueOverflow_Coalesce)
+        queue->pending = calloc(1, desc->maxElementSize);
+
+    atomic_init(&queue->receivedCount, 0);
+    atomic_init(&queue->mergedCount, 0);
+    atomic_init(&queue->droppedCount, 0);
+    atomic_init(&queue->writtenBytes, 0);
+    atomic_init(&queue->emptyAt, 0);
+    atomic_init(&queue->consumerSleeping, false);
+    atomic_init(&queue->producerSleeping, false);
+    pthread_mutex_init(&queue->mutex, NULL);
+    pthread_cond_init(&queue->consumerCond, NULL);
+    pthread_cond_init(&queue->producerCond, NULL);
+
+    return queue;
+}
+
+void eventQueue_Destroy(EventQueue* queue)
+{
+    EventRing* ring = queue->readRing;
+    while (ring)
+    {
+        EventRing* next = atomic_load_explicit(&ring->next, memory_order_relaxed);
+        free(ring);
+        ring = next;
+    }
+
+    pthread_mutex_destroy(&queue->mutex);
+    pthread_cond_destroy(&queue->consumerCond);
+    pthread_cond_destroy(&queue->producerCond);
+
+    free(queue->pending);
+    free(queue);
+}
+
+static bool eventQueue_TryPushRing(EventQueue* queue, const void* element, uint32_t size)
+{
+    uint32_t writtenBytes = ring_TryPush(queue->writeRing, element, size);
+    if (writtenBytes == 0)
+        return false;
+
+    queue->pushCount++;
+    counter_Add64(&queue->writtenBytes, writtenBytes);
+    return true;
+}
+
+static bool eventQueue_Grow(EventQueue* queue, const void* element, uint32_t size)
+{
+    EventRing* ring = queue->writeRing;
+    uint32_t capacity = (ring->mask + 1) * 2;
+
+    EventRing* bigger = ring_Create(capacity);
+    if (bigger == NULL)
+    {
+        ALOGE("eventQueue_Grow() cannot allocate %u bytes", capacity);
+        counter_Increment(&queue->droppedCount);
+        return false;
+    }
+
+    ALOGV("eventQueue_Grow() capacity %u -> %u", ring->mask + 1, capacity);
+    queue->writeRing = bigger;
+    eventQueue_TryPushRing(queue, element, size);
+
+    atomic_store_explicit(&ring->next, bigger, memory_order_release);
+    return true;
+}
+
+static void eventQueue_PushBlocking(EventQueue* queue, const void* element, uint32_t size)
+{
+    pthread_mutex_lock(&queue->mutex);
+    atomic_store(&queue->producerSleeping, true);
+    atomic_thread_fence(memory_order_seq_cst);
+
+    while (!eventQueue_TryPushRing(queue, element, size))
+        pthread_cond_wait(&queue->producerCond, &queue->mutex);
+
+    atomic_store(&queue->producerSleeping, false);
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+static bool eventQueue_Coalesce(EventQueue* queue, const void* element, uint32_t size)
+{
+    bool dropped = false;
+    if (queue->pendingSize)
+    {
+        uint32_t newSize = queue->coalesce(queue->pending, queue->pendingSize, queue->maxElementSize, element, size, queue->coalesceUserData);
+        if (newSize)
+        {
+            queue->pendingSize = newSize;
+            return true;
+        }
+
+        // Cannot be merged, keep the most recent one
+        counter_Increment(&queue->droppedCount);
+        dropped = true;
+    }
+
+    memcpy(queue->pending, element, size);
+    queue->pendingSize = size;
+    return !dropped;
+}
+
+static void eventQueue_FlushPending(EventQueue* queue)
+{
+    if (queue->pendingSize && eventQueue_TryPushRing(queue, queue->pending, queue->pendingSize))
+        queue->pendingSize = 0;
+}
+
+bool eventQueue_Push(EventQueue* queue, const void* element, uint32_t size)
+{
+    counter_Increment(&queue->receivedCount);
+
+    if (size > queue->maxElementSize)
+    {
+        ALOGE("eventQueue_Push() element too big (%u > %u)", size, queue->maxElementSize);
+        counter_Increment(&queue->droppedCount);
+        return false;
+    }
+
+    // Pending element (coalesce policy) must be flushed first to keep ordering
+    eventQueue_FlushPending(queue);
+
+    bool result = true;
+    if (queue->pendingSize || !eventQueue_TryPushRing(queue, element, size))
+    {
+        switch (queue->overflow)
+        {
+            case EventQueueOverflow_Grow:     result = eventQueue_Grow(queue, element, size); break;
+            case EventQueueOverflow_Block:    eventQueue_PushBlocking(queue, element, size); break;
+            case EventQueueOverflow_Coalesce: result = eventQueue_Coalesce(queue, element, size); break;
+        }
+    }
+
+    eventQueue_WakeConsumer(queue);
+    return result;
+}
+
+bool eventQueue_PushMerge(EventQueue* queue, const void* element, uint32_t size, EventQueueMergeFunc merge, void* userData)
+{
+    // The pending element (coalesce policy) is the most recent one when there is one
+    bool merged;
+    if (queue->pendingSize)
+    {
+        uint32_t newSize = merge(queue->pending, queue->pendingSize, queue->maxElementSize, element, size, userData);
+        if (newSize)
+            queue->pendingSize = newSize;
+        merged = (newSize != 0);
+    }
+    else
+    {
+        int32_t addedBytes = ring_TryMergeLast(queue->writeRing, merge, element, size, userData);
+        if (addedBytes > 0)
+            counter_Add64(&queue->writtenBytes, addedBytes);
+        merged = (addedBytes >= 0);
+    }
+
+    if (!merged)
+        return eventQueue_Push(queue, element, size);
+
+    // Already visible to the consumer, no need to wake it
+    counter_Increment(&queue->receivedCount);
+    counter_Increment(&queue->mergedCount);
+    return true;
+}
+
+void eventQueue_WaitEmpty(EventQueue* queue)
+{
+    pthread_mutex_lock(&queue->mutex);
+    atomic_store(&queue->producerSleeping, true);
+    atomic_thread_fence(memory_order_seq_cst);
+
+    for (;;)
+    {
+        if (queue->pendingSize)
+        {
+            eventQueue_FlushPending(queue);
+            pthread_mutex_unlock(&queue->mutex);
+            eventQueue_WakeConsumer(queue);
+            pthread_mutex_lock(&queue->mutex);
+        }
+
+        if (!queue->pendingSize && atomic_load_explicit(&queue->emptyAt, memory_order_acquire) >= queue->pushCount)
+            break;
+
+        pthread_cond_wait(&queue->producerCond, &queue->mutex);
+    }
+
+    atomic_store(&queue->producerSleeping, false);
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+EventQueueStats eventQueue_GetStats(const EventQueue* queue)
+{
+    EventQueue* q = (EventQueue*)queue;
+    return (EventQueueStats){
+        .receivedCount = atomic_load_explicit(&q->receivedCount, memory_order_relaxed),
+        .mergedCount = atomic_load_explicit(&q->mergedCount, memory_order_relaxed),
+        .droppedCount = atomic_load_explicit(&q->droppedCount, memory_order_relaxed),
+        .writtenBytes = atomic_load_explicit(&q->writtenBytes, memory_order_relaxed),
+    };
+}
+
+const void* eventQueue_Peek(EventQueue* queue, uint32_t* size)
+{
+    assert(queue->peekedTotalSize == 0);
+
+    EventRing* ring = queue->readRing;
+    for (;;)
+    {
+        uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+        if (head == ring->cachedTail)
+        {
+            ring->cachedTail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+            if (head == ring->cachedTail)
+            {
+                EventRing* next = atomic_load_explicit(&ring->next, memory_order_acquire);
+                if (next == NULL)
+                {
+                    atomic_store_explicit(&queue->emptyAt, queue->popCount, memory_order_release);
+                    eventQueue_WakeProducer(queue);
+                    return NULL;
+                }
+
+                // Records pushed right before the producer linked the bigger ring
+                ring->cachedTail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+                if (head == ring->cachedTail)
+                {
+                    free(ring);
+                    queue->readRing = ring = next;
+                }
+                continue;
+            }
+        }
+
+        // Claim the record before reading it, the producer may be merging into it (see ring_TryMergeLast)
+        uint64_t claim = (uint64_t)head + 1;
+        atomic_store(&ring->reading, claim);
+        while (atomic_load(&ring->merging) == claim)
+            sched_yield();
+
+        RecordHeader* header = ring_Header(ring, head);
+        if (header->size == RECORD_WRAP)
+        {
+            atomic_store_explicit(&ring->head, head + (ring->mask + 1) - (head & ring->mask), memory_order_release);
+            continue;
+        }
+
+        // A merge may have grown the record
+        ring->cachedTail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+        *size = header->size;
+        queue->peekedTotalSize = RECORD_TOTAL_SIZE(header->size);
+        return header + 1;
+    }
+}
+
+void eventQueue_Release(EventQueue* queue)
+{
+    assert(queue->peekedTotalSize);
+
+    EventRing* ring = queue->readRing;
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    atomic_store_explicit(&ring->head, head + queue->peekedTotalSize, memory_order_release);
+    queue->peekedTotalSize = 0;
+
+    queue->popCount++;
+    eventQueue_WakeProducer(queue);
+}
+
+static bool eventQueue_IsEmpty(EventQueue* queue)
+{
+    EventRing* ring = queue->readRing;
+    return atomic_load_explicit(&ring->head, memory_order_relaxed) == atomic_load_explicit(&ring->tail, memory_order_acquire)
+        && atomic_load_explicit(&ring->next, memory_order_acquire) == NULL;
+}
+
+void eventQueue_Wait(EventQueue* queue)
+{
+    pthread_mutex_lock(&queue->mutex);
+    atomic_store(&queue->consumerSleeping, true);
+    atomic_thread_fence(memory_order_seq_cst);
+
+    while (eventQueue_IsEmpty(queue))
+        pthread_cond_wait(&queue->consumerCond, &queue->mutex);
+
+    atomic_store(&queue->consumerSleeping, false);
+    pthread_mutex_unlock(&queue->mutex);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Single-producer/single-consumer queue of variable-length records stored in a byte ring
+// Push and peek/release are wait-free, the mutex/condvar pair is only touched when one side is actually sleeping
+
+typedef enum EventQueueOverflow
+{
+    EventQueueOverflow_Grow,     // Producer switches to a ring twice as big, consumer follows once the old one is drained
+    EventQueueOverflow_Block,    // Producer sleeps until the consumer frees enough space
+    EventQueueOverflow_Coalesce, // Producer merges elements into a pending element until the ring has room again
+} EventQueueOverflow;
+
+// Merge `element` into `last`, which can grow up to `maxSize` bytes
+// Return the new size of `last`, or 0 without modifying it if they cannot be merged
+typedef uint32_t (*EventQueueMergeFunc)(void* last, uint32_t lastSize, uint32_t maxSize, const void* element, uint32_t elementSize, void* userData);
+
+typedef struct EventQueueDesc
+{
+    uint32_t capacity;       // In bytes, rounded up to the next power of two
+    uint32_t maxElementSize; // Bigger elements are refused
+    EventQueueOverflow overflow;
+
+    // Only used with EventQueueOverflow_Coalesce
+    EventQueueMergeFunc coalesce;
+    void* coalesceUserData;
+} EventQueueDesc;
+
+typedef struct EventQueueStats
+{
+    uint32_t receivedCount; // Elements given to eventQueue_Push/eventQueue_PushMerge
+    uint32_t mergedCount;   // Elements merged into one still in the queue
+    uint32_t droppedCount;
+    uint64_t writtenBytes;  // Bytes written to the ring, headers included
+} EventQueueStats;
+
+typedef struct EventQueue EventQueue;
+
+EventQueue* eventQueue_Create(const EventQueueDesc* desc);
+void eventQueue_Destroy(EventQueue* queue);
+
+// Producer side
+bool eventQueue_Push(EventQueue* queue, const void* element, uint32_t size); // Returns false if an element was dropped
+bool eventQueue_PushMerge(EventQueue* queue, const void* element, uint32_t size, EventQueueMergeFunc merge, void* userData); // Merge into the last element if the consumer did not take it yet, push otherwise
+void eventQueue_WaitEmpty(EventQueue* queue);                   // Wait until every pushed element has been released and the consumer polled again
+EventQueueStats eventQueue_GetStats(const EventQueue* queue);   // Any thread
+
+// Consumer side
+const void* eventQueue_Peek(EventQueue* queue, uint32_t* size); // NULL if empty, the element stays valid until eventQueue_Release()
+void eventQueue_Release(EventQueue* queue);
+void eventQueue_Wait(EventQueue* queue); // Sleep until the queue is not empty
+
+#ifdef __cplusplus
+}
+#endif
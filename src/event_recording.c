@@ -0,0 +1,155 @@
+
+#include <stdlib.h> // calloc/free
+#include <stdio.h>  // FILE
+#include <assert.h> // assert
+
+#include "common.h"
+#include "app_event.h"
+#include "timing.h"
+#include "event_recording.h"
+
+_Static_assert(sizeof(EventRecordingHeader) == 16, "EventRecordingHeader is a file format");
+_Static_assert(sizeof(EventRecordingEntry) == 16, "EventRecordingEntry is a file format");
+
+struct EventRecorder
+{
+    FILE* file;
+    int64_t startTime;
+};
+
+struct EventPlayer
+{
+    FILE* file;
+    EventRecordingHeader header;
+    unsigned char data[EVENT_MAX_ENCODED_SIZE];
+};
+
+/*
+================================================================================
+Recorder
+================================================================================
+*/
+
+EventRecorder* eventRecorder_Create(const char* filename)
+{
+    FILE* file = fopen(filename, "wb");
+    if (!file)
+    {
+        ALOGE("Event recording failed on '%s'", filename);
+        return NULL;
+    }
+
+    EventRecorder* recorder = calloc(1, sizeof(EventRecorder));
+    recorder->file = file;
+    recorder->startTime = time_Now();
+
+    EventRecordingHeader header = {
+        .magic = EVENT_RECORDING_MAGIC,
+        .version = EVENT_RECORDING_VERSION,
+        .startTime = recorder->startTime,
+    };
+    fwrite(&header, sizeof(header), 1, file);
+
+    ALOGV("Recording events to '%s'", filename);
+    return recorder;
+}
+
+void eventRecorder_Destroy(EventRecorder* recorder)
+{
+    if (fclose(recorder->file) != 0)
+        ALOGE("Event recording could not be completed");
+    free(recorder);
+}
+
+static void eventRecorder_Write(EventRecorder* recorder, EventRecordingKind kind, int64_t time, const void* data, uint32_t size)
+{
+    EventRecordingEntry entry = {
+        .kind = kind,
+        .size = size,
+        .time = time - recorder->startTime,
+    };
+
+    // Buffered by stdio, the app thread does not wait for the storage
+    fwrite(&entry, sizeof(entry), 1, recorder->file);
+    if (size)
+        fwrite(data, size, 1, recorder->file);
+}
+
+void eventRecorder_AddEvent(EventRecorder* recorder, int64_t time, const void* encodedEvent, uint32_t size)
+{
+    assert(size <= EVENT_MAX_ENCODED_SIZE);
+    eventRecorder_Write(recorder, EventRecordingKind_Event, time, encodedEvent, size);
+}
+
+void eventRecorder_AddFrame(EventRecorder* recorder, int64_t clockTime)
+{
+    eventRecorder_Write(recorder, EventRecordingKind_Frame, clockTime, NULL, 0);
+}
+
+void eventRecorder_Flush(EventRecorder* recorder)
+{
+    if (fflush(recorder->file) != 0)
+        ALOGE("Event recording could not be flushed");
+}
+
+/*
+================================================================================
+Player
+================================================================================
+*/
+
+EventPlayer* eventPlayer_Open(const char* filename)
+{
+    FILE* file = fopen(filename, "rb");
+    if (!file)
+    {
+        ALOGE("Cannot open '%s'", filename);
+        return NULL;
+    }
+
+    EventRecordingHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != EVENT_RECORDING_MAGIC
+        || header.version != EVENT_RECORDING_VERSION)
+    {
+        ALOGE("'%s' is not an event recording (or an unsupported version)", filename);
+        fclose(file);
+        return NULL;
+    }
+
+    EventPlayer* player = calloc(1, sizeof(EventPlayer));
+    player->file = file;
+    player->header = header;
+    return player;
+}
+
+void eventPlayer_Close(EventPlayer* player)
+{
+    fclose(player->file);
+    free(player);
+}
+
+int64_t eventPlayer_GetStartTime(const EventPlayer* player)
+{
+    return player->header.startTime;
+}
+
+int64_t eventPlayer_GetTime(const EventPlayer* player, const EventRecordingEntry* entry)
+{
+    return player->header.startTime + entry->time;
+}
+
+bool eventPlayer_Next(EventPlayer* player, EventRecordingEntry* entry, const void** data)
+{
+    if (fread(entry, sizeof(EventRecordingEntry), 1, player->file) != 1)
+        return false;
+
+    // A recording cut by a crash ends with a partial entry
+    if (entry->size > sizeof(player->data) || (entry->size && fread(player->data, entry->size, 1, player->file) != 1))
+    {
+        ALOGE("Truncated event recording");
+        return false;
+    }
+
+    *data = player->data;
+    return true;
+}
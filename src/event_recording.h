@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Records the encoded events consumed by the app thread and the frame clock readings, to replay sessions on the host
+// File: EventRecordingHeader, then records made of an EventRecordingEntry followed by `size` bytes
+// Events are stored as encoded by event_Encode(), pointers they carry (config, native window) are meaningless on replay
+
+#define EVENT_RECORDING_MAGIC 0x31525645u // "EVR1", little-endian
+#define EVENT_RECORDING_VERSION 4 // 2: float motion coordinates, pointer ids and pressure, 3: motion sample times, 4: text commits
+
+typedef struct EventRecordingHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    int64_t startTime; // time_Now() when the recording started
+} EventRecordingHeader;
+
+typedef enum EventRecordingKind
+{
+    EventRecordingKind_Event, // Followed by the encoded event
+    EventRecordingKind_Frame, // Frame started, `time` is the frame clock reading
+} EventRecordingKind;
+
+typedef struct EventRecordingEntry
+{
+    uint8_t kind;
+    uint8_t reserved[3];
+    uint32_t size;
+    int64_t time; // Nanoseconds since startTime
+} EventRecordingEntry;
+
+// Writing, app thread
+typedef struct EventRecorder EventRecorder;
+
+EventRecorder* eventRecorder_Create(const char* filename); // NULL if the file cannot be created
+void eventRecorder_Destroy(EventRecorder* recorder);
+void eventRecorder_AddEvent(EventRecorder* recorder, int64_t time, const void* encodedEvent, uint32_t size);
+void eventRecorder_AddFrame(EventRecorder* recorder, int64_t clockTime);
+void eventRecorder_Flush(EventRecorder* recorder); // Writes what stdio buffered, the process may be killed once paused
+
+// Reading
+typedef struct EventPlayer EventPlayer;
+
+EventPlayer* eventPlayer_Open(const char* filename); // NULL if the file is not a recording
+void eventPlayer_Close(EventPlayer* player);
+int64_t eventPlayer_GetStartTime(const EventPlayer* player);
+bool eventPlayer_Next(EventPlayer* player, EventRecordingEntry* entry, const void** data); // `data` valid until the next call, false at the end
+int64_t eventPlayer_GetTime(const EventPlayer* player, const EventRecordingEntry* entry); // time_Now() of the recording, like motion event times
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,67 @@
+
+#include <assert.h> // assert
+
+#include "timing.h"
+#include "frame_clock.h"
+
+#define NS_PER_SECOND TIME_NS_PER_SECOND
+
+static int64_t frameClock_MonotonicNow(void* userData)
+{
+    return time_Now();
+}
+
+void frameClock_Init(FrameClock* clock, const FrameClockDesc* desc)
+{
+    *clock = (FrameClock){
+        .fixedStepNs = desc->fixedStepNs ? desc->fixedStepNs : NS_PER_SECOND / 60,
+        .now = desc->now ? desc->now : frameClock_MonotonicNow,
+        .userData = desc->userData,
+    };
+    clock->maxFrameNs = desc->maxFrameNs ? desc->maxFrameNs : 4 * clock->fixedStepNs;
+    assert(clock->fixedStepNs > 0 && clock->maxFrameNs >= clock->fixedStepNs);
+}
+
+void frameClock_Reset(FrameClock* clock)
+{
+    clock->started = false;
+}
+
+int frameClock_Tick(FrameClock* clock)
+{
+    int64_t now = clock->now(clock->userData);
+
+    // First frame (or after a reset) simulates one step so there is something to draw
+    int64_t frameNs = clock->started ? now - clock->lastTime : clock->fixedStepNs;
+    clock->lastTime = now;
+    clock->started = true;
+
+    // Clamping drops time instead of simulating a burst of steps: the game slows down but does not spiral
+    if (frameNs < 0)
+        frameNs = 0;
+    if (frameNs > clock->maxFrameNs)
+        frameNs = clock->maxFrameNs;
+
+    clock->frameNs = frameNs;
+    clock->accumulatorNs += frameNs;
+
+    int stepCount = (int)(clock->accumulatorNs / clock->fixedStepNs);
+    clock->accumulatorNs -= stepCount * clock->fixedStepNs;
+    clock->stepIndex += stepCount;
+    return stepCount;
+}
+
+float frameClock_GetFixedDeltaTime(const FrameClock* clock)
+{
+    return (float)((double)clock->fixedStepNs / NS_PER_SECOND);
+}
+
+float frameClock_GetFrameDeltaTime(const FrameClock* clock)
+{
+    return (float)((double)clock->frameNs / NS_PER_SECOND);
+}
+
+float frameClock_GetAlpha(const FrameClock* clock)
+{
+    return (float)((double)clock->accumulatorNs / clock->fixedStepNs);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Measures the real time elapsed between frames and slices it into fixed simulation steps
+// The remainder that does not fill a whole step is exposed as an interpolation alpha in [0, 1)
+// Time is accumulated in integer nanoseconds so a given sequence of clock readings always gives the same steps
+
+typedef int64_t (*FrameClockNowFunc)(void* userData); // Nanoseconds, monotonic
+
+typedef struct FrameClockDesc
+{
+    int64_t fixedStepNs;      // Simulation step, 1/60 s if 0
+    int64_t maxFrameNs;       // Longer frames (stalls, debugger breaks, app paused) are clamped, 4 steps if 0
+    FrameClockNowFunc now;    // time_Now() if NULL, fake clocks make headless runs deterministic
+    void* userData;
+} FrameClockDesc;
+
+typedef struct FrameClock
+{
+    int64_t fixedStepNs;
+    int64_t maxFrameNs;
+    FrameClockNowFunc now;
+    void* userData;
+
+    int64_t lastTime;
+    int64_t accumulatorNs;
+    int64_t frameNs;         // Measured duration of the last frame, clamped
+    int64_t stepIndex;       // Total steps since frameClock_Init()
+    bool started;
+} FrameClock;
+
+void frameClock_Init(FrameClock* clock, const FrameClockDesc* desc);
+void frameClock_Reset(FrameClock* clock); // The next tick starts from zero, e.g. after resuming
+
+// Once per frame, returns the number of fixed steps to simulate
+int frameClock_Tick(FrameClock* clock);
+
+float frameClock_GetFixedDeltaTime(const FrameClock* clock); // Seconds
+float frameClock_GetFrameDeltaTime(const FrameClock* clock); // Seconds, measured
+float frameClock_GetAlpha(const FrameClock* clock);          // Interpolation between the last two simulated states
+
+#ifdef __cplusplus
+}
+#endif
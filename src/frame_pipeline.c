@@ -0,0 +1,184 @@
+
+#include <stdlib.h> // calloc/free
+#include <assert.h> // assert
+
+#include <pthread.h>
+
+#include "common.h"
+#include "frame_pipeline.h"
+
+#define NO_PACKET -1
+
+struct FramePipeline
+{
+    bool threaded;
+    void* packets[FRAME_PIPELINE_PACKET_COUNT];
+    FramePipelineRenderFunc render;
+    void* userData;
+
+    // Caller thread only
+    int writeIndex;
+    bool acquired;
+
+    // Protected by mutex, a packet is either free, pending or rendering
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int pendingIndex;
+    int renderingIndex;
+    FramePipelineFunc func;
+    void* funcUserData;
+    bool quit;
+};
+
+static void* framePipeline_ThreadFunc(void* arg)
+{
+    ALOGV("framePipeline_ThreadFunc() start");
+    FramePipeline* pipeline = arg;
+
+    pthread_mutex_lock(&pipeline->mutex);
+    for (;;)
+    {
+        while (pipeline->pendingIndex == NO_PACKET && pipeline->func == NULL && !pipeline->quit)
+            pthread_cond_wait(&pipeline->cond, &pipeline->mutex);
+
+        // Packets first, framePipeline_Run() waits for them before setting func anyway
+        if (pipeline->pendingIndex != NO_PACKET)
+        {
+            int index = pipeline->pendingIndex;
+            pipeline->pendingIndex = NO_PACKET;
+            pipeline->renderingIndex = index;
+            pthread_cond_broadcast(&pipeline->cond);
+            pthread_mutex_unlock(&pipeline->mutex);
+
+            pipeline->render(pipeline->packets[index], pipeline->userData);
+
+            pthread_mutex_lock(&pipeline->mutex);
+            pipeline->renderingIndex = NO_PACKET;
+            pthread_cond_broadcast(&pipeline->cond);
+        }
+        else if (pipeline->func)
+        {
+            pthread_mutex_unlock(&pipeline->mutex);
+            pipeline->func(pipeline->funcUserData);
+            pthread_mutex_lock(&pipeline->mutex);
+
+            pipeline->func = NULL;
+            pthread_cond_broadcast(&pipeline->cond);
+        }
+        else
+        {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&pipeline->mutex);
+
+    ALOGV("framePipeline_ThreadFunc() end");
+    return NULL;
+}
+
+FramePipeline* framePipeline_Create(const FramePipelineDesc* desc)
+{
+    assert(desc->render);
+
+    FramePipeline* pipeline = calloc(1, sizeof(FramePipeline));
+    pipeline->threaded = desc->threaded;
+    for (int i = 0; i < FRAME_PIPELINE_PACKET_COUNT; ++i)
+        pipeline->packets[i] = desc->packets[i];
+    pipeline->render = desc->render;
+    pipeline->userData = desc->userData;
+
+    pipeline->pendingIndex = NO_PACKET;
+    pipeline->renderingIndex = NO_PACKET;
+
+    if (pipeline->threaded)
+    {
+        pthread_mutex_init(&pipeline->mutex, NULL);
+        pthread_cond_init(&pipeline->cond, NULL);
+        pthread_create(&pipeline->thread, NULL, framePipeline_ThreadFunc, pipeline);
+    }
+
+    ALOGV("framePipeline_Create() threaded: %d", pipeline->threaded);
+    return pipeline;
+}
+
+void framePipeline_Destroy(FramePipeline* pipeline)
+{
+    assert(!pipeline->acquired);
+
+    if (pipeline->threaded)
+    {
+        pthread_mutex_lock(&pipeline->mutex);
+        pipeline->quit = true;
+        pthread_cond_broadcast(&pipeline->cond);
+        pthread_mutex_unlock(&pipeline->mutex);
+
+        pthread_join(pipeline->thread, NULL);
+        pthread_mutex_destroy(&pipeline->mutex);
+        pthread_cond_destroy(&pipeline->cond);
+    }
+
+    free(pipeline);
+}
+
+void* framePipeline_AcquirePacket(FramePipeline* pipeline)
+{
+    assert(!pipeline->acquired);
+    pipeline->acquired = true;
+
+    int index = pipeline->writeIndex;
+    if (pipeline->threaded)
+    {
+        pthread_mutex_lock(&pipeline->mutex);
+        while (pipeline->pendingIndex == index || pipeline->renderingIndex == index)
+            pthread_cond_wait(&pipeline->cond, &pipeline->mutex);
+        pthread_mutex_unlock(&pipeline->mutex);
+    }
+
+    return pipeline->packets[index];
+}
+
+void framePipeline_Submit(FramePipeline* pipeline)
+{
+    assert(pipeline->acquired);
+    pipeline->acquired = false;
+
+    int index = pipeline->writeIndex;
+    pipeline->writeIndex = (index + 1) % FRAME_PIPELINE_PACKET_COUNT;
+
+    if (!pipeline->threaded)
+    {
+        pipeline->render(pipeline->packets[index], pipeline->userData);
+        return;
+    }
+
+    // The previous packet may not be picked up by the render thread yet
+    pthread_mutex_lock(&pipeline->mutex);
+    while (pipeline->pendingIndex != NO_PACKET)
+        pthread_cond_wait(&pipeline->cond, &pipeline->mutex);
+
+    pipeline->pendingIndex = index;
+    pthread_cond_broadcast(&pipeline->cond);
+    pthread_mutex_unlock(&pipeline->mutex);
+}
+
+void framePipeline_Run(FramePipeline* pipeline, FramePipelineFunc func, void* userData)
+{
+    if (!pipeline->threaded)
+    {
+        func(userData);
+        return;
+    }
+
+    pthread_mutex_lock(&pipeline->mutex);
+    while (pipeline->pendingIndex != NO_PACKET || pipeline->renderingIndex != NO_PACKET)
+        pthread_cond_wait(&pipeline->cond, &pipeline->mutex);
+
+    pipeline->func = func;
+    pipeline->funcUserData = userData;
+    pthread_cond_broadcast(&pipeline->cond);
+
+    while (pipeline->func)
+        pthread_cond_wait(&pipeline->cond, &pipeline->mutex);
+    pthread_mutex_unlock(&pipeline->mutex);
+}
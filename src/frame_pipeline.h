@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Hands frame packets from the simulation thread (the caller) to the render function
+// Threaded: packets are rendered on a dedicated thread, the caller fills the next packet while the previous one is rendered
+// Not threaded: framePipeline_Submit() renders the packet immediately, on the caller thread
+// A packet must contain everything the render function needs, it cannot read simulation state
+
+#define FRAME_PIPELINE_PACKET_COUNT 2
+
+typedef void (*FramePipelineRenderFunc)(void* packet, void* userData);
+typedef void (*FramePipelineFunc)(void* userData);
+
+typedef struct FramePipelineDesc
+{
+    bool threaded;
+    void* packets[FRAME_PIPELINE_PACKET_COUNT]; // Owned by the caller
+    FramePipelineRenderFunc render;
+    void* userData;
+} FramePipelineDesc;
+
+typedef struct FramePipeline FramePipeline;
+
+FramePipeline* framePipeline_Create(const FramePipelineDesc* desc);
+void framePipeline_Destroy(FramePipeline* pipeline); // Renders the submitted packets first
+
+void* framePipeline_AcquirePacket(FramePipeline* pipeline); // Waits until the packet is not used by the render thread anymore
+void framePipeline_Submit(FramePipeline* pipeline);         // Submits the acquired packet
+
+// Run `func` where packets are rendered (e.g. on the thread owning the GL context), once the submitted packets are rendered
+// Returns when `func` returned
+void framePipeline_Run(FramePipeline* pipeline, FramePipelineFunc func, void* userData);
+
+#ifdef __cplusplus
+}
+#endif
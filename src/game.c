@@ -1,4 +1,6 @@
 
+#include <string.h> // memcpy
+
 #include "common.h"
 
 #include "glad/gles2.h"
@@ -6,252 +8,82 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
+#include "job_system.h"
+#include "geometry.h"
+#include "gl_state.h"
+#include "render_queue.h"
+#include "uniform_ring.h"
+#include "vecmath.h"
+#include "vertex_format.h"
 #include "game.h"
 
-typedef struct Game
-{
-    GLuint program;
-    GLuint vao;
-    GLuint vbo;
-    int vertexCount;
-
-    GLuint texture;
-
-    // Uniforms
-    GLint projLocation;
-    GLint viewLocation;
-    GLint modelLocation;
-    GLint timeLocation;
-} Game;
-
-#define TAU 6.283185307179586f
+#define ICOSAHEDRON_DEPTH 2
+#define ICOSAHEDRON_NORMALS GeoNormals_Smooth
+#define GAME_OBJECT_COUNT 1
 
-typedef union float2
-{
-    struct { float x, y; };
-    float e[2];
-} float2;
+// Shader locations after the VertexAttrib ones, a mat4 takes 4
+#define INSTANCE_ATTRIB_MODEL 4
+#define INSTANCE_ATTRIB_COLOR 8
 
-typedef union float3
-{
-    struct { float x, y, z; };
-    float2 xy;
-    float e[3];
-} float3;
+// Uniform block binding points
+#define UNIFORM_BINDING_FRAME 0
+#define UNIFORM_BINDING_OBJECT 1
 
-typedef union float4
+// std140 layouts of the shader uniform blocks
+typedef struct FrameUniforms
 {
-    struct { float x, y, z, w; };
-    float e[4];
-} float4;
+    float projection[16];
+    float view[16];
+    float time;
+    float padding[3];
+} FrameUniforms;
 
-typedef union float4x4
+typedef struct ObjectUniforms
 {
-    float e[16];
-    float4 c[4];
-} float4x4;
+    float model[16];
+    float color[4];
+} ObjectUniforms;
 
-typedef struct Vertex
+typedef struct Image
 {
-    float3 position;
-    float3 normal;
-    float3 color;
-    float2 uv;
-} Vertex;
-
-float3 v3_add(float3 a, float3 b)
-{
-    return (float3){ { a.x + b.x, a.y + b.y, a.z + b.z } };
-}
-
-float3 v3_sub(float3 a, float3 b)
-{
-    return (float3){ { a.x - b.x, a.y - b.y, a.z - b.z } };
-}
-
-float3 v3_mulf(float3 a, float b)
-{
-    return (float3){ { a.x * b, a.y * b, a.z * b } };
-}
-
-float v3_dot(float3 a, float3 b)
-{
-    return a.x * b.x + a.y * b.y + a.z * b.z;
-}
-
-float v3_lenghtsq(float3 a)
-{
-    return a.x * a.x + a.y * a.y + a.z * a.z;
-}
-
-float v3_length(float3 a)
-{
-    return sqrtf(v3_lenghtsq(a));
-}
-
-float3 v3_cross(float3 a, float3 b)
-{
-    return (float3){{ a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }};
-}
-
-float3 v3_normalize(float3 a)
-{
-    float invLen = 1.f / v3_length(a);
-    return (float3){ { a.x * invLen, a.y * invLen, a.z * invLen } };
-}
+    int width;
+    int height;
+    int channels;
+    uint8_t* pixels; // stbi_load() allocated
+} Image;
 
-float3 v3_lerp(float3 a, float3 b, float t)
-{
-    return (float3){{
-        (1.f - t) * a.x + t * b.x,
-        (1.f - t) * a.y + t * b.y,
-        (1.f - t) * a.z + t * b.z,
-    }};
-}
-
-static float4x4 mat4_rotateY(float angleRadians)
-{
-    float c = cosf(angleRadians);
-    float s = sinf(angleRadians);
-    return (float4x4){{
-          c, 0.f,   s, 0.f,
-        0.f, 1.f, 0.f, 0.f,
-         -s, 0.f,   c, 0.f,
-        0.f, 0.f, 0.f, 1.f,
-    }};
-}
-
-static float4x4 mat4_frustum(float left, float right, float bottom, float top, float near, float far)
-{
-    return (float4x4){{
-        (near * 2.f) / (right - left),   0.f,                              0.f,                               0.f,
-        0.f,                             (near * 2.f)   / (top - bottom),  0.f,                               0.f,
-        (right + left) / (right - left), (top + bottom) / (top - bottom), -(far + near) / (far - near),      -1.f, 
-        0.f,                             0.f,                             -(far * near * 2.f) / (far - near), 0.f
-    }};
-}
-
-static float4x4 mat4_identity(void)
-{
-    return (float4x4){{
-        1.f, 0.f, 0.f, 0.f,
-        0.f, 1.f, 0.f, 0.f,
-        0.f, 0.f, 1.f, 0.f,
-        0.f, 0.f, 0.f, 1.f,
-    }};
-}
-
-static float4x4 mat4_perspective(float fovy, float aspect, float near, float far)
+typedef struct Game
 {
-    float top = near * tanf(fovy / 2.f);
-    float right = top * aspect;
-    return mat4_frustum(-right, right, -top, top, near, far);
-}
+    // CPU data generated by jobs in game_Init(), uploaded in game_LoadGPUData()
+    Mesh mesh; // Indices only, the vertices are packed
+    VertexFormat vertexFormat;
+    void* packedVertices;
+    Image image;
 
-Vertex* geo_genTriangleRec(Vertex* vertices, float3 a, float3 b, float3 c, int depth, float normalize)
-{
-    if (depth == 0)
-    {
-        a = v3_lerp(a, v3_normalize(a), normalize);
-        b = v3_lerp(b, v3_normalize(b), normalize);
-        c = v3_lerp(c, v3_normalize(c), normalize);
-        
-        vertices[0].position = vertices[0].normal = a;
-        vertices[1].position = vertices[1].normal = b;
-        vertices[2].position = vertices[2].normal = c;
-
-        vertices[0].uv = a.xy;
-        vertices[1].uv = b.xy;
-        vertices[2].uv = c.xy;
-
-        if (1)
-        {
-            float3 normal = v3_normalize(v3_cross(v3_sub(b, a), v3_sub(c, a)));
-            vertices[0].normal = vertices[1].normal = vertices[2].normal = normal;
-        }
 
-        for (int i = 0; i < 3; ++i)
-            vertices[i].color = (float3){{1.f, 0.f, 1.f}};
-        vertices += 3;
-    }
-    else
-    {
-        float3 mab = v3_add(a, v3_mulf(v3_sub(b, a), 0.5f));
-        float3 mbc = v3_add(b, v3_mulf(v3_sub(c, b), 0.5f));
-        float3 mca = v3_add(c, v3_mulf(v3_sub(a, c), 0.5f));
-
-        vertices = geo_genTriangleRec(vertices, a, mab, mca, depth-1, normalize);
-        vertices = geo_genTriangleRec(vertices, mab, b, mbc, depth-1, normalize);
-        vertices = geo_genTriangleRec(vertices, mca, mbc, c, depth-1, normalize);
-        vertices = geo_genTriangleRec(vertices, mca, mab, mbc, depth-1, normalize);
-    }
+    GLuint program;       // Instanced, the model and color are instance attributes
+    GLuint objectProgram; // One draw per object, the model and color are an Object uniform block
+    GLuint vao;          // Mesh only
+    GLuint instancedVao; // Mesh and instanceVbo
+    GLuint vbo;
+    GLuint ebo;
+    GLuint instanceVbo;
+    int instanceVboCapacity; // In instances
+    bool instancing;
 
-    return vertices;
-}
+    GLuint texture;
 
-Vertex* geo_genIcosahedron(Vertex* vertices, float normalize, int depth)
-{
-    // Create iscosahedron positions (radius = 1)
-    float t = 1.f + sqrtf(5.f) / 2.f; // Golden ratio
+    UniformRing uniformRing; // Frame and Object blocks
 
-    float h = t;
-    float w = 1.f;
-    
-    float r = sqrtf(1.f + t * t);
-    h /= r; // normalize h and w
-    w /= r;
+    // Simulation state, advanced by fixed steps
+    float time;
+    float prevTime;
 
-    float3 positions[] =
-    {
-        (float3){{-w, h, 0.f }},
-        (float3){{ w, h, 0.f }},
-        (float3){{-w,-h, 0.f }},
-        (float3){{ w,-h, 0.f }},
-
-        (float3){{ 0.f,-w, h }},
-        (float3){{ 0.f, w, h }},
-        (float3){{ 0.f,-w,-h }},
-        (float3){{ 0.f, w,-h }},
-
-        (float3){{ h, 0.f,-w }},
-        (float3){{ h, 0.f, w }},
-        (float3){{-h, 0.f,-w }},
-        (float3){{-h, 0.f, w }},
-    };
-    
-    // Triangles
-    int indices[] =
-    {
-         0, 11,  5,
-         0,  5,  1,
-         0,  1,  7,
-         0,  7, 10,
-         0, 10, 11,
-
-         1,  5,  9,
-         5, 11,  4,
-        11, 10,  2,
-        10,  7,  6,
-         7,  1,  8,
-
-         3,  9,  4,
-         3,  4,  2,
-         3,  2,  6,
-         3,  6,  8,
-         3,  8,  9,
-
-         4,  9,  5,
-         2,  4, 11,
-         6,  2, 10,
-         8,  6,  7,
-         9,  8,  1,
-    };
-
-    for (int i = 0; i < ARRAYSIZE(indices); i += 3)
-        vertices = geo_genTriangleRec(vertices, positions[indices[i+0]], positions[indices[i+1]], positions[indices[i+2]], depth, normalize);
-
-    return vertices;
-}
+    // Object 0 is the sphere in the middle, the others are spread on a shell around it
+    int objectCount;
+    float4x4* objectLocals; // Translation and scale, rotated as a whole each frame
+    uint32_t* objectColors; // RGBA8
+} Game;
 
 typedef struct ShaderDesc
 {
@@ -309,7 +141,8 @@ GLuint gl_CreateProgram(int shaderCount, ShaderDesc* shaderDescs)
     return program;
 }
 
-void gl_UploadTexture(const char* Filename, int* WidthOut, int* HeightOut)
+// Decoding only, can run on any thread
+bool img_Load(Image* image, const char* Filename)
 {
     // Desired channels
     int DesiredChannels = 0;
@@ -319,97 +152,200 @@ void gl_UploadTexture(const char* Filename, int* WidthOut, int* HeightOut)
 
     // Loading
     int Width, Height;
-    uint8_t* Image = stbi_load(Filename, &Width, &Height, (DesiredChannels == 0) ? &Channels : NULL, DesiredChannels);
-    if (Image == NULL)
+    uint8_t* Pixels = stbi_load(Filename, &Width, &Height, (DesiredChannels == 0) ? &Channels : NULL, DesiredChannels);
+    if (Pixels == NULL)
     {
         ALOGE("Image loading failed on '%s'", Filename);
-        return;
+        return false;
     }
 
-    GLint Format = (Channels == 3) ? GL_RGB : GL_RGBA;
-    
-    // Uploading
-    glTexImage2D(GL_TEXTURE_2D, 0, Format, Width, Height, 0, Format, GL_UNSIGNED_BYTE, Image);
-    stbi_image_free(Image);
+    image->width = Width;
+    image->height = Height;
+    image->channels = Channels;
+    image->pixels = Pixels;
 
-    if (WidthOut)
-        *WidthOut = Width;
+    ALOGV("Image loaded '%s'", Filename);
+    return true;
+}
 
-    if (HeightOut)
-        *HeightOut = Height;
+void img_Free(Image* image)
+{
+    stbi_image_free(image->pixels);
+    image->pixels = NULL;
+}
 
-    ALOGV("Image loaded '%s'", Filename);
+void gl_UploadTexture(const Image* image)
+{
+    if (image->pixels == NULL)
+        return;
+
+    GLint Format = (image->channels == 3) ? GL_RGB : GL_RGBA;
+    glTexImage2D(GL_TEXTURE_2D, 0, Format, image->width, image->height, 0, Format, GL_UNSIGNED_BYTE, image->pixels);
+}
+
+static void game_LoadImageJob(void* userData, uint32_t begin, uint32_t end)
+{
+    Game* game = userData;
+    img_Load(&game->image, "towerDefense_tilesheet.png");
+}
+
+static uint32_t color_Pack(float r, float g, float b)
+{
+    return (uint32_t)(r * 255.f + 0.5f) | ((uint32_t)(g * 255.f + 0.5f) << 8) | ((uint32_t)(b * 255.f + 0.5f) << 16) | 0xFF000000u;
 }
 
-Game* game_Init()
+void game_SetObjectCount(Game* game, int objectCount)
+{
+    assert(objectCount >= 1);
+    game->objectCount = objectCount;
+    game->objectLocals = realloc(game->objectLocals, objectCount * sizeof(float4x4));
+    game->objectColors = realloc(game->objectColors, objectCount * sizeof(uint32_t));
+
+    game->objectLocals[0] = mat4_identity();
+    game->objectColors[0] = 0xFFFFFFFFu;
+
+    // Fibonacci sphere, evenly spread whatever the count
+    int shellCount = objectCount - 1;
+    float shellScale = shellCount ? 0.5f / sqrtf((float)shellCount) : 0.f;
+    for (int i = 0; i < shellCount; ++i)
+    {
+        float y = 1.f - 2.f * (i + 0.5f) / shellCount;
+        float r = sqrtf(1.f - y * y);
+        float phi = i * 2.39996323f; // Golden angle
+        game->objectLocals[i + 1] = mat4_translateScale(v3_mulf((float3){{ cosf(phi) * r, y, sinf(phi) * r }}, 2.2f), shellScale);
+        game->objectColors[i + 1] = color_Pack(0.5f + 0.5f * cosf(phi), 0.5f + 0.5f * cosf(phi + TAU / 3.f), 0.5f + 0.5f * cosf(phi + 2.f * TAU / 3.f));
+    }
+}
+
+void game_SetInstancing(Game* game, bool instancing)
+{
+    game->instancing = instancing;
+}
+
+Game* game_Init(JobSystem* jobSystem)
 {
     ALOGV("game_Init");
     Game* game = calloc(1, sizeof(Game));
+
+    // Texture decoding runs on another worker while this one generates the geometry
+    Job* imageJob = jobSystem_CreateJob(jobSystem, game_LoadImageJob, game);
+    jobSystem_Submit(jobSystem, imageJob);
+
+    geo_genIcosphere(&game->mesh, &(IcosphereDesc){
+        .depth = ICOSAHEDRON_DEPTH,
+        .normals = ICOSAHEDRON_NORMALS,
+        .optimizeVertexCache = true,
+    });
+
+    // Constant attributes (the color) are dropped from the vertices
+    VertexFormatDesc vertexFormatDesc = g_vertexFormatCompact;
+    vertexFormat_RemoveConstants(&vertexFormatDesc, game->mesh.vertices, game->mesh.vertexCount);
+    vertexFormat_Init(&game->vertexFormat, &vertexFormatDesc);
+    game->packedVertices = malloc(game->mesh.vertexCount * game->vertexFormat.stride);
+    vertexFormat_Pack(&game->vertexFormat, game->mesh.vertices, game->mesh.vertexCount, game->packedVertices);
+    free(game->mesh.vertices);
+    game->mesh.vertices = NULL;
+    ALOGV("game->mesh: %d vertices of %d bytes (%d unpacked), %d indices", game->mesh.vertexCount, game->vertexFormat.stride,
+        (int)sizeof(Vertex), game->mesh.indexCount);
+
+    game_SetObjectCount(game, GAME_OBJECT_COUNT);
+    game->instancing = true;
+
+    jobSystem_Wait(jobSystem, imageJob);
     return game;
 }
 
 void game_Terminate(Game* game)
 {
     ALOGV("Terminate");
+    img_Free(&game->image);
+    mesh_Free(&game->mesh);
+    free(game->packedVertices);
+    free(game->objectLocals);
+    free(game->objectColors);
     free(game);
 }
 
-void game_LoadGPUData(Game* game)
+// Both draw paths share the shaders, defines pick where the model and color come from
+static GLuint game_CreateProgram(const char* defines)
 {
-    ALOGV("game_LoadGPUData");
-
     const char* shaderSourceHeader = 
         "#version 300 es\n";
 
-    game->program = gl_CreateProgram(
+    // Shared by both stages, std140 like FrameUniforms
+    const char* frameBlockSource =
+        "layout(std140) uniform Frame\n"
+        "{\n"
+        "    mat4 uProj;\n"
+        "    mat4 uView;\n"
+        "    float uTime;\n"
+        "};\n";
+
+    GLuint program = gl_CreateProgram(
         2,
         (ShaderDesc[])
         {
             {
                 GL_VERTEX_SHADER,
-                2,
+                4,
                 (const char*[])
                 {
                     shaderSourceHeader,
+                    defines,
+                    frameBlockSource,
                     "layout(location = 0) in vec3 aPosition;\n"
                     "layout(location = 1) in vec3 aNormal;\n"
                     "layout(location = 2) in vec3 aColor;\n"
                     "layout(location = 3) in vec2 aUV;\n"
-                    "uniform mat4 uProj;\n"
-                    "uniform mat4 uView;\n"
-                    "uniform mat4 uModel;\n"
+                    "#if INSTANCED\n"
+                    "layout(location = 4) in mat4 aModel;\n" // Per instance
+                    "layout(location = 8) in vec4 aInstanceColor;\n"
+                    "#define MODEL aModel\n"
+                    "#define OBJECT_COLOR aInstanceColor\n"
+                    "#else\n"
+                    "layout(std140) uniform Object\n" // Like ObjectUniforms
+                    "{\n"
+                    "    mat4 uModel;\n"
+                    "    vec4 uObjectColor;\n"
+                    "};\n"
+                    "#define MODEL uModel\n"
+                    "#define OBJECT_COLOR uObjectColor\n"
+                    "#endif\n"
                     "out vec3 vColor;\n"
                     "out vec2 vUV;\n"
                     "out vec3 vWorldNormal;\n"
-                    "uniform float uTime;\n"
+                    "out vec4 vInstanceColor;\n"
                     "void main()\n"
                     "{\n"
                     "    vColor = aColor;\n"
                     "    vUV = aUV;\n"
-                    "    vWorldNormal = (uModel * vec4(aNormal, 0.0)).xyz;\n"
-                    "    gl_Position = uProj * uView * uModel * vec4(mix(0.8, 1.3, 0.5 + 0.5 * cos(uTime * 2.0)) * aPosition, 1.0);\n"
+                    "    vInstanceColor = OBJECT_COLOR;\n"
+                    "    vWorldNormal = (MODEL * vec4(aNormal, 0.0)).xyz;\n"
+                    "    gl_Position = uProj * uView * MODEL * vec4(mix(0.8, 1.3, 0.5 + 0.5 * cos(uTime * 2.0)) * aPosition, 1.0);\n"
                     "}\n"
                 }
             },
             {
                 GL_FRAGMENT_SHADER,
-                2,
+                4,
                 (const char*[])
                 {
                     shaderSourceHeader,
-                    "precision highp float;\n"
+                    "precision highp float;\n",
+                    frameBlockSource,
                     "in vec3 vColor;\n"
                     "in vec2 vUV;\n"
                     "in vec3 vWorldNormal;\n"
+                    "in vec4 vInstanceColor;\n"
                     "out vec4 oColor;\n"
                     "uniform sampler2D uColorTexture;\n"
-                    "uniform float uTime;\n"
                     "void main()\n"
                     "{\n"
                     "    float light = max(dot(normalize(vWorldNormal), vec3(0.0, 0.0, 1.25)), 0.1);\n"
                     //"    oColor = vec4(texture(uColorTexture, vUV).rgb * light, 1.0);\n"
                     //"    oColor = vec4(vColor, 1.0);\n"
                     "    oColor = mix(vec4(vWorldNormal, 1.0), vec4(texture(uColorTexture, vUV).rgb * light, 1.0), 0.5 + 0.5 * sin(0.6 * uTime * 6.28));\n"
+                    "    oColor *= vInstanceColor;\n"
                     //"    oColor = srgbToLinear(oColor);\n"
                     //"    float gamma = 2.2;\n"
                     //"    oColor.rgb = pow(oColor.rgb, vec3(gamma));\n"
@@ -419,14 +355,25 @@ void game_LoadGPUData(Game* game)
         }
     );
 
-    game->projLocation  = glGetUniformLocation(game->program, "uProj");
-    game->viewLocation  = glGetUniformLocation(game->program, "uView");
-    game->modelLocation = glGetUniformLocation(game->program, "uModel");
-    game->timeLocation  = glGetUniformLocation(game->program, "uTime");
+    // GLSL ES 3.00 has no layout(binding), the blocks get their binding points here
+    glUniformBlockBinding(program, glGetUniformBlockIndex(program, "Frame"), UNIFORM_BINDING_FRAME);
+    GLuint objectBlock = glGetUniformBlockIndex(program, "Object");
+    if (objectBlock != GL_INVALID_INDEX)
+        glUniformBlockBinding(program, objectBlock, UNIFORM_BINDING_OBJECT);
+    return program;
+}
+
+void game_LoadGPUData(Game* game)
+{
+    ALOGV("game_LoadGPUData");
+
+    game->program = game_CreateProgram("#define INSTANCED 1\n");
+    game->objectProgram = game_CreateProgram("#define INSTANCED 0\n");
+    uniformRing_Create(&game->uniformRing, 64 * 1024);
 
     glGenTextures(1, &game->texture);
-    glBindTexture(GL_TEXTURE_2D, game->texture);
-    gl_UploadTexture("towerDefense_tilesheet.png", NULL, NULL);
+    glState_BindTexture(GL_TEXTURE_2D, game->texture);
+    gl_UploadTexture(&game->image);
     glGenerateMipmap(GL_TEXTURE_2D);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -434,63 +381,63 @@ void game_LoadGPUData(Game* game)
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, 16);
 
-#if 0
-    // TODO: Add normals
-    Vertex vertices[] = 
-    {
-        //{{-0.5f,-0.5f, 0.0f }, { 1.0f, 0.0f, 0.0f }},
-        //{{ 0.5f,-0.5f, 0.0f }, { 0.0f, 1.0f, 0.0f }},
-        //{{ 0.0f, 0.5f, 0.0f }, { 0.0f, 0.0f, 1.0f }},
-
-        {{-0.5f,-0.5f, 0.0f }, { 0.f, 1.f, 0.f }, { 0.0f, 0.0f, 0.0f }, { 0.f, 1.f }},
-        {{ 0.5f,-0.5f, 0.0f }, { 0.f, 1.f, 0.f }, { 1.0f, 1.0f, 1.0f }, { 1.f, 1.f }},
-        {{ 0.5f, 0.5f, 0.0f }, { 0.f, 1.f, 0.f }, { 1.0f, 1.0f, 1.0f }, { 1.f, 0.f }},
-
-        {{ 0.5f, 0.5f, 0.0f }, { 0.f, 1.f, 0.f }, { 1.0f, 1.0f, 1.0f }, { 1.f, 0.f }},
-        {{-0.5f, 0.5f, 0.0f }, { 0.f, 1.f, 0.f }, { 0.0f, 0.0f, 0.0f }, { 0.f, 0.f }},
-        {{-0.5f,-0.5f, 0.0f }, { 0.f, 1.f, 0.f }, { 0.0f, 0.0f, 0.0f }, { 0.f, 1.f }},
-    };
-    game->vertexCount = ARRAYSIZE(vertices);
-#else
-    Vertex* vertices = calloc(3840, sizeof(Vertex));
-    game->vertexCount = geo_genIcosahedron(vertices, 1.f, 2) - vertices;
-#endif
-    ALOGV("game->vertexCount = %d", game->vertexCount);
     glGenBuffers(1, &game->vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, game->vbo);
-    glBufferData(GL_ARRAY_BUFFER, game->vertexCount * sizeof(Vertex), vertices, GL_STATIC_DRAW);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    
-    //free(vertices);
+    glState_BindBuffer(GL_ARRAY_BUFFER, game->vbo);
+    glBufferData(GL_ARRAY_BUFFER, game->mesh.vertexCount * game->vertexFormat.stride, game->packedVertices, GL_STATIC_DRAW);
+    glState_BindBuffer(GL_ARRAY_BUFFER, 0);
 
     glGenVertexArrays(1, &game->vao);
-    glBindVertexArray(game->vao);
-    glBindBuffer(GL_ARRAY_BUFFER, game->vbo);
-    glEnableVertexAttribArray(0);
-    glEnableVertexAttribArray(1);
-    glEnableVertexAttribArray(2);
-    glEnableVertexAttribArray(3);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)OFFSETOF(Vertex, position));
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)OFFSETOF(Vertex, normal));
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)OFFSETOF(Vertex, color));
-    glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)OFFSETOF(Vertex, uv));
-    glBindVertexArray(0);
+    glState_BindVertexArray(game->vao);
+
+    // The element buffer binding is VAO state
+    glGenBuffers(1, &game->ebo);
+    glState_BindBuffer(GL_ELEMENT_ARRAY_BUFFER, game->ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, game->mesh.indexCount * sizeof(uint32_t), game->mesh.indices, GL_STATIC_DRAW);
+
+    glState_BindBuffer(GL_ARRAY_BUFFER, game->vbo);
+    vertexFormat_SetupAttribs(&game->vertexFormat);
+
+    // Same mesh, plus the per-instance model matrix and color
+    glGenBuffers(1, &game->instanceVbo);
+    game->instanceVboCapacity = 0;
+    glGenVertexArrays(1, &game->instancedVao);
+    glState_BindVertexArray(game->instancedVao);
+    glState_BindBuffer(GL_ELEMENT_ARRAY_BUFFER, game->ebo);
+    glState_BindBuffer(GL_ARRAY_BUFFER, game->vbo);
+    vertexFormat_SetupAttribs(&game->vertexFormat);
+
+    glState_BindBuffer(GL_ARRAY_BUFFER, game->instanceVbo);
+    for (int c = 0; c < 4; ++c)
+    {
+        glEnableVertexAttribArray(INSTANCE_ATTRIB_MODEL + c);
+        glVertexAttribPointer(INSTANCE_ATTRIB_MODEL + c, 4, GL_FLOAT, GL_FALSE, sizeof(GameInstance), (void*)(OFFSETOF(GameInstance, model) + c * 4 * sizeof(float)));
+        glVertexAttribDivisor(INSTANCE_ATTRIB_MODEL + c, 1);
+    }
+    glEnableVertexAttribArray(INSTANCE_ATTRIB_COLOR);
+    glVertexAttribPointer(INSTANCE_ATTRIB_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(GameInstance), (void*)OFFSETOF(GameInstance, color));
+    glVertexAttribDivisor(INSTANCE_ATTRIB_COLOR, 1);
+    glState_BindVertexArray(0);
+    glState_BindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
 void game_UnloadGPUData(Game* game)
 {
     ALOGV("game_UnloadGPUData");
-    glDeleteTextures(1, &game->texture);
-    glDeleteBuffers(1, &game->vbo);
-    glDeleteVertexArrays(1, &game->vao);
-    glDeleteProgram(game->program);
+    glState_DeleteTextures(1, &game->texture);
+    glState_DeleteBuffers(1, &game->vbo);
+    glState_DeleteBuffers(1, &game->ebo);
+    glState_DeleteBuffers(1, &game->instanceVbo);
+    glState_DeleteVertexArrays(1, &game->vao);
+    glState_DeleteVertexArrays(1, &game->instancedVao);
+    glState_DeleteProgram(game->program);
+    glState_DeleteProgram(game->objectProgram);
+    uniformRing_Destroy(&game->uniformRing);
 }
 
-void game_Update(Game* game, const GameInputs* inputs)
+void game_Update(Game* game, const GameInputs* inputs, GameFrame* frame)
 {
-    glEnable(GL_DEPTH_TEST);
-
-    glViewport(0, 0, inputs->displayWidth, inputs->displayHeight);
+    frame->viewportWidth = inputs->displayWidth;
+    frame->viewportHeight = inputs->displayHeight;
 
     float ratio = inputs->displayWidth / (float)inputs->displayHeight;
     float4x4 projection = mat4_perspective(TAU * 60.f / 360.f, ratio, 0.01f, 10.f);
@@ -501,40 +448,124 @@ void game_Update(Game* game, const GameInputs* inputs)
         0.f, 0.f,-5.f, 1.f,
     };
 
-    static float time = 0.f;
-    time += inputs->deltaTime;
+    for (int i = 0; i < inputs->stepCount; ++i)
+    {
+        game->prevTime = game->time;
+        game->time += inputs->deltaTime;
+    }
+
+    // Draw between the last two steps so motion stays smooth when the display rate is not the step rate
+    float time = game->prevTime + (game->time - game->prevTime) * inputs->alpha;
+
+    //float3 modelPos = (float3){{ (inputs->touches.x[0] / inputs->displayWidth) * 2.f - 1.f, -1.f / ratio * ((inputs->touches.y[0] / inputs->displayHeight) * 2.f - 1.f), 0.f }};
+    float4x4 rotation = mat4_rotateY(0.1f * time * TAU);
 
-    glUseProgram(game->program);
-    glUniformMatrix4fv(game->projLocation, 1, GL_FALSE, projection.e);
-    glUniformMatrix4fv(game->viewLocation, 1, GL_FALSE, view);
-    glUniform1f(game->timeLocation, time);
-    glBindTexture(GL_TEXTURE_2D, game->texture);
+    int objectCount = game->objectCount;
+    if (frame->instanceCapacity < objectCount)
+    {
+        frame->instances = realloc(frame->instances, objectCount * sizeof(GameInstance));
+        frame->instanceCapacity = objectCount;
+    }
+    vecmath_MulMatrices(&rotation, game->objectLocals, objectCount, frame->instances[0].model, sizeof(GameInstance));
+    for (int i = 0; i < objectCount; ++i)
+        memcpy(frame->instances[i].color, &game->objectColors[i], sizeof(frame->instances[i].color));
+    frame->instanceCount = objectCount;
+
+    memcpy(frame->projection, projection.e, sizeof(frame->projection));
+    memcpy(frame->view, view, sizeof(frame->view));
+    frame->time = time;
+}
 
-    glBindVertexArray(game->vao);
-    // Draw a model
+void game_Draw(Game* game, const GameFrame* frame, RenderQueue* queue)
+{
+    // Only issued when ImGui or a resize changed them
+    glState_Enable(GLStateCap_DepthTest, true);
+    glState_Viewport(0, 0, frame->viewportWidth, frame->viewportHeight);
+
+    // All the uniform blocks of the frame are written with one map of the ring
+    UniformRing* ring = &game->uniformRing;
+    int objectUniformsStride = uniformRing_AlignedSize(ring, sizeof(ObjectUniforms));
+    int objectCount = game->instancing ? 0 : frame->instanceCount;
+    uniformRing_BeginFrame(ring, uniformRing_AlignedSize(ring, sizeof(FrameUniforms)) + objectCount * objectUniformsStride);
+
+    GLintptr frameOffset = 0;
+    FrameUniforms* frameUniforms = uniformRing_Alloc(ring, sizeof(FrameUniforms), &frameOffset);
+    if (frameUniforms)
     {
-        //float3 modelPos = (float3){{ (inputs->touchX / inputs->displayWidth) * 2.f - 1.f, -1.f / ratio * ((inputs->touchY / inputs->displayHeight) * 2.f - 1.f), 0.f }};
-        float4x4 model = mat4_rotateY(0.1f * time * TAU);
+        memcpy(frameUniforms->projection, frame->projection, sizeof(frameUniforms->projection));
+        memcpy(frameUniforms->view, frame->view, sizeof(frameUniforms->view));
+        frameUniforms->time = frame->time;
+    }
 
-        glUniformMatrix4fv(game->modelLocation, 1, GL_FALSE, model.e);
-        glDrawArrays(GL_TRIANGLES, 0, game->vertexCount);
+    GLintptr objectsOffset = 0;
+    uint8_t* objectUniforms = objectCount ? uniformRing_Alloc(ring, objectCount * objectUniformsStride, &objectsOffset) : NULL;
+    if (objectUniforms)
+    {
+        for (int i = 0; i < objectCount; ++i)
+        {
+            const GameInstance* instance = &frame->instances[i];
+            ObjectUniforms* object = (ObjectUniforms*)(objectUniforms + i * objectUniformsStride);
+            memcpy(object->model, instance->model, sizeof(object->model));
+            for (int c = 0; c < 4; ++c)
+                object->color[c] = instance->color[c] / 255.f;
+        }
     }
+    uniformRing_EndFrame(ring);
 
-    // Draw hand
-    if (0)
+    // Nothing is drawn without the frame uniforms, uniformRing_BeginFrame() or uniformRing_Alloc() logged why
+    if (!frameUniforms)
+        return;
+
+    glState_BindBufferRange(GL_UNIFORM_BUFFER, UNIFORM_BINDING_FRAME, ring->buffer, frameOffset, sizeof(FrameUniforms));
+    vertexFormat_SetConstants(&game->vertexFormat);
+
+    if (game->instancing)
+    {
+        // Orphaned every frame, the driver hands out a new store instead of waiting for the previous draws
+        glState_BindBuffer(GL_ARRAY_BUFFER, game->instanceVbo);
+        if (frame->instanceCount > game->instanceVboCapacity)
+            game->instanceVboCapacity = frame->instanceCount;
+        glBufferData(GL_ARRAY_BUFFER, game->instanceVboCapacity * sizeof(GameInstance), NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, frame->instanceCount * sizeof(GameInstance), frame->instances);
+
+        RenderPacket* packet = renderQueue_Append(queue, renderKey_Make(RenderPass_Opaque, game->program, game->texture, 0.f));
+        packet->program = game->program;
+        packet->texture = game->texture;
+        packet->vao = game->instancedVao;
+        packet->mode = GL_TRIANGLES;
+        packet->count = game->mesh.indexCount;
+        packet->indexType = GL_UNSIGNED_INT;
+        packet->instanceCount = frame->instanceCount;
+    }
+    else
     {
-        for (int i = 0; i < 2; ++i)
+        // One draw per object, each binds its own range of the ring instead of uploading uniforms
+        for (int i = 0; objectUniforms && i < objectCount; ++i)
         {
-            float scale = 1.05f;
-            float model[16] = {
-                scale, 0.f, 0.f, 0.f,
-                0.f, scale, 0.f, 0.f,
-                0.f, 0.f, scale, 0.f,
-                0.f, 0.f, 0.f, 1.f,
-            };
-            
-            glUniformMatrix4fv(game->modelLocation, 1, GL_FALSE, model);
-            glDrawArrays(GL_TRIANGLES, 0, game->vertexCount);
+            // View space distance of the object's center, front to back
+            const float* model = frame->instances[i].model;
+            const float* view = frame->view;
+            float depth = -(view[2] * model[12] + view[6] * model[13] + view[10] * model[14] + view[14]);
+
+            RenderPacket* packet = renderQueue_Append(queue, renderKey_Make(RenderPass_Opaque, game->objectProgram, game->texture, depth));
+            packet->program = game->objectProgram;
+            packet->texture = game->texture;
+            packet->vao = game->vao;
+            packet->uniformBinding = UNIFORM_BINDING_OBJECT;
+            packet->uniformBuffer = ring->buffer;
+            packet->uniformOffset = objectsOffset + i * objectUniformsStride;
+            packet->uniformSize = sizeof(ObjectUniforms);
+            packet->mode = GL_TRIANGLES;
+            packet->count = game->mesh.indexCount;
+            packet->indexType = GL_UNSIGNED_INT;
         }
     }
 }
+
+void game_FreeFrame(GameFrame* frame)
+{
+    free(frame->instances);
+    frame->instances = NULL;
+    frame->instanceCount = 0;
+    frame->instanceCapacity = 0;
+}
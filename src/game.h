@@ -1,18 +1,57 @@
+#pragma once
+#include "gesture.h"
+#include "touch_state.h"
 
 typedef struct GameInputs
 {
     int displayWidth;
     int displayHeight;
 
-    float deltaTime;
+    // Fixed timestep simulation, see FrameClock
+    float deltaTime;      // Duration of one simulation step
+    int stepCount;        // Steps to simulate this frame, can be 0 on fast displays
+    float alpha;          // Interpolation between the last two simulated states for drawing
+    float frameDeltaTime; // Measured, for what does not need to be deterministic
 
-    float touchX;
-    float touchY;
+    TouchState touches;     // Snapshot at the start of the frame
+    GestureFrame gestures;  // Recognized since the previous frame
 } GameInputs;
 
+// Per-object data streamed to the instance buffer
+typedef struct GameInstance
+{
+    float model[16];
+    uint8_t color[4]; // RGBA, multiplies the shaded color
+} GameInstance;
+
+// Everything game_Draw() needs, filled by game_Update() without any GL call
+// Starts zeroed, owns its instances once game_Update() allocated them, see game_FreeFrame()
+typedef struct GameFrame
+{
+    int viewportWidth;
+    int viewportHeight;
+
+    float projection[16];
+    float view[16];
+    float time;
+
+    GameInstance* instances; // One per object
+    int instanceCount;
+    int instanceCapacity;
+} GameFrame;
+
+typedef struct JobSystem JobSystem;
+typedef struct RenderQueue RenderQueue;
+
 typedef struct Game Game;
-Game* game_Init();
+Game* game_Init(JobSystem* jobSystem); // Generates geometry while a job decodes textures
 void game_Terminate(Game* game);
 void game_LoadGPUData(Game* game);
 void game_UnloadGPUData(Game* game);
-void game_Update(Game* game, const GameInputs* inputs);
+void game_Update(Game* game, const GameInputs* inputs, GameFrame* frame); // Simulation only, can run on any thread
+void game_Draw(Game* game, const GameFrame* frame, RenderQueue* queue); // GL thread, uploads the frame and appends its draws
+void game_FreeFrame(GameFrame* frame);
+
+// Scene size and draw path, for tools/scene_bench
+void game_SetObjectCount(Game* game, int objectCount);
+void game_SetInstancing(Game* game, bool instancing); // One instanced draw for all objects (default) or one draw per object
@@ -0,0 +1,487 @@
+
+#include <stdlib.h> // malloc/calloc/free
+#include <string.h> // memcpy/memset
+#include <limits.h> // INT_MIN
+#include <assert.h> // assert
+
+#include "common.h"
+#include "job_system.h"
+#include "geometry.h"
+
+static const float3 g_meshColor = {{ 1.f, 0.f, 1.f }};
+
+// Triangles of the unit icosahedron, counter-clockwise seen from outside
+static const uint32_t g_icosahedronIndices[ICOSAHEDRON_FACE_COUNT * 3] =
+{
+     0, 11,  5,
+     0,  5,  1,
+     0,  1,  7,
+     0,  7, 10,
+     0, 10, 11,
+
+     1,  5,  9,
+     5, 11,  4,
+    11, 10,  2,
+    10,  7,  6,
+     7,  1,  8,
+
+     3,  9,  4,
+     3,  4,  2,
+     3,  2,  6,
+     3,  6,  8,
+     3,  8,  9,
+
+     4,  9,  5,
+     2,  4, 11,
+     6,  2, 10,
+     8,  6,  7,
+     9,  8,  1,
+};
+
+static void geo_getIcosahedronPositions(float3 positions[12])
+{
+    // Create iscosahedron positions (radius = 1)
+    float t = (1.f + sqrtf(5.f)) / 2.f; // Golden ratio
+
+    float h = t;
+    float w = 1.f;
+
+    float r = sqrtf(1.f + t * t);
+    h /= r; // normalize h and w
+    w /= r;
+
+    positions[0]  = (float3){{-w, h, 0.f }};
+    positions[1]  = (float3){{ w, h, 0.f }};
+    positions[2]  = (float3){{-w,-h, 0.f }};
+    positions[3]  = (float3){{ w,-h, 0.f }};
+
+    positions[4]  = (float3){{ 0.f,-w, h }};
+    positions[5]  = (float3){{ 0.f, w, h }};
+    positions[6]  = (float3){{ 0.f,-w,-h }};
+    positions[7]  = (float3){{ 0.f, w,-h }};
+
+    positions[8]  = (float3){{ h, 0.f,-w }};
+    positions[9]  = (float3){{ h, 0.f, w }};
+    positions[10] = (float3){{-h, 0.f,-w }};
+    positions[11] = (float3){{-h, 0.f, w }};
+}
+
+void mesh_Free(Mesh* mesh)
+{
+    free(mesh->vertices);
+    free(mesh->indices);
+    *mesh = (Mesh){ 0 };
+}
+
+/*
+================================================================================
+Indexed icosphere
+================================================================================
+*/
+
+// Index of the vertex created in the middle of each edge, so both triangles sharing the edge use the same one
+// Open addressing, keys are (min << 32 | max) and never 0 since both ends differ
+typedef struct EdgeCache
+{
+    uint64_t* keys;
+    uint32_t* values;
+    uint32_t mask;
+    int shift;
+} EdgeCache;
+
+static bool edgeCache_Init(EdgeCache* cache, int maxEdgeCount)
+{
+    int bits = 4;
+    while ((1 << bits) < 2 * maxEdgeCount) // At most half full
+        ++bits;
+    cache->keys = malloc(sizeof(uint64_t) << bits);
+    cache->values = malloc(sizeof(uint32_t) << bits);
+    cache->mask = (1u << bits) - 1;
+    cache->shift = 64 - bits;
+    return cache->keys && cache->values;
+}
+
+static void edgeCache_Clear(EdgeCache* cache)
+{
+    memset(cache->keys, 0, sizeof(uint64_t) * (cache->mask + 1));
+}
+
+static void edgeCache_Free(EdgeCache* cache)
+{
+    free(cache->keys);
+    free(cache->values);
+}
+
+static uint32_t edgeCache_GetMidpoint(EdgeCache* cache, float3* positions, int* positionCount, uint32_t a, uint32_t b)
+{
+    uint64_t key = a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+    uint32_t slot = (uint32_t)((key * 0x9E3779B97F4A7C15ull) >> cache->shift);
+    while (cache->keys[slot] != 0)
+    {
+        if (cache->keys[slot] == key)
+            return cache->values[slot];
+        slot = (slot + 1) & cache->mask;
+    }
+
+    uint32_t index = (*positionCount)++;
+    positions[index] = v3_normalize(v3_add(positions[a], positions[b]));
+    cache->keys[slot] = key;
+    cache->values[slot] = index;
+    return index;
+}
+
+int geo_getIcosphereVertexCount(int depth, GeoNormals normals)
+{
+    // V = 10 * 4^depth + 2 for a closed sphere (Euler: V - E + F = 2)
+    if (normals == GeoNormals_Flat)
+        return geo_getIcosphereIndexCount(depth);
+    return 10 * (1 << (2 * depth)) + 2;
+}
+
+int geo_getIcosphereIndexCount(int depth)
+{
+    return ICOSAHEDRON_FACE_COUNT * 3 * (1 << (2 * depth));
+}
+
+bool geo_genIcosphere(Mesh* mesh, const IcosphereDesc* desc)
+{
+    assert(desc->depth >= 0 && desc->depth <= 10);
+
+    *mesh = (Mesh){ 0 };
+    int positionCount = 12;
+    int maxPositionCount = geo_getIcosphereVertexCount(desc->depth, GeoNormals_Smooth);
+    int maxIndexCount = geo_getIcosphereIndexCount(desc->depth);
+
+    float3* positions = malloc(maxPositionCount * sizeof(float3));
+    uint32_t* indices = malloc(maxIndexCount * sizeof(uint32_t));
+    uint32_t* nextIndices = malloc(maxIndexCount * sizeof(uint32_t));
+    if (!positions || !indices || !nextIndices)
+    {
+        ALOGE("geo_genIcosphere() depth %d, out of memory", desc->depth);
+        free(positions);
+        free(indices);
+        free(nextIndices);
+        return false;
+    }
+
+    geo_getIcosahedronPositions(positions);
+    memcpy(indices, g_icosahedronIndices, sizeof(g_icosahedronIndices));
+    int indexCount = ICOSAHEDRON_FACE_COUNT * 3;
+
+    // The last level splits the most edges, 3 per triangle shared by 2 triangles
+    EdgeCache edgeCache = { 0 };
+    if (desc->depth > 0 && !edgeCache_Init(&edgeCache, (maxIndexCount / 4) / 2))
+    {
+        ALOGE("geo_genIcosphere() depth %d, out of memory", desc->depth);
+        edgeCache_Free(&edgeCache);
+        free(positions);
+        free(indices);
+        free(nextIndices);
+        return false;
+    }
+
+    for (int level = 0; level < desc->depth; ++level)
+    {
+        edgeCache_Clear(&edgeCache);
+
+        uint32_t* dst = nextIndices;
+        for (int i = 0; i < indexCount; i += 3)
+        {
+            uint32_t a = indices[i + 0];
+            uint32_t b = indices[i + 1];
+            uint32_t c = indices[i + 2];
+            uint32_t mab = edgeCache_GetMidpoint(&edgeCache, positions, &positionCount, a, b);
+            uint32_t mbc = edgeCache_GetMidpoint(&edgeCache, positions, &positionCount, b, c);
+            uint32_t mca = edgeCache_GetMidpoint(&edgeCache, positions, &positionCount, c, a);
+
+            // Same split as geo_genTriangleRec()
+            *dst++ = a;   *dst++ = mab; *dst++ = mca;
+            *dst++ = mab; *dst++ = b;   *dst++ = mbc;
+            *dst++ = mca; *dst++ = mbc; *dst++ = c;
+            *dst++ = mca; *dst++ = mab; *dst++ = mbc;
+        }
+        indexCount *= 4;
+
+        uint32_t* swap = indices;
+        indices = nextIndices;
+        nextIndices = swap;
+    }
+    assert(positionCount == maxPositionCount && indexCount == maxIndexCount);
+
+    edgeCache_Free(&edgeCache);
+    free(nextIndices);
+
+    if (desc->optimizeVertexCache && desc->normals == GeoNormals_Smooth)
+        geo_optimizeVertexCache(indices, indexCount, positionCount, GEO_VERTEX_CACHE_SIZE);
+
+    // One vertex per position when smooth, per corner when flat
+    Vertex* vertices = malloc((desc->normals == GeoNormals_Smooth ? positionCount : indexCount) * sizeof(Vertex));
+    if (!vertices)
+    {
+        ALOGE("geo_genIcosphere() depth %d, out of memory", desc->depth);
+        free(positions);
+        free(indices);
+        return false;
+    }
+
+    if (desc->normals == GeoNormals_Smooth)
+    {
+        for (int i = 0; i < positionCount; ++i)
+        {
+            float3 p = positions[i];
+            vertices[i] = (Vertex){ p, p, g_meshColor, p.xy };
+        }
+        mesh->vertices = vertices;
+        mesh->vertexCount = positionCount;
+    }
+    else
+    {
+        // Expanded to one vertex per corner, the index buffer becomes sequential
+        for (int i = 0; i < indexCount; i += 3)
+        {
+            float3 a = positions[indices[i + 0]];
+            float3 b = positions[indices[i + 1]];
+            float3 c = positions[indices[i + 2]];
+            float3 normal = v3_normalize(v3_cross(v3_sub(b, a), v3_sub(c, a)));
+            vertices[i + 0] = (Vertex){ a, normal, g_meshColor, a.xy };
+            vertices[i + 1] = (Vertex){ b, normal, g_meshColor, b.xy };
+            vertices[i + 2] = (Vertex){ c, normal, g_meshColor, c.xy };
+        }
+        for (int i = 0; i < indexCount; ++i)
+            indices[i] = i;
+        mesh->vertices = vertices;
+        mesh->vertexCount = indexCount;
+    }
+
+    free(positions);
+    mesh->indices = indices;
+    mesh->indexCount = indexCount;
+    return true;
+}
+
+/*
+================================================================================
+Vertex cache optimization
+================================================================================
+*/
+
+// Tipsify: fans around a vertex, then moves to the most recently used neighbor which
+// still has triangles left and stays in the cache, or to a dead end vertex when none does
+void geo_optimizeVertexCache(uint32_t* indices, int indexCount, int vertexCount, int cacheSize)
+{
+    int triangleCount = indexCount / 3;
+
+    int* liveCount = calloc(vertexCount, sizeof(int));      // Triangles not emitted yet, per vertex
+    int* adjacencyOffset = malloc((vertexCount + 1) * sizeof(int));
+    int* adjacency = malloc(indexCount * sizeof(int));      // Triangles of each vertex
+    int* cacheTime = calloc(vertexCount, sizeof(int));      // Timestamp when the vertex entered the cache
+    int* deadEnds = malloc(indexCount * sizeof(int));       // Stack of recently used vertices
+    bool* emitted = calloc(triangleCount, sizeof(bool));
+    uint32_t* output = malloc(indexCount * sizeof(uint32_t));
+
+    for (int i = 0; i < indexCount; ++i)
+        liveCount[indices[i]]++;
+
+    int maxLiveCount = 0;
+    adjacencyOffset[0] = 0;
+    for (int v = 0; v < vertexCount; ++v)
+    {
+        adjacencyOffset[v + 1] = adjacencyOffset[v] + liveCount[v];
+        if (liveCount[v] > maxLiveCount)
+            maxLiveCount = liveCount[v];
+    }
+
+    // cacheTime is the fill cursor while building the adjacency
+    for (int i = 0; i < indexCount; ++i)
+    {
+        uint32_t v = indices[i];
+        adjacency[adjacencyOffset[v] + cacheTime[v]++] = i / 3;
+    }
+    memset(cacheTime, 0, vertexCount * sizeof(int));
+
+    int* candidates = malloc(3 * maxLiveCount * sizeof(int));
+
+    int time = cacheSize + 1;
+    int cursor = 0;
+    int deadEndCount = 0;
+    int outputCount = 0;
+    int fanning = 0;
+    while (fanning >= 0)
+    {
+        int candidateCount = 0;
+        for (int a = adjacencyOffset[fanning]; a < adjacencyOffset[fanning + 1]; ++a)
+        {
+            int t = adjacency[a];
+            if (emitted[t])
+                continue;
+            emitted[t] = true;
+
+            for (int k = 0; k < 3; ++k)
+            {
+                uint32_t v = indices[t * 3 + k];
+                output[outputCount++] = v;
+                deadEnds[deadEndCount++] = v;
+                candidates[candidateCount++] = v;
+                liveCount[v]--;
+                if (time - cacheTime[v] > cacheSize)
+                    cacheTime[v] = time++;
+            }
+        }
+
+        // Oldest candidate still in the cache once its remaining triangles are fanned
+        int next = -1;
+        int bestPriority = -1;
+        for (int i = 0; i < candidateCount; ++i)
+        {
+            int v = candidates[i];
+            if (liveCount[v] <= 0)
+                continue;
+
+            int priority = 0;
+            if (time - cacheTime[v] + 2 * liveCount[v] <= cacheSize)
+                priority = time - cacheTime[v];
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                next = v;
+            }
+        }
+
+        if (next < 0)
+        {
+            while (deadEndCount > 0 && next < 0)
+            {
+                int v = deadEnds[--deadEndCount];
+                if (liveCount[v] > 0)
+                    next = v;
+            }
+            while (cursor < vertexCount && next < 0)
+            {
+                if (liveCount[cursor] > 0)
+                    next = cursor;
+                ++cursor;
+            }
+        }
+        fanning = next;
+    }
+    assert(outputCount == triangleCount * 3);
+
+    memcpy(indices, output, outputCount * sizeof(uint32_t));
+
+    free(liveCount);
+    free(adjacencyOffset);
+    free(adjacency);
+    free(cacheTime);
+    free(deadEnds);
+    free(emitted);
+    free(output);
+    free(candidates);
+}
+
+float geo_computeACMR(const uint32_t* indices, int indexCount, int vertexCount, int cacheSize)
+{
+    // FIFO: a vertex is still cached if less than cacheSize misses happened since it was loaded
+    int* loadTime = malloc(vertexCount * sizeof(int));
+    for (int v = 0; v < vertexCount; ++v)
+        loadTime[v] = INT_MIN / 2;
+
+    int misses = 0;
+    for (int i = 0; i < indexCount; ++i)
+    {
+        uint32_t v = indices[i];
+        if (misses - loadTime[v] >= cacheSize)
+            loadTime[v] = misses++;
+    }
+
+    free(loadTime);
+    return misses / (float)(indexCount / 3);
+}
+
+/*
+================================================================================
+Triangle soup
+================================================================================
+*/
+
+static Vertex* geo_genTriangleRec(Vertex* vertices, float3 a, float3 b, float3 c, int depth, float normalize)
+{
+    if (depth == 0)
+    {
+        a = v3_lerp(a, v3_normalize(a), normalize);
+        b = v3_lerp(b, v3_normalize(b), normalize);
+        c = v3_lerp(c, v3_normalize(c), normalize);
+
+        vertices[0].position = vertices[0].normal = a;
+        vertices[1].position = vertices[1].normal = b;
+        vertices[2].position = vertices[2].normal = c;
+
+        vertices[0].uv = a.xy;
+        vertices[1].uv = b.xy;
+        vertices[2].uv = c.xy;
+
+        if (1)
+        {
+            float3 normal = v3_normalize(v3_cross(v3_sub(b, a), v3_sub(c, a)));
+            vertices[0].normal = vertices[1].normal = vertices[2].normal = normal;
+        }
+
+        for (int i = 0; i < 3; ++i)
+            vertices[i].color = g_meshColor;
+        vertices += 3;
+    }
+    else
+    {
+        float3 mab = v3_add(a, v3_mulf(v3_sub(b, a), 0.5f));
+        float3 mbc = v3_add(b, v3_mulf(v3_sub(c, b), 0.5f));
+        float3 mca = v3_add(c, v3_mulf(v3_sub(a, c), 0.5f));
+
+        vertices = geo_genTriangleRec(vertices, a, mab, mca, depth-1, normalize);
+        vertices = geo_genTriangleRec(vertices, mab, b, mbc, depth-1, normalize);
+        vertices = geo_genTriangleRec(vertices, mca, mbc, c, depth-1, normalize);
+        vertices = geo_genTriangleRec(vertices, mca, mab, mbc, depth-1, normalize);
+    }
+
+    return vertices;
+}
+
+typedef struct IcosahedronDesc
+{
+    Vertex* vertices;
+    float normalize;
+    int depth;
+} IcosahedronDesc;
+
+static int geo_getIcosahedronFaceVertexCount(int depth)
+{
+    // Each subdivision splits a triangle in 4
+    return 3 << (2 * depth);
+}
+
+int geo_getIcosahedronSoupVertexCount(int depth)
+{
+    return ICOSAHEDRON_FACE_COUNT * geo_getIcosahedronFaceVertexCount(depth);
+}
+
+// JobFunc generating the faces [begin, end) of the icosahedron, each face writes its own slice of vertices
+static void geo_genIcosahedronFaces(void* userData, uint32_t begin, uint32_t end)
+{
+    const IcosahedronDesc* desc = userData;
+
+    float3 positions[12];
+    geo_getIcosahedronPositions(positions);
+
+    int faceVertexCount = geo_getIcosahedronFaceVertexCount(desc->depth);
+    for (uint32_t face = begin; face < end; ++face)
+    {
+        const uint32_t* indices = g_icosahedronIndices + face * 3;
+        Vertex* vertices = desc->vertices + face * faceVertexCount;
+        geo_genTriangleRec(vertices, positions[indices[0]], positions[indices[1]], positions[indices[2]], desc->depth, desc->normalize);
+    }
+}
+
+Vertex* geo_genIcosahedron(JobSystem* jobSystem, Vertex* vertices, float normalize, int depth)
+{
+    IcosahedronDesc desc = { vertices, normalize, depth };
+    jobSystem_ParallelFor(jobSystem, ICOSAHEDRON_FACE_COUNT, 1, geo_genIcosahedronFaces, &desc);
+    return vertices + geo_getIcosahedronSoupVertexCount(depth);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "math3d.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Procedural meshes, CPU only: no GL call, can run on any thread and on the host (tools/geo_bench)
+
+#define ICOSAHEDRON_FACE_COUNT 20
+#define GEO_VERTEX_CACHE_SIZE 32 // Post-transform cache size assumed by geo_optimizeVertexCache(), mobile GPUs have 16 to 32 entries
+
+typedef struct Vertex
+{
+    float3 position;
+    float3 normal;
+    float3 color;
+    float2 uv;
+} Vertex;
+
+typedef enum GeoNormals
+{
+    GeoNormals_Smooth, // Vertices shared by all their triangles, normal = position on the unit sphere
+    GeoNormals_Flat,   // Face normals, each triangle has its own 3 vertices and the indices are sequential
+} GeoNormals;
+
+// Indexed triangle list, allocated by the generators
+typedef struct Mesh
+{
+    Vertex* vertices;
+    uint32_t* indices;
+    int vertexCount;
+    int indexCount;
+} Mesh;
+
+void mesh_Free(Mesh* mesh);
+
+typedef struct IcosphereDesc
+{
+    int depth; // Each subdivision splits every triangle in 4
+    GeoNormals normals;
+    bool optimizeVertexCache;
+} IcosphereDesc;
+
+int geo_getIcosphereVertexCount(int depth, GeoNormals normals);
+int geo_getIcosphereIndexCount(int depth);
+
+// Welded unit sphere: edge midpoints are shared through a cache instead of being generated once per triangle
+bool geo_genIcosphere(Mesh* mesh, const IcosphereDesc* desc);
+
+// Reorders triangles in place so consecutive ones reuse transformed vertices (Tipsify, Sander et al. 2007)
+void geo_optimizeVertexCache(uint32_t* indices, int indexCount, int vertexCount, int cacheSize);
+
+// Average transformed vertices per triangle with a FIFO cache of cacheSize entries, 0.5 is the best a big mesh can do, 3 the worst
+float geo_computeACMR(const uint32_t* indices, int indexCount, int vertexCount, int cacheSize);
+
+// Non-indexed triangle soup with flat normals (the previous generator), kept as a reference for tools/geo_bench
+typedef struct JobSystem JobSystem;
+int geo_getIcosahedronSoupVertexCount(int depth);
+Vertex* geo_genIcosahedron(JobSystem* jobSystem, Vertex* vertices, float normalize, int depth);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,400 @@
+
+#include <math.h> // sqrtf
+
+#include "common.h"
+#include "timing.h"
+#include "gesture.h"
+
+#define GESTURE_VELOCITY_WINDOW_NS (100 * TIME_NS_PER_MS)
+
+const char* gestureTypeStr[GestureType_Count] =
+{
+    "Tap",
+    "DoubleTap",
+    "LongPress",
+    "Drag",
+    "Fling",
+    "Pinch",
+};
+
+static float gesture_Distance(float x0, float y0, float x1, float y1)
+{
+    return sqrtf((x1 - x0) * (x1 - x0) + (y1 - y0) * (y1 - y0));
+}
+
+static void gestureRecognizer_Emit(GestureRecognizer* recognizer, Gesture gesture)
+{
+    GestureFrame* frame = &recognizer->frame;
+    if (gesture.phase == GesturePhase_Changed && frame->count > 0)
+    {
+        Gesture* last = &frame->gestures[frame->count - 1];
+        if (last->type == gesture.type && last->phase == GesturePhase_Changed)
+        {
+            last->x = gesture.x;
+            last->y = gesture.y;
+            last->dx += gesture.dx;
+            last->dy += gesture.dy;
+            last->scale *= gesture.scale;
+            return;
+        }
+    }
+
+    if (frame->count == GESTURE_MAX_PER_FRAME)
+    {
+        frame->droppedCount++;
+        return;
+    }
+    frame->gestures[frame->count++] = gesture;
+}
+
+static void gestureRecognizer_EmitAt(GestureRecognizer* recognizer, GestureType type, GesturePhase phase, float x, float y)
+{
+    gestureRecognizer_Emit(recognizer, (Gesture){ .type = type, .phase = phase, .x = x, .y = y, .scale = 1.f });
+}
+
+/*
+================================================================================
+Velocity
+================================================================================
+*/
+
+static void gestureRecognizer_AddVelocitySample(GestureRecognizer* recognizer, int64_t time, float x, float y)
+{
+    int i = (recognizer->velocityHead + recognizer->velocityCount) % GESTURE_VELOCITY_SAMPLES;
+    if (recognizer->velocityCount == GESTURE_VELOCITY_SAMPLES)
+        recognizer->velocityHead = (recognizer->velocityHead + 1) % GESTURE_VELOCITY_SAMPLES;
+    else
+        recognizer->velocityCount++;
+
+    recognizer->velocityTime[i] = time;
+    recognizer->velocityX[i] = x;
+    recognizer->velocityY[i] = y;
+}
+
+// Over the samples of the last GESTURE_VELOCITY_WINDOW_NS, 0 if there are not two of them
+static void gestureRecognizer_GetVelocity(const GestureRecognizer* recognizer, float* vx, float* vy)
+{
+    *vx = *vy = 0.f;
+    if (recognizer->velocityCount < 2)
+        return;
+
+    int newest = (recognizer->velocityHead + recognizer->velocityCount - 1) % GESTURE_VELOCITY_SAMPLES;
+    int oldest = newest;
+    for (int n = 1; n < recognizer->velocityCount; ++n)
+    {
+        int i = (newest + GESTURE_VELOCITY_SAMPLES - n) % GESTURE_VELOCITY_SAMPLES;
+        if (recognizer->velocityTime[newest] - recognizer->velocityTime[i] > GESTURE_VELOCITY_WINDOW_NS)
+            break;
+        oldest = i;
+    }
+
+    int64_t dt = recognizer->velocityTime[newest] - recognizer->velocityTime[oldest];
+    if (dt <= 0)
+        return;
+
+    float seconds = (float)time_ToSeconds(dt);
+    *vx = (recognizer->velocityX[newest] - recognizer->velocityX[oldest]) / seconds;
+    *vy = (recognizer->velocityY[newest] - recognizer->velocityY[oldest]) / seconds;
+}
+
+/*
+================================================================================
+State machine
+================================================================================
+*/
+
+void gestureRecognizer_Init(GestureRecognizer* recognizer, const GestureDesc* desc)
+{
+    *recognizer = (GestureRecognizer){ .desc = *desc };
+    if (recognizer->desc.touchSlop == 0.f)
+        recognizer->desc.touchSlop = 24.f;
+    if (recognizer->desc.tapTimeoutNs == 0)
+        recognizer->desc.tapTimeoutNs = 300 * TIME_NS_PER_MS;
+    if (recognizer->desc.doubleTapTimeoutNs == 0)
+        recognizer->desc.doubleTapTimeoutNs = 300 * TIME_NS_PER_MS;
+    if (recognizer->desc.longPressTimeoutNs == 0)
+        recognizer->desc.longPressTimeoutNs = 500 * TIME_NS_PER_MS;
+    if (recognizer->desc.minFlingVelocity == 0.f)
+        recognizer->desc.minFlingVelocity = 150.f;
+}
+
+void gestureRecognizer_Cancel(GestureRecognizer* recognizer)
+{
+    if (recognizer->state == GestureState_Dragging || recognizer->state == GestureState_Pinching)
+    {
+        gestureRecognizer_Emit(recognizer, (Gesture){
+            .type = recognizer->state == GestureState_Dragging ? GestureType_Drag : GestureType_Pinch,
+            .phase = GesturePhase_Ended,
+            .canceled = 1,
+            .x = recognizer->lastX,
+            .y = recognizer->lastY,
+            .scale = 1.f,
+        });
+    }
+    recognizer->state = GestureState_Idle;
+    recognizer->lastTapTime = 0;
+}
+
+void gestureRecognizer_Update(GestureRecognizer* recognizer, int64_t time)
+{
+    if (recognizer->state == GestureState_Pressed && time - recognizer->downTime >= recognizer->desc.longPressTimeoutNs)
+    {
+        gestureRecognizer_EmitAt(recognizer, GestureType_LongPress, GesturePhase_Ended, recognizer->downX, recognizer->downY);
+        recognizer->state = GestureState_LongPressed;
+        recognizer->lastTapTime = 0;
+    }
+}
+
+void gestureRecognizer_TakeFrame(GestureRecognizer* recognizer, GestureFrame* frame)
+{
+    *frame = recognizer->frame;
+    recognizer->frame.count = 0;
+    recognizer->frame.droppedCount = 0;
+}
+
+// One position of the dragging pointer, from the history or the current sample
+static void gestureRecognizer_HandleSample(GestureRecognizer* recognizer, int64_t time, float x, float y)
+{
+    gestureRecognizer_Update(recognizer, time);
+
+    switch (recognizer->state)
+    {
+        case GestureState_Pressed:
+        case GestureState_LongPressed:
+            gestureRecognizer_AddVelocitySample(recognizer, time, x, y);
+            if (gesture_Distance(recognizer->downX, recognizer->downY, x, y) > recognizer->desc.touchSlop)
+            {
+                // The movement within the slop is part of the first record
+                gestureRecognizer_Emit(recognizer, (Gesture){
+                    .type = GestureType_Drag,
+                    .phase = GesturePhase_Began,
+                    .x = x, .y = y,
+                    .dx = x - recognizer->downX, .dy = y - recognizer->downY,
+                    .scale = 1.f,
+                });
+                recognizer->lastX = x;
+                recognizer->lastY = y;
+                recognizer->state = GestureState_Dragging;
+                recognizer->lastTapTime = 0;
+            }
+            break;
+
+        case GestureState_Dragging:
+            gestureRecognizer_AddVelocitySample(recognizer, time, x, y);
+            if (x != recognizer->lastX || y != recognizer->lastY)
+            {
+                gestureRecognizer_Emit(recognizer, (Gesture){
+                    .type = GestureType_Drag,
+                    .phase = GesturePhase_Changed,
+                    .x = x, .y = y,
+                    .dx = x - recognizer->lastX, .dy = y - recognizer->lastY,
+                    .scale = 1.f,
+                });
+                recognizer->lastX = x;
+                recognizer->lastY = y;
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+static void gestureRecognizer_HandlePinchSample(GestureRecognizer* recognizer, float x0, float y0, float x1, float y1)
+{
+    float x = (x0 + x1) * 0.5f;
+    float y = (y0 + y1) * 0.5f;
+    float span = gesture_Distance(x0, y0, x1, y1);
+    if (x == recognizer->lastX && y == recognizer->lastY && span == recognizer->lastSpan)
+        return;
+
+    gestureRecognizer_Emit(recognizer, (Gesture){
+        .type = GestureType_Pinch,
+        .phase = GesturePhase_Changed,
+        .x = x, .y = y,
+        .dx = x - recognizer->lastX, .dy = y - recognizer->lastY,
+        .scale = recognizer->lastSpan > 0.f ? span / recognizer->lastSpan : 1.f,
+    });
+    recognizer->lastX = x;
+    recognizer->lastY = y;
+    recognizer->lastSpan = span;
+}
+
+// Every sample of the event, oldest first
+static void gestureRecognizer_HandleSamples(GestureRecognizer* recognizer, const MotionEvent* motionEvent)
+{
+    int pointerCount = motionEvent->pointerCount;
+    int p0 = motionEvent_FindPointer(motionEvent, recognizer->pointerId[0]);
+    if (p0 < 0)
+        return;
+
+    if (recognizer->state == GestureState_Pinching)
+    {
+        int p1 = motionEvent_FindPointer(motionEvent, recognizer->pointerId[1]);
+        if (p1 < 0)
+            return;
+        for (int i = 0; i < motionEvent->historySize; ++i)
+        {
+            const float* hx = motionEvent->historyX + i * pointerCount;
+            const float* hy = motionEvent->historyY + i * pointerCount;
+            gestureRecognizer_HandlePinchSample(recognizer, hx[p0], hy[p0], hx[p1], hy[p1]);
+        }
+        gestureRecognizer_HandlePinchSample(recognizer, motionEvent->x[p0], motionEvent->y[p0], motionEvent->x[p1], motionEvent->y[p1]);
+        return;
+    }
+
+    for (int i = 0; i < motionEvent->historySize; ++i)
+        gestureRecognizer_HandleSample(recognizer, motionEvent->historyTime[i],
+            motionEvent->historyX[i * pointerCount + p0], motionEvent->historyY[i * pointerCount + p0]);
+    gestureRecognizer_HandleSample(recognizer, motionEvent->eventTime, motionEvent->x[p0], motionEvent->y[p0]);
+}
+
+static void gestureRecognizer_Down(GestureRecognizer* recognizer, const MotionEvent* motionEvent)
+{
+    if (recognizer->state != GestureState_Idle)
+        gestureRecognizer_Cancel(recognizer); // Missed the previous up
+
+    float x = motionEvent->x[0];
+    float y = motionEvent->y[0];
+    recognizer->state = GestureState_Pressed;
+    recognizer->pointerId[0] = motionEvent->pointerId[0];
+    recognizer->downTime = motionEvent->eventTime;
+    recognizer->downX = recognizer->lastX = x;
+    recognizer->downY = recognizer->lastY = y;
+    recognizer->velocityCount = 0;
+    recognizer->velocityHead = 0;
+    gestureRecognizer_AddVelocitySample(recognizer, motionEvent->eventTime, x, y);
+
+    // Too late for a double tap, the first tap stays a tap
+    if (recognizer->lastTapTime != 0 && motionEvent->eventTime - recognizer->lastTapTime > recognizer->desc.doubleTapTimeoutNs)
+        recognizer->lastTapTime = 0;
+}
+
+static void gestureRecognizer_PointerDown(GestureRecognizer* recognizer, const MotionEvent* motionEvent, int index)
+{
+    if (recognizer->state != GestureState_Pressed && recognizer->state != GestureState_LongPressed
+        && recognizer->state != GestureState_Dragging)
+        return; // Third pointer of a pinch, or the gesture is over
+
+    int p0 = motionEvent_FindPointer(motionEvent, recognizer->pointerId[0]);
+    if (p0 < 0 || p0 == index)
+    {
+        gestureRecognizer_Cancel(recognizer);
+        recognizer->state = GestureState_Finished;
+        return;
+    }
+
+    if (recognizer->state == GestureState_Dragging)
+    {
+        gestureRecognizer_Emit(recognizer, (Gesture){ .type = GestureType_Drag, .phase = GesturePhase_Ended, .canceled = 1,
+            .x = recognizer->lastX, .y = recognizer->lastY, .scale = 1.f });
+    }
+
+    float x0 = motionEvent->x[p0], y0 = motionEvent->y[p0];
+    float x1 = motionEvent->x[index], y1 = motionEvent->y[index];
+    recognizer->state = GestureState_Pinching;
+    recognizer->pointerId[1] = motionEvent->pointerId[index];
+    recognizer->lastX = (x0 + x1) * 0.5f;
+    recognizer->lastY = (y0 + y1) * 0.5f;
+    recognizer->lastSpan = gesture_Distance(x0, y0, x1, y1);
+    recognizer->lastTapTime = 0;
+    gestureRecognizer_EmitAt(recognizer, GestureType_Pinch, GesturePhase_Began, recognizer->lastX, recognizer->lastY);
+}
+
+static void gestureRecognizer_PointerUp(GestureRecognizer* recognizer, const MotionEvent* motionEvent, int index)
+{
+    if (recognizer->state != GestureState_Pinching)
+        return;
+
+    int32_t pointerId = motionEvent->pointerId[index];
+    if (pointerId != recognizer->pointerId[0] && pointerId != recognizer->pointerId[1])
+        return;
+
+    // The remaining pointer does not start a drag, it would jump from the centroid
+    gestureRecognizer_HandleSamples(recognizer, motionEvent);
+    gestureRecognizer_EmitAt(recognizer, GestureType_Pinch, GesturePhase_Ended, recognizer->lastX, recognizer->lastY);
+    recognizer->state = GestureState_Finished;
+}
+
+static void gestureRecognizer_Up(GestureRecognizer* recognizer, const MotionEvent* motionEvent)
+{
+    gestureRecognizer_HandleSamples(recognizer, motionEvent);
+
+    switch (recognizer->state)
+    {
+        case GestureState_Pressed:
+        {
+            if (motionEvent->eventTime - recognizer->downTime > recognizer->desc.tapTimeoutNs)
+                break;
+
+            bool doubleTap = recognizer->lastTapTime != 0
+                && gesture_Distance(recognizer->lastTapX, recognizer->lastTapY, recognizer->downX, recognizer->downY) <= 2.f * recognizer->desc.touchSlop;
+            gestureRecognizer_EmitAt(recognizer, doubleTap ? GestureType_DoubleTap : GestureType_Tap, GesturePhase_Ended, recognizer->downX, recognizer->downY);
+
+            recognizer->lastTapTime = doubleTap ? 0 : motionEvent->eventTime;
+            recognizer->lastTapX = recognizer->downX;
+            recognizer->lastTapY = recognizer->downY;
+            break;
+        }
+
+        case GestureState_Dragging:
+        {
+            gestureRecognizer_EmitAt(recognizer, GestureType_Drag, GesturePhase_Ended, recognizer->lastX, recognizer->lastY);
+
+            float vx, vy;
+            gestureRecognizer_GetVelocity(recognizer, &vx, &vy);
+            if (sqrtf(vx * vx + vy * vy) >= recognizer->desc.minFlingVelocity)
+            {
+                gestureRecognizer_Emit(recognizer, (Gesture){ .type = GestureType_Fling, .phase = GesturePhase_Ended,
+                    .x = recognizer->lastX, .y = recognizer->lastY, .scale = 1.f, .vx = vx, .vy = vy });
+            }
+            break;
+        }
+
+        case GestureState_Pinching:
+            gestureRecognizer_EmitAt(recognizer, GestureType_Pinch, GesturePhase_Ended, recognizer->lastX, recognizer->lastY);
+            break;
+
+        default:
+            break;
+    }
+
+    recognizer->state = GestureState_Idle;
+}
+
+void gestureRecognizer_HandleMotion(GestureRecognizer* recognizer, const MotionEvent* motionEvent)
+{
+    int index = motionEvent_GetActionIndex(motionEvent);
+    switch (motionEvent_GetActionMasked(motionEvent))
+    {
+        case AMOTION_EVENT_ACTION_DOWN:
+            if (motionEvent->pointerCount > 0)
+                gestureRecognizer_Down(recognizer, motionEvent);
+            break;
+
+        case AMOTION_EVENT_ACTION_POINTER_DOWN:
+            if (index < motionEvent->pointerCount)
+                gestureRecognizer_PointerDown(recognizer, motionEvent, index);
+            break;
+
+        case AMOTION_EVENT_ACTION_MOVE:
+            gestureRecognizer_HandleSamples(recognizer, motionEvent);
+            break;
+
+        case AMOTION_EVENT_ACTION_POINTER_UP:
+            if (index < motionEvent->pointerCount)
+                gestureRecognizer_PointerUp(recognizer, motionEvent, index);
+            break;
+
+        case AMOTION_EVENT_ACTION_UP:
+            gestureRecognizer_Up(recognizer, motionEvent);
+            break;
+
+        case AMOTION_EVENT_ACTION_CANCEL:
+            gestureRecognizer_Cancel(recognizer);
+            break;
+
+        default:
+            break;
+    }
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "event.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Recognizes taps, double taps, long presses, drags, flings and two-finger pinches from the motion events
+// State is updated incrementally, O(pointers) per sample and no allocation, gestures are published once per frame
+// Only depends on MotionEvent, synthetic streams can drive it on Linux (see tools/replay.c --gestures)
+
+#define GESTURE_MAX_PER_FRAME 16
+#define GESTURE_VELOCITY_SAMPLES 8
+
+typedef enum GestureType
+{
+    GestureType_Tap,
+    GestureType_DoubleTap, // Replaces the second Tap
+    GestureType_LongPress,
+    GestureType_Drag,      // One pointer moved beyond the slop
+    GestureType_Fling,     // Drag released fast enough, vx/vy set
+    GestureType_Pinch,     // Two pointers, x/y is their centroid
+    GestureType_Count
+} GestureType;
+
+typedef enum GesturePhase
+{
+    GesturePhase_Began,
+    GesturePhase_Changed,
+    GesturePhase_Ended, // Discrete gestures only have this one
+} GesturePhase;
+
+typedef struct Gesture
+{
+    uint8_t type;     // GestureType
+    uint8_t phase;    // GesturePhase
+    uint8_t canceled; // Ended by ACTION_CANCEL or by another gesture taking over
+    uint8_t reserved;
+    float x, y;       // Current position
+    float dx, dy;     // Drag/Pinch movement since the previous record of the gesture
+    float scale;      // Pinch span ratio since the previous record, 1 otherwise
+    float vx, vy;     // Fling velocity, pixels per second
+} Gesture;
+
+// Consecutive Changed records of a gesture are merged, a frame holds its Began, one Changed and its Ended at most
+typedef struct GestureFrame
+{
+    int count;
+    int droppedCount;
+    Gesture gestures[GESTURE_MAX_PER_FRAME];
+} GestureFrame;
+
+typedef struct GestureDesc
+{
+    float touchSlop;             // Pixels a pointer moves before it drags, 24 if 0
+    int64_t tapTimeoutNs;        // Longer presses are not taps, 300 ms if 0
+    int64_t doubleTapTimeoutNs;  // Between the first up and the second down, 300 ms if 0
+    int64_t longPressTimeoutNs;  // 500 ms if 0
+    float minFlingVelocity;      // Pixels per second, 150 if 0
+} GestureDesc;
+
+typedef enum GestureState
+{
+    GestureState_Idle,
+    GestureState_Pressed,  // One pointer down within the slop, can still be a tap or a long press
+    GestureState_LongPressed,
+    GestureState_Dragging,
+    GestureState_Pinching,
+    GestureState_Finished, // Gesture over, waiting for every pointer to go up
+} GestureState;
+
+typedef struct GestureRecognizer
+{
+    GestureDesc desc;
+    GestureState state;
+
+    int32_t pointerId[2]; // Dragging pointer, second one for pinches
+    int64_t downTime;
+    float downX, downY;
+    float lastX, lastY;   // Position of the last record, drag pointer or pinch centroid
+    float lastSpan;
+
+    // Recent samples of the dragging pointer for the fling velocity, ring buffer
+    int velocityCount;
+    int velocityHead;
+    int64_t velocityTime[GESTURE_VELOCITY_SAMPLES];
+    float velocityX[GESTURE_VELOCITY_SAMPLES];
+    float velocityY[GESTURE_VELOCITY_SAMPLES];
+
+    int64_t lastTapTime; // 0 if the next tap cannot be a double tap
+    float lastTapX, lastTapY;
+
+    GestureFrame frame; // Gestures recognized since the last gestureRecognizer_TakeFrame()
+} GestureRecognizer;
+
+void gestureRecognizer_Init(GestureRecognizer* recognizer, const GestureDesc* desc);
+void gestureRecognizer_HandleMotion(GestureRecognizer* recognizer, const MotionEvent* motionEvent);
+void gestureRecognizer_Update(GestureRecognizer* recognizer, int64_t time); // Time based gestures (long press), once per frame
+void gestureRecognizer_TakeFrame(GestureRecognizer* recognizer, GestureFrame* frame); // Moves the recognized gestures to `frame`
+void gestureRecognizer_Cancel(GestureRecognizer* recognizer); // Ends the current gesture, for example when the app pauses
+
+extern const char* gestureTypeStr[GestureType_Count];
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,224 @@
+
+#include <stdlib.h> // realloc
+#include <string.h> // strcmp/strncmp
+
+#include "common.h"
+
+#include "glad/gles2.h"
+
+#include "gl_null.h"
+
+static GLNullStats g_stats;
+static GLuint g_lastName;
+static void* g_mapScratch;
+static GLsizeiptr g_mapScratchSize;
+
+// Called through the glad pointer types, void and integer results are 0 on the ABIs we build for
+static intptr_t GLAD_API_PTR glNull_Generic(void)
+{
+    g_stats.callCount++;
+    return 0;
+}
+
+static const GLubyte* GLAD_API_PTR glNull_GetString(GLenum name)
+{
+    g_stats.callCount++;
+    return (const GLubyte*)(name == GL_VERSION ? "OpenGL ES 3.0 null" : "null");
+}
+
+static const GLubyte* GLAD_API_PTR glNull_GetStringi(GLenum name, GLuint index)
+{
+    g_stats.callCount++;
+    return (const GLubyte*)"GL_EXT_texture_filter_anisotropic";
+}
+
+static void GLAD_API_PTR glNull_GetIntegerv(GLenum pname, GLint* data)
+{
+    g_stats.callCount++;
+    int count = (pname == GL_VIEWPORT || pname == GL_SCISSOR_BOX) ? 4 : 1;
+    for (int i = 0; i < count; ++i)
+        data[i] = 0;
+    if (pname == GL_NUM_EXTENSIONS)
+        data[0] = 1;
+    else if (pname == GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT)
+        data[0] = 256; // The largest the spec allows, common on mobile GPUs
+}
+
+// Compile and link statuses
+static void GLAD_API_PTR glNull_GetObjectiv(GLuint object, GLenum pname, GLint* params)
+{
+    g_stats.callCount++;
+    *params = (pname == GL_INFO_LOG_LENGTH) ? 0 : GL_TRUE;
+}
+
+static GLuint GLAD_API_PTR glNull_CreateObject(GLenum type)
+{
+    g_stats.callCount++;
+    return ++g_lastName;
+}
+
+static void GLAD_API_PTR glNull_GenObjects(GLsizei n, GLuint* names)
+{
+    g_stats.callCount++;
+    for (GLsizei i = 0; i < n; ++i)
+        names[i] = ++g_lastName;
+}
+
+static GLsync GLAD_API_PTR glNull_FenceSync(GLenum condition, GLbitfield flags)
+{
+    g_stats.callCount++;
+    return (GLsync)(uintptr_t)++g_lastName;
+}
+
+static GLenum GLAD_API_PTR glNull_ClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout)
+{
+    g_stats.callCount++;
+    return GL_ALREADY_SIGNALED;
+}
+
+static GLenum GLAD_API_PTR glNull_CheckFramebufferStatus(GLenum target)
+{
+    g_stats.callCount++;
+    return GL_FRAMEBUFFER_COMPLETE;
+}
+
+static void* GLAD_API_PTR glNull_MapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)
+{
+    g_stats.callCount++;
+    if (length > g_mapScratchSize)
+    {
+        g_mapScratch = realloc(g_mapScratch, length);
+        g_mapScratchSize = length;
+    }
+    return g_mapScratch;
+}
+
+static GLboolean GLAD_API_PTR glNull_UnmapBuffer(GLenum target)
+{
+    g_stats.callCount++;
+    return GL_TRUE;
+}
+
+static void GLAD_API_PTR glNull_BufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+{
+    g_stats.callCount++;
+    if (data)
+        g_stats.uploadBytes += size;
+}
+
+static void GLAD_API_PTR glNull_BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+{
+    g_stats.callCount++;
+    g_stats.uploadBytes += size;
+}
+
+static void GLAD_API_PTR glNull_UseProgram(GLuint program)
+{
+    g_stats.callCount++;
+    g_stats.programBinds++;
+}
+
+static void GLAD_API_PTR glNull_BindTexture(GLenum target, GLuint texture)
+{
+    g_stats.callCount++;
+    g_stats.textureBinds++;
+}
+
+static void GLAD_API_PTR glNull_BindVertexArray(GLuint vertexArray)
+{
+    g_stats.callCount++;
+    g_stats.vertexArrayBinds++;
+}
+
+static void GLAD_API_PTR glNull_DrawArrays(GLenum mode, GLint first, GLsizei count)
+{
+    g_stats.callCount++;
+    g_stats.drawCount++;
+    g_stats.instanceCount++;
+}
+
+static void GLAD_API_PTR glNull_DrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices)
+{
+    g_stats.callCount++;
+    g_stats.drawCount++;
+    g_stats.instanceCount++;
+}
+
+static void GLAD_API_PTR glNull_DrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instanceCount)
+{
+    g_stats.callCount++;
+    g_stats.drawCount++;
+    g_stats.instanceCount += instanceCount;
+}
+
+static void GLAD_API_PTR glNull_DrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instanceCount)
+{
+    g_stats.callCount++;
+    g_stats.drawCount++;
+    g_stats.instanceCount += instanceCount;
+}
+
+#define GL_NULL_STUB(name, func) { name, (GLADapiproc)func }
+
+static const struct
+{
+    const char* name;
+    GLADapiproc func;
+} g_stubs[] =
+{
+    GL_NULL_STUB("glGetString", glNull_GetString),
+    GL_NULL_STUB("glGetStringi", glNull_GetStringi),
+    GL_NULL_STUB("glGetIntegerv", glNull_GetIntegerv),
+    GL_NULL_STUB("glGetShaderiv", glNull_GetObjectiv),
+    GL_NULL_STUB("glGetProgramiv", glNull_GetObjectiv),
+    GL_NULL_STUB("glCreateShader", glNull_CreateObject),
+    GL_NULL_STUB("glCreateProgram", glNull_CreateObject),
+    GL_NULL_STUB("glFenceSync", glNull_FenceSync),
+    GL_NULL_STUB("glClientWaitSync", glNull_ClientWaitSync),
+    GL_NULL_STUB("glCheckFramebufferStatus", glNull_CheckFramebufferStatus),
+    GL_NULL_STUB("glMapBufferRange", glNull_MapBufferRange),
+    GL_NULL_STUB("glUnmapBuffer", glNull_UnmapBuffer),
+    GL_NULL_STUB("glBufferData", glNull_BufferData),
+    GL_NULL_STUB("glBufferSubData", glNull_BufferSubData),
+    GL_NULL_STUB("glUseProgram", glNull_UseProgram),
+    GL_NULL_STUB("glBindTexture", glNull_BindTexture),
+    GL_NULL_STUB("glBindVertexArray", glNull_BindVertexArray),
+    GL_NULL_STUB("glDrawArrays", glNull_DrawArrays),
+    GL_NULL_STUB("glDrawElements", glNull_DrawElements),
+    GL_NULL_STUB("glDrawArraysInstanced", glNull_DrawArraysInstanced),
+    GL_NULL_STUB("glDrawElementsInstanced", glNull_DrawElementsInstanced),
+};
+
+static GLADapiproc glNull_GetProc(const char* name)
+{
+    for (int i = 0; i < ARRAYSIZE(g_stubs); ++i)
+        if (strcmp(g_stubs[i].name, name) == 0)
+            return g_stubs[i].func;
+
+    // glGenBuffers, glGenTextures, glGenVertexArrays...
+    if (strncmp(name, "glGen", 5) == 0 && strncmp(name, "glGenerate", 10) != 0)
+        return (GLADapiproc)glNull_GenObjects;
+
+    return (GLADapiproc)glNull_Generic;
+}
+
+bool glNull_Load(void)
+{
+    if (!gladLoadGLES2(glNull_GetProc))
+    {
+        ALOGE("glNull_Load() failed");
+        return false;
+    }
+    glNull_ResetStats();
+    return true;
+}
+
+void glNull_ResetStats(void)
+{
+    g_stats = (GLNullStats){ 0 };
+}
+
+GLNullStats glNull_GetStats(void)
+{
+    return g_stats;
+}
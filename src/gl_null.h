@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Null GL ES 3.0 backend for the host tools: every glad entry point is a stub that only counts calls
+// Lets the rendering code run on Linux without a context to measure its CPU cost or count state changes
+// Object names are unique, status queries succeed, glMapBufferRange() returns scratch memory
+
+typedef struct GLNullStats
+{
+    uint64_t callCount;
+    uint64_t drawCount;        // glDraw* calls
+    uint64_t instanceCount;    // Drawn by them, 1 per non-instanced draw
+    uint64_t uploadBytes;      // glBufferData/glBufferSubData sizes
+    uint64_t programBinds;     // glUseProgram calls
+    uint64_t textureBinds;     // glBindTexture calls
+    uint64_t vertexArrayBinds; // glBindVertexArray calls
+} GLNullStats;
+
+bool glNull_Load(void); // Replaces the glad function pointers, no context needed
+void glNull_ResetStats(void);
+GLNullStats glNull_GetStats(void);
+
+#ifdef __cplusplus
+}
+#endif
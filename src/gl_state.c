@@ -0,0 +1,353 @@
+
+#include <string.h> // memcmp
+
+#include "common.h"
+
+#include "gl_state.h"
+
+static GLState g_state;
+static GLStateStats g_stats;
+
+static const GLenum g_capEnums[GLStateCap_Count] =
+{
+    [GLStateCap_Blend]       = GL_BLEND,
+    [GLStateCap_CullFace]    = GL_CULL_FACE,
+    [GLStateCap_DepthTest]   = GL_DEPTH_TEST,
+    [GLStateCap_StencilTest] = GL_STENCIL_TEST,
+    [GLStateCap_ScissorTest] = GL_SCISSOR_TEST,
+};
+
+static GLuint gl_GetUint(GLenum pname)
+{
+    GLint value = 0;
+    glGetIntegerv(pname, &value);
+    return (GLuint)value;
+}
+
+// Queries everything glState tracks, the reference glState_Verify() compares the shadow with
+static void glState_Query(GLState* state)
+{
+    *state = (GLState){ 0 };
+    state->program = gl_GetUint(GL_CURRENT_PROGRAM);
+    state->vertexArray = gl_GetUint(GL_VERTEX_ARRAY_BINDING);
+    state->arrayBuffer = gl_GetUint(GL_ARRAY_BUFFER_BINDING);
+    state->uniformBuffer = gl_GetUint(GL_UNIFORM_BUFFER_BINDING);
+    for (GLuint i = 0; i < GL_STATE_UNIFORM_BINDING_COUNT; ++i)
+    {
+        GLint buffer = 0;
+        GLint64 offset = 0, size = 0;
+        glGetIntegeri_v(GL_UNIFORM_BUFFER_BINDING, i, &buffer);
+        glGetInteger64i_v(GL_UNIFORM_BUFFER_START, i, &offset);
+        glGetInteger64i_v(GL_UNIFORM_BUFFER_SIZE, i, &size);
+        if (buffer) // What an unbound range reports varies between drivers
+            state->uniformRanges[i] = (GLBufferRange){ (GLuint)buffer, (GLintptr)offset, (GLsizeiptr)size };
+    }
+
+    state->activeTexture = gl_GetUint(GL_ACTIVE_TEXTURE);
+    if (state->activeTexture < GL_TEXTURE0) // Only from a backend that does not implement the query, like the null one
+        state->activeTexture = GL_TEXTURE0;
+    for (int i = 0; i < GL_STATE_TEXTURE_UNIT_COUNT; ++i)
+    {
+        glActiveTexture(GL_TEXTURE0 + i);
+        state->textures2D[i] = gl_GetUint(GL_TEXTURE_BINDING_2D);
+    }
+    glActiveTexture(state->activeTexture);
+
+    for (int cap = 0; cap < GLStateCap_Count; ++cap)
+        state->caps[cap] = glIsEnabled(g_capEnums[cap]);
+    glGetIntegerv(GL_VIEWPORT, state->viewport);
+    glGetIntegerv(GL_SCISSOR_BOX, state->scissor);
+    state->blendEquation[0] = gl_GetUint(GL_BLEND_EQUATION_RGB);
+    state->blendEquation[1] = gl_GetUint(GL_BLEND_EQUATION_ALPHA);
+    state->blendFunc[0] = gl_GetUint(GL_BLEND_SRC_RGB);
+    state->blendFunc[1] = gl_GetUint(GL_BLEND_DST_RGB);
+    state->blendFunc[2] = gl_GetUint(GL_BLEND_SRC_ALPHA);
+    state->blendFunc[3] = gl_GetUint(GL_BLEND_DST_ALPHA);
+}
+
+void glState_Reset(void)
+{
+    glState_Query(&g_state);
+}
+
+const GLState* glState_Get(void)
+{
+    return &g_state;
+}
+
+void glState_Restore(const GLState* state)
+{
+    glState_UseProgram(state->program);
+    glState_BindVertexArray(state->vertexArray);
+    glState_BindBuffer(GL_ARRAY_BUFFER, state->arrayBuffer);
+    for (GLuint i = 0; i < GL_STATE_UNIFORM_BINDING_COUNT; ++i)
+    {
+        const GLBufferRange* range = &state->uniformRanges[i];
+        if (range->buffer) // Ranges unbound in the backup are left as they are, nothing we draw reads them
+            glState_BindBufferRange(GL_UNIFORM_BUFFER, i, range->buffer, range->offset, range->size);
+    }
+    // After the ranges, which also set the generic binding
+    glState_BindBuffer(GL_UNIFORM_BUFFER, state->uniformBuffer);
+
+    for (int i = 0; i < GL_STATE_TEXTURE_UNIT_COUNT; ++i)
+    {
+        if (g_state.textures2D[i] != state->textures2D[i])
+        {
+            glState_ActiveTexture(GL_TEXTURE0 + i);
+            glState_BindTexture(GL_TEXTURE_2D, state->textures2D[i]);
+        }
+    }
+    glState_ActiveTexture(state->activeTexture);
+
+    for (int cap = 0; cap < GLStateCap_Count; ++cap)
+        glState_Enable(cap, state->caps[cap]);
+    glState_Viewport(state->viewport[0], state->viewport[1], state->viewport[2], state->viewport[3]);
+    glState_Scissor(state->scissor[0], state->scissor[1], state->scissor[2], state->scissor[3]);
+    glState_BlendEquationSeparate(state->blendEquation[0], state->blendEquation[1]);
+    glState_BlendFuncSeparate(state->blendFunc[0], state->blendFunc[1], state->blendFunc[2], state->blendFunc[3]);
+
+#if GL_STATE_VERIFY
+    glState_Verify();
+#endif
+}
+
+#define GL_STATE_CHECK(name, shadow, actual, count) \
+    if (memcmp(shadow, actual, (count) * sizeof(*(shadow))) != 0) \
+    { \
+        ALOGE("glState_Verify() %s: shadow %d, GL %d", name, (int)(shadow)[0], (int)(actual)[0]); \
+        matches = false; \
+    }
+
+bool glState_Verify(void)
+{
+    GLState actual;
+    glState_Query(&actual);
+
+    bool matches = true;
+    GL_STATE_CHECK("program", &g_state.program, &actual.program, 1);
+    GL_STATE_CHECK("vertex array", &g_state.vertexArray, &actual.vertexArray, 1);
+    GL_STATE_CHECK("array buffer", &g_state.arrayBuffer, &actual.arrayBuffer, 1);
+    GL_STATE_CHECK("uniform buffer", &g_state.uniformBuffer, &actual.uniformBuffer, 1);
+    for (int i = 0; i < GL_STATE_UNIFORM_BINDING_COUNT; ++i)
+    {
+        GL_STATE_CHECK("uniform range buffer", &g_state.uniformRanges[i].buffer, &actual.uniformRanges[i].buffer, 1);
+        GL_STATE_CHECK("uniform range offset", &g_state.uniformRanges[i].offset, &actual.uniformRanges[i].offset, 1);
+        GL_STATE_CHECK("uniform range size", &g_state.uniformRanges[i].size, &actual.uniformRanges[i].size, 1);
+    }
+    GL_STATE_CHECK("active texture", &g_state.activeTexture, &actual.activeTexture, 1);
+    GL_STATE_CHECK("2D textures", g_state.textures2D, actual.textures2D, GL_STATE_TEXTURE_UNIT_COUNT);
+    GL_STATE_CHECK("caps", g_state.caps, actual.caps, GLStateCap_Count);
+    GL_STATE_CHECK("viewport", g_state.viewport, actual.viewport, 4);
+    GL_STATE_CHECK("scissor", g_state.scissor, actual.scissor, 4);
+    GL_STATE_CHECK("blend equation", g_state.blendEquation, actual.blendEquation, 2);
+    GL_STATE_CHECK("blend func", g_state.blendFunc, actual.blendFunc, 4);
+
+    // Carry on from what GL has, one report per divergence
+    if (!matches)
+        g_state = actual;
+    return matches;
+}
+
+GLStateStats glState_GetStats(void)
+{
+    return g_stats;
+}
+
+void glState_ResetStats(void)
+{
+    g_stats = (GLStateStats){ 0 };
+}
+
+// Returns whether the change must be issued
+static bool glState_Changes(bool changes)
+{
+    if (changes)
+        g_stats.issuedCount++;
+    else
+        g_stats.skippedCount++;
+    return changes;
+}
+
+void glState_UseProgram(GLuint program)
+{
+    if (glState_Changes(g_state.program != program))
+    {
+        glUseProgram(program);
+        g_state.program = program;
+    }
+}
+
+void glState_BindVertexArray(GLuint vertexArray)
+{
+    if (glState_Changes(g_state.vertexArray != vertexArray))
+    {
+        glBindVertexArray(vertexArray);
+        g_state.vertexArray = vertexArray;
+    }
+}
+
+void glState_BindBuffer(GLenum target, GLuint buffer)
+{
+    GLuint* binding = target == GL_ARRAY_BUFFER ? &g_state.arrayBuffer
+                    : target == GL_UNIFORM_BUFFER ? &g_state.uniformBuffer
+                    : NULL;
+    if (binding == NULL)
+    {
+        glBindBuffer(target, buffer);
+        return;
+    }
+
+    if (glState_Changes(*binding != buffer))
+    {
+        glBindBuffer(target, buffer);
+        *binding = buffer;
+    }
+}
+
+void glState_BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+    if (target != GL_UNIFORM_BUFFER || index >= GL_STATE_UNIFORM_BINDING_COUNT)
+    {
+        glBindBufferRange(target, index, buffer, offset, size);
+        if (target == GL_UNIFORM_BUFFER)
+            g_state.uniformBuffer = buffer;
+        return;
+    }
+
+    GLBufferRange* range = &g_state.uniformRanges[index];
+    if (glState_Changes(range->buffer != buffer || range->offset != offset || range->size != size))
+    {
+        glBindBufferRange(target, index, buffer, offset, size);
+        *range = (GLBufferRange){ buffer, offset, size };
+        g_state.uniformBuffer = buffer; // Also binds the generic binding point
+    }
+}
+
+void glState_ActiveTexture(GLenum unit)
+{
+    if (glState_Changes(g_state.activeTexture != unit))
+    {
+        glActiveTexture(unit);
+        g_state.activeTexture = unit;
+    }
+}
+
+void glState_BindTexture(GLenum target, GLuint texture)
+{
+    int unit = g_state.activeTexture - GL_TEXTURE0;
+    if (target != GL_TEXTURE_2D || unit < 0 || unit >= GL_STATE_TEXTURE_UNIT_COUNT)
+    {
+        glBindTexture(target, texture);
+        return;
+    }
+
+    if (glState_Changes(g_state.textures2D[unit] != texture))
+    {
+        glBindTexture(target, texture);
+        g_state.textures2D[unit] = texture;
+    }
+}
+
+void glState_Enable(GLStateCap cap, bool enabled)
+{
+    if (glState_Changes(g_state.caps[cap] != enabled))
+    {
+        if (enabled)
+            glEnable(g_capEnums[cap]);
+        else
+            glDisable(g_capEnums[cap]);
+        g_state.caps[cap] = enabled;
+    }
+}
+
+void glState_Viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    GLint* viewport = g_state.viewport;
+    if (glState_Changes(viewport[0] != x || viewport[1] != y || viewport[2] != width || viewport[3] != height))
+    {
+        glViewport(x, y, width, height);
+        viewport[0] = x;
+        viewport[1] = y;
+        viewport[2] = width;
+        viewport[3] = height;
+    }
+}
+
+void glState_Scissor(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    GLint* scissor = g_state.scissor;
+    if (glState_Changes(scissor[0] != x || scissor[1] != y || scissor[2] != width || scissor[3] != height))
+    {
+        glScissor(x, y, width, height);
+        scissor[0] = x;
+        scissor[1] = y;
+        scissor[2] = width;
+        scissor[3] = height;
+    }
+}
+
+void glState_BlendEquationSeparate(GLenum modeRGB, GLenum modeAlpha)
+{
+    if (glState_Changes(g_state.blendEquation[0] != modeRGB || g_state.blendEquation[1] != modeAlpha))
+    {
+        glBlendEquationSeparate(modeRGB, modeAlpha);
+        g_state.blendEquation[0] = modeRGB;
+        g_state.blendEquation[1] = modeAlpha;
+    }
+}
+
+void glState_BlendFuncSeparate(GLenum srcRGB, GLenum dstRGB, GLenum srcAlpha, GLenum dstAlpha)
+{
+    GLenum* func = g_state.blendFunc;
+    if (glState_Changes(func[0] != srcRGB || func[1] != dstRGB || func[2] != srcAlpha || func[3] != dstAlpha))
+    {
+        glBlendFuncSeparate(srcRGB, dstRGB, srcAlpha, dstAlpha);
+        func[0] = srcRGB;
+        func[1] = dstRGB;
+        func[2] = srcAlpha;
+        func[3] = dstAlpha;
+    }
+}
+
+// A deleted program stays in use until another one is, unbinding it keeps a reused name from being skipped
+void glState_DeleteProgram(GLuint program)
+{
+    if (program && g_state.program == program)
+        glState_UseProgram(0);
+    glDeleteProgram(program);
+}
+
+void glState_DeleteVertexArrays(GLsizei count, const GLuint* vertexArrays)
+{
+    for (GLsizei i = 0; i < count; ++i)
+        if (vertexArrays[i] && g_state.vertexArray == vertexArrays[i])
+            g_state.vertexArray = 0;
+    glDeleteVertexArrays(count, vertexArrays);
+}
+
+void glState_DeleteBuffers(GLsizei count, const GLuint* buffers)
+{
+    for (GLsizei i = 0; i < count; ++i)
+    {
+        GLuint buffer = buffers[i];
+        if (buffer == 0)
+            continue;
+        if (g_state.arrayBuffer == buffer)
+            g_state.arrayBuffer = 0;
+        if (g_state.uniformBuffer == buffer)
+            g_state.uniformBuffer = 0;
+        for (int r = 0; r < GL_STATE_UNIFORM_BINDING_COUNT; ++r)
+            if (g_state.uniformRanges[r].buffer == buffer)
+                g_state.uniformRanges[r] = (GLBufferRange){ 0 };
+    }
+    glDeleteBuffers(count, buffers);
+}
+
+void glState_DeleteTextures(GLsizei count, const GLuint* textures)
+{
+    for (GLsizei i = 0; i < count; ++i)
+        for (int unit = 0; unit < GL_STATE_TEXTURE_UNIT_COUNT; ++unit)
+            if (textures[i] && g_state.textures2D[unit] == textures[i])
+                g_state.textures2D[unit] = 0;
+    glDeleteTextures(count, textures);
+}
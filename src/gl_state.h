@@ -0,0 +1,92 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "glad/gles2.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// CPU shadow of the GL state our code changes: binds and toggles that would not change anything are skipped, and
+// backups read the shadow instead of glGet*() round trips that can stall on the driver
+// Only valid if every change of the tracked state goes through these functions, GL thread only
+// Build with -DGL_STATE_VERIFY=1 to check the shadow against glGet*() every frame and after every restore
+
+#ifndef GL_STATE_VERIFY
+#define GL_STATE_VERIFY 0
+#endif
+
+#define GL_STATE_TEXTURE_UNIT_COUNT 8
+#define GL_STATE_UNIFORM_BINDING_COUNT 4
+
+typedef enum GLStateCap
+{
+    GLStateCap_Blend,
+    GLStateCap_CullFace,
+    GLStateCap_DepthTest,
+    GLStateCap_StencilTest,
+    GLStateCap_ScissorTest,
+    GLStateCap_Count,
+} GLStateCap;
+
+typedef struct GLBufferRange
+{
+    GLuint buffer;
+    GLintptr offset;
+    GLsizeiptr size;
+} GLBufferRange;
+
+// Tracked state, plain data: copy it to back it up
+typedef struct GLState
+{
+    GLuint program;
+    GLuint vertexArray;
+    GLuint arrayBuffer;   // GL_ELEMENT_ARRAY_BUFFER is vertex array state, not tracked
+    GLuint uniformBuffer; // Generic binding
+    GLBufferRange uniformRanges[GL_STATE_UNIFORM_BINDING_COUNT];
+    GLenum activeTexture;
+    GLuint textures2D[GL_STATE_TEXTURE_UNIT_COUNT];
+    bool caps[GLStateCap_Count];
+    GLint viewport[4];
+    GLint scissor[4];
+    GLenum blendEquation[2]; // RGB, alpha
+    GLenum blendFunc[4];     // Source RGB, destination RGB, source alpha, destination alpha
+} GLState;
+
+typedef struct GLStateStats
+{
+    uint64_t issuedCount;  // Changes sent to GL
+    uint64_t skippedCount; // Redundant ones that were not
+} GLStateStats;
+
+void glState_Reset(void);            // Reads the whole state once, after the context is created or something bypassed us
+const GLState* glState_Get(void);
+void glState_Restore(const GLState* state); // Issues only what differs
+bool glState_Verify(void);           // Compares the shadow with glGet*(), logs the differences
+GLStateStats glState_GetStats(void);
+void glState_ResetStats(void);
+
+void glState_UseProgram(GLuint program);
+void glState_BindVertexArray(GLuint vertexArray);
+void glState_BindBuffer(GLenum target, GLuint buffer); // Untracked targets are passed through
+void glState_BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+void glState_ActiveTexture(GLenum unit);
+void glState_BindTexture(GLenum target, GLuint texture); // On the active unit
+void glState_Enable(GLStateCap cap, bool enabled);
+void glState_Viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+void glState_Scissor(GLint x, GLint y, GLsizei width, GLsizei height);
+void glState_BlendEquationSeparate(GLenum modeRGB, GLenum modeAlpha);
+void glState_BlendFuncSeparate(GLenum srcRGB, GLenum dstRGB, GLenum srcAlpha, GLenum dstAlpha);
+
+// GL unbinds deleted objects, so must the shadow
+void glState_DeleteProgram(GLuint program);
+void glState_DeleteVertexArrays(GLsizei count, const GLuint* vertexArrays);
+void glState_DeleteBuffers(GLsizei count, const GLuint* buffers);
+void glState_DeleteTextures(GLsizei count, const GLuint* textures);
+
+#ifdef __cplusplus
+}
+#endif
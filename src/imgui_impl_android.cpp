@@ -24,19 +24,21 @@
 //  2022-01-10: Inputs: calling new io.AddKeyEvent(), io.AddKeyModsEvent() + io.SetKeyEventNativeData() API (1.87+). Support for full ImGuiKey range.
 //  2021-03-04: Initial version.
 
-#include <time.h>
 #include <android/native_window.h>
 #include <android/input.h>
 #include <android/keycodes.h>
 #include <android/log.h>
 
 #include "event.h"
+#include "timing.h"
 
 #include "imgui.h"
 #include "imgui_impl_android.h"
 
 // Android data
-static double                                   g_Time = 0.0;
+static int64_t                                  g_Time = 0;
+static int32_t                                  g_KeyMods = 0;         // AMETA_* bits last sent to ImGui
+static int32_t                                  g_MousePointerId = -1; // Touch driving the mouse, the first one down
 
 static ImGuiKey ImGui_ImplAndroid_KeyCodeToImGuiKey(int32_t key_code)
 {
@@ -163,10 +165,14 @@ int32_t ImGui_ImplAndroid_HandleInputEvent(const InputEvent* input_event)
         int32_t event_action = input_event->keyEvent.action;
         int32_t event_meta_state = input_event->keyEvent.metaState;
 
-        io.AddKeyEvent(ImGuiKey_ModCtrl,  (event_meta_state & AMETA_CTRL_ON)  != 0);
-        io.AddKeyEvent(ImGuiKey_ModShift, (event_meta_state & AMETA_SHIFT_ON) != 0);
-        io.AddKeyEvent(ImGuiKey_ModAlt,   (event_meta_state & AMETA_ALT_ON)   != 0);
-        io.AddKeyEvent(ImGuiKey_ModSuper, (event_meta_state & AMETA_META_ON)  != 0);
+        // Only modifiers that changed, most key events leave them alone
+        int32_t key_mods = event_meta_state & (AMETA_CTRL_ON | AMETA_SHIFT_ON | AMETA_ALT_ON | AMETA_META_ON);
+        int32_t changed_mods = key_mods ^ g_KeyMods;
+        g_KeyMods = key_mods;
+        if (changed_mods & AMETA_CTRL_ON)  io.AddKeyEvent(ImGuiKey_ModCtrl,  (key_mods & AMETA_CTRL_ON)  != 0);
+        if (changed_mods & AMETA_SHIFT_ON) io.AddKeyEvent(ImGuiKey_ModShift, (key_mods & AMETA_SHIFT_ON) != 0);
+        if (changed_mods & AMETA_ALT_ON)   io.AddKeyEvent(ImGuiKey_ModAlt,   (key_mods & AMETA_ALT_ON)   != 0);
+        if (changed_mods & AMETA_META_ON)  io.AddKeyEvent(ImGuiKey_ModSuper, (key_mods & AMETA_META_ON)  != 0);
 
         switch (event_action)
         {
@@ -192,47 +198,44 @@ int32_t ImGui_ImplAndroid_HandleInputEvent(const InputEvent* input_event)
     }
     case AINPUT_EVENT_TYPE_MOTION:
     {
-        int32_t event_action = input_event->motionEvent.action;
-        //int32_t event_pointer_index = (event_action & AMOTION_EVENT_ACTION_POINTER_INDEX_MASK) >> AMOTION_EVENT_ACTION_POINTER_INDEX_SHIFT;
-        event_action &= AMOTION_EVENT_ACTION_MASK;
+        // ImGui has a single mouse, it follows the first touch down until it goes up, other touches are ignored
+        const MotionEvent* motion_event = &input_event->motionEvent;
+        int32_t event_action = motionEvent_GetActionMasked(motion_event);
+        int32_t event_pointer_index = motionEvent_GetActionIndex(motion_event);
         switch (event_action)
         {
         case AMOTION_EVENT_ACTION_DOWN:
+            g_MousePointerId = motion_event->pointerId[0];
+            io.AddMousePosEvent(motion_event->x[0], motion_event->y[0]);
+            io.AddMouseButtonEvent(0, true);
+            break;
         case AMOTION_EVENT_ACTION_UP:
-            /*
-            // Physical mouse buttons (and probably other physical devices) also invoke the actions AMOTION_EVENT_ACTION_DOWN/_UP,
-            // but we have to process them separately to identify the actual button pressed. This is done below via
-            // AMOTION_EVENT_ACTION_BUTTON_PRESS/_RELEASE. Here, we only process "FINGER" input (and "UNKNOWN", as a fallback).
-            if((AMotionEvent_getToolType(input_event, event_pointer_index) == AMOTION_EVENT_TOOL_TYPE_FINGER)
-            || (AMotionEvent_getToolType(input_event, event_pointer_index) == AMOTION_EVENT_TOOL_TYPE_UNKNOWN))
+        case AMOTION_EVENT_ACTION_POINTER_UP:
+        {
+            int pointer_index = event_action == AMOTION_EVENT_ACTION_UP ? 0 : event_pointer_index;
+            if (pointer_index < motion_event->pointerCount && motion_event->pointerId[pointer_index] == g_MousePointerId)
             {
-                io.AddMousePosEvent(AMotionEvent_getX(input_event, event_pointer_index), AMotionEvent_getY(input_event, event_pointer_index));
-                io.AddMouseButtonEvent(0, event_action == AMOTION_EVENT_ACTION_DOWN);
+                io.AddMousePosEvent(motion_event->x[pointer_index], motion_event->y[pointer_index]);
+                io.AddMouseButtonEvent(0, false);
+                g_MousePointerId = -1;
             }
-            */
-            io.AddMousePosEvent(input_event->motionEvent.x[0], input_event->motionEvent.y[0]);
-            io.AddMouseButtonEvent(0, event_action == AMOTION_EVENT_ACTION_DOWN);
             break;
-            /*
-        case AMOTION_EVENT_ACTION_BUTTON_PRESS:
-        case AMOTION_EVENT_ACTION_BUTTON_RELEASE:
-            {
-                int32_t button_state = AMotionEvent_getButtonState(input_event);
-                io.AddMouseButtonEvent(0, (button_state & AMOTION_EVENT_BUTTON_PRIMARY) != 0);
-                io.AddMouseButtonEvent(1, (button_state & AMOTION_EVENT_BUTTON_SECONDARY) != 0);
-                io.AddMouseButtonEvent(2, (button_state & AMOTION_EVENT_BUTTON_TERTIARY) != 0);
-            }
+        }
+        case AMOTION_EVENT_ACTION_CANCEL:
+            if (g_MousePointerId >= 0)
+                io.AddMouseButtonEvent(0, false);
+            g_MousePointerId = -1;
             break;
-            */
         case AMOTION_EVENT_ACTION_HOVER_MOVE: // Hovering: Tool moves while NOT pressed (such as a physical mouse)
-        case AMOTION_EVENT_ACTION_MOVE:       // Touch pointer moves while DOWN
-            io.AddMousePosEvent(input_event->motionEvent.x[0], input_event->motionEvent.y[0]);
+            io.AddMousePosEvent(motion_event->x[0], motion_event->y[0]);
             break;
-            /*
-        case AMOTION_EVENT_ACTION_SCROLL:
-            io.AddMouseWheelEvent(AMotionEvent_getAxisValue(input_event, AMOTION_EVENT_AXIS_HSCROLL, event_pointer_index), AMotionEvent_getAxisValue(input_event, AMOTION_EVENT_AXIS_VSCROLL, event_pointer_index));
+        case AMOTION_EVENT_ACTION_MOVE:       // Touch pointer moves while DOWN
+        {
+            int pointer_index = motionEvent_FindPointer(motion_event, g_MousePointerId);
+            if (pointer_index >= 0)
+                io.AddMousePosEvent(motion_event->x[pointer_index], motion_event->y[pointer_index]);
             break;
-            */
+        }
         default:
             break;
         }
@@ -251,7 +254,9 @@ bool ImGui_ImplAndroid_Init()
     ImGuiIO& io = ImGui::GetIO();
     io.BackendPlatformName = "imgui_impl_android";
 
-    g_Time = 0.0;
+    g_Time = 0;
+    g_KeyMods = 0;
+    g_MousePointerId = -1;
 
     return true;
 }
@@ -265,9 +270,7 @@ void ImGui_ImplAndroid_NewFrame()
     ImGuiIO& io = ImGui::GetIO();
 
     // Setup time step
-    struct timespec current_timespec;
-    clock_gettime(CLOCK_MONOTONIC, &current_timespec);
-    double current_time = (double)(current_timespec.tv_sec) + (current_timespec.tv_nsec / 1000000000.0);
-    io.DeltaTime = g_Time > 0.0 ? (float)(current_time - g_Time) : (float)(1.0f / 60.0f);
+    int64_t current_time = time_Now();
+    io.DeltaTime = g_Time > 0 ? (float)time_ToSeconds(current_time - g_Time) : (float)(1.0f / 60.0f);
     g_Time = current_time;
 }
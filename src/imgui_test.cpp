@@ -5,6 +5,7 @@
 #include <imgui_impl_android.h>
 
 #include "event.h"
+#include "touch_state.h"
 
 #include "imgui_test.h"
 
@@ -17,6 +18,13 @@ struct ImGuiTest
     ImGuiTestIO prevIO;
 
     InputEvent lastMotionEvent;
+    TouchState touches;
+};
+
+struct ImGuiTestFrame
+{
+    ImDrawData drawData;
+    ImVector<ImDrawList*> cmdLists; // Kept between frames to reuse their buffers
 };
 
 ImGuiTest* test_Init()
@@ -56,6 +64,9 @@ ImGuiTestIO* test_GetIO(ImGuiTest* self)
 void test_LoadGPUData(ImGuiTest* self)
 {
     ImGui_ImplOpenGL3_Init("#version 300 es");
+
+    // Creates the device objects and the font texture, test_Update() does not touch GL
+    ImGui_ImplOpenGL3_NewFrame();
 }
 
 void test_UnloadGPUData(ImGuiTest* self)
@@ -76,13 +87,57 @@ void test_HandleEvent(ImGuiTest* self, const InputEvent* inputEvent)
         self->lastMotionEvent = *inputEvent;
 }
 
-void test_InputUnicodeChar(ImGuiTest* self, int unicodeChar)
+void test_InputText(ImGuiTest* self, const char* utf8)
 {
     ImGuiIO& io = ImGui::GetIO();
-    io.AddInputCharacter(unicodeChar);
+    io.AddInputCharactersUTF8(utf8);
+}
+
+void test_SetTouches(ImGuiTest* self, const TouchState* touches)
+{
+    self->touches = *touches;
+}
+
+template<typename T>
+static void copyVector(ImVector<T>& dst, const ImVector<T>& src)
+{
+    dst.resize(src.Size);
+    if (src.Size)
+        memcpy(dst.Data, src.Data, src.size_in_bytes());
+}
+
+static void frame_CopyDrawData(ImGuiTestFrame* frame, const ImDrawData* drawData)
+{
+    while (frame->cmdLists.Size < drawData->CmdListsCount)
+        frame->cmdLists.push_back(IM_NEW(ImDrawList)(NULL));
+
+    for (int i = 0; i < drawData->CmdListsCount; ++i)
+    {
+        const ImDrawList* src = drawData->CmdLists[i];
+        ImDrawList* dst = frame->cmdLists[i];
+        copyVector(dst->CmdBuffer, src->CmdBuffer);
+        copyVector(dst->IdxBuffer, src->IdxBuffer);
+        copyVector(dst->VtxBuffer, src->VtxBuffer);
+        dst->Flags = src->Flags;
+    }
+
+    frame->drawData = *drawData;
+    frame->drawData.CmdLists = frame->cmdLists.Data;
 }
 
-void test_UpdateAndDraw(ImGuiTest* self)
+ImGuiTestFrame* test_CreateFrame()
+{
+    return IM_NEW(ImGuiTestFrame)();
+}
+
+void test_DestroyFrame(ImGuiTestFrame* frame)
+{
+    for (ImDrawList* cmdList : frame->cmdLists)
+        IM_DELETE(cmdList);
+    IM_DELETE(frame);
+}
+
+void test_Update(ImGuiTest* self, ImGuiTestFrame* frame)
 {
     ImGuiIO& io = ImGui::GetIO();
 
@@ -93,7 +148,6 @@ void test_UpdateAndDraw(ImGuiTest* self)
         self->prevWantTextInput = io.WantTextInput;
     }
 
-    ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplAndroid_NewFrame();
     ImGui::NewFrame();
 
@@ -108,16 +162,40 @@ void test_UpdateAndDraw(ImGuiTest* self)
 
     ImDrawList* drawList = ImGui::GetForegroundDrawList();
 
+    // Positions merged in the event queue since last frame
+    for (int i = 0; i < self->lastMotionEvent.motionEvent.historySize * self->lastMotionEvent.motionEvent.pointerCount; ++i)
+    {
+        float x = self->lastMotionEvent.motionEvent.historyX[i];
+        float y = self->lastMotionEvent.motionEvent.historyY[i];
+        drawList->AddCircleFilled({ x, y }, 6.f, IM_COL32(255, 255, 255, 128));
+    }
+
+    // Last raw positions
     for (int i = 0; i < self->lastMotionEvent.motionEvent.pointerCount; ++i)
     {
         float x = self->lastMotionEvent.motionEvent.x[i];
         float y = self->lastMotionEvent.motionEvent.y[i];
+        drawList->AddCircle({ x, y }, 20.f, IM_COL32(255, 255, 255, 128), 0, 3.f);
+    }
+
+    // Resampled for the present time of this frame
+    for (int i = 0; i < self->touches.count; ++i)
+    {
+        if (self->touches.phase[i] == TouchPhase_Ended)
+            continue;
+        float x = self->touches.x[i];
+        float y = self->touches.y[i];
         drawList->AddCircleFilled({ x, y }, 20.f, IM_COL32_WHITE);
         drawList->AddCircle({ x, y }, 90.f, IM_COL32_WHITE);
     }
 
     ImGui::Render();
-    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    frame_CopyDrawData(frame, ImGui::GetDrawData());
 
     self->prevIO = self->io;
 }
+
+void test_Draw(ImGuiTest* self, const ImGuiTestFrame* frame)
+{
+    ImGui_ImplOpenGL3_RenderDrawData((ImDrawData*)&frame->drawData);
+}
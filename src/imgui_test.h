@@ -6,9 +6,13 @@ extern "C"
 #endif
 
 typedef struct InputEvent InputEvent;
+typedef struct TouchState TouchState;
 
 typedef struct ImGuiTest ImGuiTest;
 
+// Copy of the ImGui draw data, test_Draw() can render it while the next frame is built
+typedef struct ImGuiTestFrame ImGuiTestFrame;
+
 typedef struct ImGuiTestIO
 {
     // outputs
@@ -24,8 +28,13 @@ void test_LoadGPUData(ImGuiTest* self);
 void test_UnloadGPUData(ImGuiTest* self);
 void test_SizeChanged(float width, float height);
 void test_HandleEvent(ImGuiTest*, const InputEvent* event);
-void test_InputUnicodeChar(ImGuiTest* self, int unicodeChar);
-void test_UpdateAndDraw(ImGuiTest* self);
+void test_InputText(ImGuiTest* self, const char* utf8); // Committed text, zero-terminated
+void test_SetTouches(ImGuiTest* self, const TouchState* touches); // Resampled, drawn over the raw events
+void test_Update(ImGuiTest* self, ImGuiTestFrame* frame);      // No GL call, can run on any thread (one at a time)
+void test_Draw(ImGuiTest* self, const ImGuiTestFrame* frame); // GL thread
+
+ImGuiTestFrame* test_CreateFrame();
+void test_DestroyFrame(ImGuiTestFrame* frame);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,98 @@
+
+#include <string.h> // memcpy
+#include <assert.h> // assert
+
+#include "common.h"
+#include "input_ring.h"
+
+void inputRing_Init(InputRing* ring, const void* base, uint32_t capacity)
+{
+    assert(((uintptr_t)base & 3) == 0 && (capacity & 3) == 0);
+    *ring = (InputRing){ base, capacity, 0 };
+}
+
+static void inputRing_Skip(InputRing* ring, uint32_t writeOffset, const char* reason)
+{
+    ALOGE("inputRing_Read() %s at offset %u, records dropped", reason, ring->readOffset);
+    ring->readOffset = writeOffset;
+}
+
+bool inputRing_Read(InputRing* ring, uint32_t writeOffset, InputEvent* event)
+{
+    if (ring->base == NULL || writeOffset > ring->capacity)
+        return false;
+
+    for (;;)
+    {
+        if (ring->readOffset == writeOffset)
+            return false;
+
+        // No room for a header before the end, the writer wrapped without a WRAP record
+        if (ring->readOffset + sizeof(int32_t) > ring->capacity)
+        {
+            ring->readOffset = 0;
+            continue;
+        }
+
+        const int32_t* record = (const int32_t*)(ring->base + ring->readOffset);
+        uint32_t type = record[0] & 0xFFFF;
+        uint32_t size = (uint32_t)record[0] >> 16;
+
+        if (type == INPUT_RING_RECORD_WRAP)
+        {
+            ring->readOffset = 0;
+            continue;
+        }
+
+        if (size < sizeof(int32_t) || (size & 3) || ring->readOffset + size > ring->capacity)
+        {
+            inputRing_Skip(ring, writeOffset, "invalid record size");
+            return false;
+        }
+
+        const int32_t* fields = record + 1;
+        uint32_t fieldCount = size / sizeof(int32_t) - 1;
+
+        if (type == INPUT_RING_RECORD_KEY && fieldCount == 5)
+        {
+            *event = (InputEvent){ AINPUT_EVENT_TYPE_KEY };
+            event->keyEvent.action      = fields[0];
+            event->keyEvent.keyCode     = fields[1];
+            event->keyEvent.scanCode    = fields[2];
+            event->keyEvent.unicodeChar = fields[3];
+            event->keyEvent.metaState   = fields[4];
+        }
+        else if (type == INPUT_RING_RECORD_MOTION && fieldCount >= 2
+            && fields[1] > 0 && fields[1] <= MOTION_EVENT_MAX_POINTERS && fieldCount == 4 + 4 * (uint32_t)fields[1])
+        {
+            int pointerCount = fields[1];
+            const int32_t* pointers = fields + 4;
+            *event = (InputEvent){ AINPUT_EVENT_TYPE_MOTION };
+            event->motionEvent.action = fields[0];
+            event->motionEvent.pointerCount = pointerCount;
+            memcpy(&event->motionEvent.eventTime, fields + 2, sizeof(int64_t)); // Only 4-byte aligned
+            memcpy(event->motionEvent.pointerId, pointers, pointerCount * sizeof(int32_t));
+            memcpy(event->motionEvent.x, pointers + pointerCount, pointerCount * sizeof(float));
+            memcpy(event->motionEvent.y, pointers + 2 * pointerCount, pointerCount * sizeof(float));
+            memcpy(event->motionEvent.pressure, pointers + 3 * pointerCount, pointerCount * sizeof(float));
+        }
+        else if (type == INPUT_RING_RECORD_TEXT && fieldCount >= 1
+            && fields[0] > 0 && fields[0] <= TEXT_EVENT_MAX_SIZE && fieldCount == 1 + ((uint32_t)fields[0] + 3) / 4)
+        {
+            int textSize = fields[0];
+            event->type = INPUT_EVENT_TYPE_TEXT;
+            event->isHandled = NULL;
+            event->textEvent.size = textSize;
+            memcpy(event->textEvent.utf8, fields + 1, textSize);
+            event->textEvent.utf8[textSize] = 0;
+        }
+        else
+        {
+            inputRing_Skip(ring, writeOffset, "invalid record");
+            return false;
+        }
+
+        ring->readOffset += size;
+        return true;
+    }
+}
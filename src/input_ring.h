@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "event.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Input records written by NativeActivity.java into a direct ByteBuffer and read in place by native code, no JNI field access
+// Java writes a batch of records then rings the doorbell (NativeWrapper.inputDoorbell) with its write offset
+// Records are native-endian int32/float32 arrays, 4-byte aligned, they never straddle the end of the buffer
+// Keep in sync with NativeActivity.java
+
+#define INPUT_RING_RECORD_WRAP 0   // The rest of the buffer is unused, continue at offset 0
+#define INPUT_RING_RECORD_KEY 1    // action, keyCode, scanCode, unicodeChar, metaState
+#define INPUT_RING_RECORD_MOTION 2 // action, pointerCount, int64 eventTime (ns), pointerId[pointerCount], then float x[], y[], pressure[]
+#define INPUT_RING_RECORD_TEXT 3   // size, then `size` UTF-8 bytes padded to 4 bytes, at most TEXT_EVENT_MAX_SIZE
+
+// First int32 of each record, size in bytes includes the header
+#define INPUT_RING_HEADER(type, size) ((type) | ((size) << 16))
+
+typedef struct InputRing
+{
+    const unsigned char* base;
+    uint32_t capacity;
+    uint32_t readOffset;
+} InputRing;
+
+void inputRing_Init(InputRing* ring, const void* base, uint32_t capacity);
+
+// Reads the next record written before `writeOffset`, false once caught up
+// Malformed records are logged and everything up to `writeOffset` is skipped
+bool inputRing_Read(InputRing* ring, uint32_t writeOffset, InputEvent* event);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,453 @@
+
+#include <stdlib.h> // calloc/free
+#include <assert.h> // assert
+#include <stdatomic.h>
+#include <sched.h>  // sched_yield
+#include <unistd.h> // sysconf
+
+#include <pthread.h>
+
+#include "common.h"
+#include "job_system.h"
+
+#define CACHE_LINE_SIZE 64
+#define JOB_MAX_CONTINUATIONS 8
+#define JOB_SPIN_COUNT 64 // Failed steal rounds before a worker goes to sleep
+
+struct Job
+{
+    JobFunc func; // NULL for a job only grouping its children
+    void* userData;
+    uint32_t begin;
+    uint32_t end;
+
+    Job* parent;
+    _Atomic int32_t unfinishedCount;   // 1 for the job itself + unfinished children + 1 until the last one finished, 0 once the job can be recycled
+    _Atomic int32_t dependencyCount;   // Unfinished dependencies + 1 until submitted
+    _Atomic int32_t continuationCount; // -1 once finished, no continuation can be added anymore
+    _Atomic(Job*) continuations[JOB_MAX_CONTINUATIONS];
+};
+
+// Chase-Lev deque ("Correct and Efficient Work-Stealing for Weak Memory Models", Lê et al. 2013)
+// The owner pushes and pops at the bottom, thieves steal at the top
+typedef struct JobDeque
+{
+    _Atomic int64_t top;
+    char padTop[CACHE_LINE_SIZE - sizeof(int64_t)];
+    _Atomic int64_t bottom;
+    char padBottom[CACHE_LINE_SIZE - sizeof(int64_t)];
+    _Atomic(Job*) jobs[JOB_POOL_SIZE];
+} JobDeque;
+
+typedef struct JobWorker
+{
+    JobDeque deque;
+
+    // Owner thread only
+    Job* jobPool;
+    uint32_t jobPoolIndex;
+    uint32_t randomState;
+
+    JobSystem* jobSystem;
+    int index;
+    pthread_t thread;
+} JobWorker;
+
+struct JobSystem
+{
+    int workerCount;
+    JobWorker* workers;
+
+    _Atomic bool quit;
+
+    // Only used when a worker has nothing to steal
+    _Atomic int sleepingCount;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+};
+
+static _Thread_local JobWorker* tls_worker = NULL;
+
+/*
+================================================================================
+Deque
+================================================================================
+*/
+
+static bool deque_Push(JobDeque* deque, Job* job)
+{
+    int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    int64_t top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    if (bottom - top >= JOB_POOL_SIZE)
+        return false;
+
+    atomic_store_explicit(&deque->jobs[bottom & (JOB_POOL_SIZE - 1)], job, memory_order_relaxed);
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_release);
+    return true;
+}
+
+static Job* deque_Pop(JobDeque* deque)
+{
+    int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+    if (top > bottom)
+    {
+        // Empty
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+        return NULL;
+    }
+
+    Job* job = atomic_load_explicit(&deque->jobs[bottom & (JOB_POOL_SIZE - 1)], memory_order_relaxed);
+    if (top == bottom)
+    {
+        // Last job, race against thieves
+        if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed))
+            job = NULL;
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    }
+    return job;
+}
+
+static Job* deque_Steal(JobDeque* deque)
+{
+    int64_t top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+    if (top >= bottom)
+        return NULL;
+
+    Job* job = atomic_load_explicit(&deque->jobs[top & (JOB_POOL_SIZE - 1)], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed))
+        return NULL;
+    return job;
+}
+
+static bool deque_IsEmpty(JobDeque* deque)
+{
+    return atomic_load_explicit(&deque->top, memory_order_acquire) >= atomic_load_explicit(&deque->bottom, memory_order_acquire);
+}
+
+/*
+================================================================================
+Scheduling
+================================================================================
+*/
+
+static uint32_t worker_Random(JobWorker* worker)
+{
+    // xorshift32
+    uint32_t x = worker->randomState;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return worker->randomState = x;
+}
+
+static Job* worker_GetJob(JobWorker* worker)
+{
+    Job* job = deque_Pop(&worker->deque);
+    if (job)
+        return job;
+
+    // Random victim first, so thieves do not all hit worker 0
+    JobSystem* jobSystem = worker->jobSystem;
+    int start = worker_Random(worker) % jobSystem->workerCount;
+    for (int i = 0; i < jobSystem->workerCount; ++i)
+    {
+        JobWorker* victim = &jobSystem->workers[(start + i) % jobSystem->workerCount];
+        if (victim == worker)
+            continue;
+
+        job = deque_Steal(&victim->deque);
+        if (job)
+            return job;
+    }
+    return NULL;
+}
+
+static bool jobSystem_HasJobs(JobSystem* jobSystem)
+{
+    for (int i = 0; i < jobSystem->workerCount; ++i)
+    {
+        if (!deque_IsEmpty(&jobSystem->workers[i].deque))
+            return true;
+    }
+    return false;
+}
+
+// The fence pairs with the increment of sleepingCount (Dekker style, see eventQueue_WakeConsumer())
+static void jobSystem_WakeWorkers(JobSystem* jobSystem)
+{
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&jobSystem->sleepingCount, memory_order_relaxed) > 0)
+    {
+        pthread_mutex_lock(&jobSystem->mutex);
+        pthread_cond_broadcast(&jobSystem->cond);
+        pthread_mutex_unlock(&jobSystem->mutex);
+    }
+}
+
+static void job_Execute(JobSystem* jobSystem, Job* job);
+
+// The job has no unfinished dependency anymore
+static void job_Schedule(JobSystem* jobSystem, Job* job)
+{
+    JobWorker* worker = tls_worker;
+    if (!deque_Push(&worker->deque, job))
+    {
+        // Deque full, do not wait for a thief
+        job_Execute(jobSystem, job);
+        return;
+    }
+    jobSystem_WakeWorkers(jobSystem);
+}
+
+static void job_ReleaseDependency(JobSystem* jobSystem, Job* job)
+{
+    if (atomic_fetch_sub(&job->dependencyCount, 1) == 1)
+        job_Schedule(jobSystem, job);
+}
+
+static void job_Finish(JobSystem* jobSystem, Job* job)
+{
+    if (atomic_fetch_sub(&job->unfinishedCount, 1) != 2)
+        return;
+
+    // Closes the list, a continuation slot may be reserved but not written yet
+    int32_t continuationCount = atomic_exchange(&job->continuationCount, -1);
+    for (int32_t i = 0; i < continuationCount; ++i)
+    {
+        Job* continuation;
+        while ((continuation = atomic_load_explicit(&job->continuations[i], memory_order_acquire)) == NULL)
+            sched_yield();
+        job_ReleaseDependency(jobSystem, continuation);
+    }
+
+    // The job can be recycled past this point
+    Job* parent = job->parent;
+    atomic_store_explicit(&job->unfinishedCount, 0, memory_order_release);
+
+    if (parent)
+        job_Finish(jobSystem, parent);
+}
+
+static void job_Execute(JobSystem* jobSystem, Job* job)
+{
+    if (job->func)
+        job->func(job->userData, job->begin, job->end);
+    job_Finish(jobSystem, job);
+}
+
+static void* worker_ThreadFunc(void* arg)
+{
+    JobWorker* worker = arg;
+    JobSystem* jobSystem = worker->jobSystem;
+    tls_worker = worker;
+
+    int idleCount = 0;
+    while (!atomic_load_explicit(&jobSystem->quit, memory_order_acquire))
+    {
+        Job* job = worker_GetJob(worker);
+        if (job)
+        {
+            job_Execute(jobSystem, job);
+            idleCount = 0;
+            continue;
+        }
+
+        if (++idleCount < JOB_SPIN_COUNT)
+        {
+            sched_yield();
+            continue;
+        }
+
+        pthread_mutex_lock(&jobSystem->mutex);
+        atomic_fetch_add(&jobSystem->sleepingCount, 1);
+        while (!jobSystem_HasJobs(jobSystem) && !atomic_load(&jobSystem->quit))
+            pthread_cond_wait(&jobSystem->cond, &jobSystem->mutex);
+        atomic_fetch_sub(&jobSystem->sleepingCount, 1);
+        pthread_mutex_unlock(&jobSystem->mutex);
+        idleCount = 0;
+    }
+
+    tls_worker = NULL;
+    return NULL;
+}
+
+/*
+================================================================================
+API
+================================================================================
+*/
+
+JobSystem* jobSystem_Create(int workerCount)
+{
+    if (workerCount <= 0)
+        workerCount = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (workerCount <= 0)
+        workerCount = 1;
+
+    assert(tls_worker == NULL); // One job system per thread
+
+    JobSystem* jobSystem = calloc(1, sizeof(JobSystem));
+    jobSystem->workerCount = workerCount;
+    jobSystem->workers = calloc(workerCount, sizeof(JobWorker));
+    atomic_init(&jobSystem->quit, false);
+    atomic_init(&jobSystem->sleepingCount, 0);
+    pthread_mutex_init(&jobSystem->mutex, NULL);
+    pthread_cond_init(&jobSystem->cond, NULL);
+
+    for (int i = 0; i < workerCount; ++i)
+    {
+        JobWorker* worker = &jobSystem->workers[i];
+        atomic_init(&worker->deque.top, 0);
+        atomic_init(&worker->deque.bottom, 0);
+        worker->jobPool = calloc(JOB_POOL_SIZE, sizeof(Job));
+        worker->randomState = 0x9E3779B9u * (i + 1);
+        worker->jobSystem = jobSystem;
+        worker->index = i;
+    }
+
+    // Worker 0 is the calling thread
+    tls_worker = &jobSystem->workers[0];
+    for (int i = 1; i < workerCount; ++i)
+        pthread_create(&jobSystem->workers[i].thread, NULL, worker_ThreadFunc, &jobSystem->workers[i]);
+
+    ALOGV("jobSystem_Create() %d workers", workerCount);
+    return jobSystem;
+}
+
+void jobSystem_Destroy(JobSystem* jobSystem)
+{
+    assert(tls_worker == &jobSystem->workers[0]);
+    assert(!jobSystem_HasJobs(jobSystem));
+
+    pthread_mutex_lock(&jobSystem->mutex);
+    atomic_store(&jobSystem->quit, true);
+    pthread_cond_broadcast(&jobSystem->cond);
+    pthread_mutex_unlock(&jobSystem->mutex);
+
+    for (int i = 1; i < jobSystem->workerCount; ++i)
+        pthread_join(jobSystem->workers[i].thread, NULL);
+    tls_worker = NULL;
+
+    for (int i = 0; i < jobSystem->workerCount; ++i)
+        free(jobSystem->workers[i].jobPool);
+    free(jobSystem->workers);
+
+    pthread_mutex_destroy(&jobSystem->mutex);
+    pthread_cond_destroy(&jobSystem->cond);
+    free(jobSystem);
+}
+
+int jobSystem_GetWorkerCount(const JobSystem* jobSystem)
+{
+    return jobSystem->workerCount;
+}
+
+Job* jobSystem_CreateJob(JobSystem* jobSystem, JobFunc func, void* userData)
+{
+    JobWorker* worker = tls_worker;
+    assert(worker && worker->jobSystem == jobSystem);
+
+    // Long lived jobs (e.g. the root of a ParallelFor waiting for nested ones) are skipped
+    Job* job;
+    int attempts = 0;
+    do
+    {
+        job = &worker->jobPool[worker->jobPoolIndex++ & (JOB_POOL_SIZE - 1)];
+        assert(++attempts <= JOB_POOL_SIZE); // Pool too small
+    } while (atomic_load_explicit(&job->unfinishedCount, memory_order_acquire) != 0);
+
+    job->func = func;
+    job->userData = userData;
+    job->begin = 0;
+    job->end = 1;
+    job->parent = NULL;
+    atomic_store_explicit(&job->unfinishedCount, 2, memory_order_relaxed);
+    atomic_store_explicit(&job->dependencyCount, 1, memory_order_relaxed);
+    atomic_store_explicit(&job->continuationCount, 0, memory_order_relaxed);
+    for (int i = 0; i < JOB_MAX_CONTINUATIONS; ++i)
+        atomic_store_explicit(&job->continuations[i], NULL, memory_order_relaxed);
+    return job;
+}
+
+Job* jobSystem_CreateChildJob(JobSystem* jobSystem, Job* parent, JobFunc func, void* userData)
+{
+    atomic_fetch_add(&parent->unfinishedCount, 1);
+
+    Job* job = jobSystem_CreateJob(jobSystem, func, userData);
+    job->parent = parent;
+    return job;
+}
+
+void jobSystem_AddDependency(Job* job, Job* dependency)
+{
+    atomic_fetch_add(&job->dependencyCount, 1);
+
+    // Reserve a slot unless the dependency already finished
+    int32_t count = atomic_load(&dependency->continuationCount);
+    do
+    {
+        if (count < 0)
+        {
+            atomic_fetch_sub(&job->dependencyCount, 1);
+            return;
+        }
+        assert(count < JOB_MAX_CONTINUATIONS);
+    } while (!atomic_compare_exchange_weak(&dependency->continuationCount, &count, count + 1));
+
+    atomic_store_explicit(&dependency->continuations[count], job, memory_order_release);
+}
+
+void jobSystem_Submit(JobSystem* jobSystem, Job* job)
+{
+    assert(tls_worker && tls_worker->jobSystem == jobSystem);
+    job_ReleaseDependency(jobSystem, job);
+}
+
+void jobSystem_Wait(JobSystem* jobSystem, Job* job)
+{
+    JobWorker* worker = tls_worker;
+    assert(worker && worker->jobSystem == jobSystem);
+
+    while (!jobSystem_IsFinished(job))
+    {
+        Job* other = worker_GetJob(worker);
+        if (other)
+            job_Execute(jobSystem, other);
+        else
+            sched_yield();
+    }
+}
+
+bool jobSystem_IsFinished(const Job* job)
+{
+    return atomic_load_explicit(&((Job*)job)->unfinishedCount, memory_order_acquire) == 0;
+}
+
+void jobSystem_ParallelFor(JobSystem* jobSystem, uint32_t count, uint32_t batchSize, JobFunc func, void* userData)
+{
+    // Keep enough room in the job pool of this worker
+    const uint32_t maxBatchCount = JOB_POOL_SIZE / 4;
+    if (batchSize == 0)
+        batchSize = 1;
+    if ((count + batchSize - 1) / batchSize > maxBatchCount)
+        batchSize = (count + maxBatchCount - 1) / maxBatchCount;
+
+    Job* root = jobSystem_CreateJob(jobSystem, NULL, NULL);
+    for (uint32_t begin = 0; begin < count; begin += batchSize)
+    {
+        Job* job = jobSystem_CreateChildJob(jobSystem, root, func, userData);
+        job->begin = begin;
+        job->end = (count - begin < batchSize) ? count : begin + batchSize;
+        jobSystem_Submit(jobSystem, job);
+    }
+
+    // Nothing to run for the root itself
+    job_Finish(jobSystem, root);
+    jobSystem_Wait(jobSystem, root);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Work-stealing scheduler: one deque per worker, idle workers steal from the others
+// The thread calling jobSystem_Create() is worker 0 and runs jobs while it waits
+// Jobs can only be created, submitted and waited for from worker threads (worker 0 or from inside a job)
+
+#define JOB_POOL_SIZE 4096 // Per worker, also the capacity of its deque
+
+// Jobs work on a range, [0, 1) unless created by jobSystem_ParallelFor()
+typedef void (*JobFunc)(void* userData, uint32_t begin, uint32_t end);
+
+typedef struct Job Job;
+typedef struct JobSystem JobSystem;
+
+JobSystem* jobSystem_Create(int workerCount); // Including the calling thread, one per core if <= 0
+void jobSystem_Destroy(JobSystem* jobSystem); // From the creating thread, submitted jobs must be finished
+int jobSystem_GetWorkerCount(const JobSystem* jobSystem);
+
+// Job handles are recycled, they stay valid until the creating thread created JOB_POOL_SIZE other jobs
+Job* jobSystem_CreateJob(JobSystem* jobSystem, JobFunc func, void* userData);
+Job* jobSystem_CreateChildJob(JobSystem* jobSystem, Job* parent, JobFunc func, void* userData); // The parent only finishes once its children did
+void jobSystem_AddDependency(Job* job, Job* dependency); // Before submitting `job`, it runs once `dependency` finished
+void jobSystem_Submit(JobSystem* jobSystem, Job* job);
+void jobSystem_Wait(JobSystem* jobSystem, Job* job); // Runs other jobs meanwhile
+bool jobSystem_IsFinished(const Job* job);
+
+// Split [0, count) in batches of batchSize run in parallel, returns once all of them are done
+void jobSystem_ParallelFor(JobSystem* jobSystem, uint32_t count, uint32_t batchSize, JobFunc func, void* userData);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <math.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Scalar vector and matrix types shared by the game and the geometry generators
+// Matrices are column-major, as glUniformMatrix4fv() expects them without transposing
+
+#define TAU 6.283185307179586f
+
+typedef union float2
+{
+    struct { float x, y; };
+    float e[2];
+} float2;
+
+typedef union float3
+{
+    struct { float x, y, z; };
+    float2 xy;
+    float e[3];
+} float3;
+
+typedef union float4
+{
+    struct { float x, y, z, w; };
+    float e[4];
+} float4;
+
+typedef union float4x4
+{
+    float e[16];
+    float4 c[4];
+} float4x4;
+
+static inline float3 v3_add(float3 a, float3 b)
+{
+    return (float3){ { a.x + b.x, a.y + b.y, a.z + b.z } };
+}
+
+static inline float3 v3_sub(float3 a, float3 b)
+{
+    return (float3){ { a.x - b.x, a.y - b.y, a.z - b.z } };
+}
+
+static inline float3 v3_mulf(float3 a, float b)
+{
+    return (float3){ { a.x * b, a.y * b, a.z * b } };
+}
+
+static inline float v3_dot(float3 a, float3 b)
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+static inline float v3_lenghtsq(float3 a)
+{
+    return a.x * a.x + a.y * a.y + a.z * a.z;
+}
+
+static inline float v3_length(float3 a)
+{
+    return sqrtf(v3_lenghtsq(a));
+}
+
+static inline float3 v3_cross(float3 a, float3 b)
+{
+    return (float3){{ a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }};
+}
+
+static inline float3 v3_normalize(float3 a)
+{
+    float invLen = 1.f / v3_length(a);
+    return (float3){ { a.x * invLen, a.y * invLen, a.z * invLen } };
+}
+
+static inline float3 v3_lerp(float3 a, float3 b, float t)
+{
+    return (float3){{
+        (1.f - t) * a.x + t * b.x,
+        (1.f - t) * a.y + t * b.y,
+        (1.f - t) * a.z + t * b.z,
+    }};
+}
+
+static inline float4x4 mat4_rotateY(float angleRadians)
+{
+    float c = cosf(angleRadians);
+    float s = sinf(angleRadians);
+    return (float4x4){{
+          c, 0.f,   s, 0.f,
+        0.f, 1.f, 0.f, 0.f,
+         -s, 0.f,   c, 0.f,
+        0.f, 0.f, 0.f, 1.f,
+    }};
+}
+
+static inline float4x4 mat4_frustum(float left, float right, float bottom, float top, float near, float far)
+{
+    return (float4x4){{
+        (near * 2.f) / (right - left),   0.f,                              0.f,                               0.f,
+        0.f,                             (near * 2.f)   / (top - bottom),  0.f,                               0.f,
+        (right + left) / (right - left), (top + bottom) / (top - bottom), -(far + near) / (far - near),      -1.f,
+        0.f,                             0.f,                             -(far * near * 2.f) / (far - near), 0.f
+    }};
+}
+
+static inline float4x4 mat4_identity(void)
+{
+    return (float4x4){{
+        1.f, 0.f, 0.f, 0.f,
+        0.f, 1.f, 0.f, 0.f,
+        0.f, 0.f, 1.f, 0.f,
+        0.f, 0.f, 0.f, 1.f,
+    }};
+}
+
+static inline float4x4 mat4_translateScale(float3 translation, float scale)
+{
+    return (float4x4){{
+        scale, 0.f, 0.f, 0.f,
+        0.f, scale, 0.f, 0.f,
+        0.f, 0.f, scale, 0.f,
+        translation.x, translation.y, translation.z, 1.f,
+    }};
+}
+
+// a * b, b is applied first
+static inline float4x4 mat4_mul(const float4x4* a, const float4x4* b)
+{
+    float4x4 result;
+    for (int c = 0; c < 4; ++c)
+    {
+        for (int r = 0; r < 4; ++r)
+        {
+            result.c[c].e[r] = a->c[0].e[r] * b->c[c].e[0]
+                             + a->c[1].e[r] * b->c[c].e[1]
+                             + a->c[2].e[r] * b->c[c].e[2]
+                             + a->c[3].e[r] * b->c[c].e[3];
+        }
+    }
+    return result;
+}
+
+static inline float4x4 mat4_perspective(float fovy, float aspect, float near, float far)
+{
+    float top = near * tanf(fovy / 2.f);
+    float right = top * aspect;
+    return mat4_frustum(-right, right, -top, top, near, far);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,108 @@
+
+#include <stdlib.h> // calloc/free
+#include <assert.h> // assert
+#include <unistd.h> // read/write/close
+#include <stdatomic.h>
+
+#include <sys/eventfd.h>
+#include <android/looper.h>
+
+#include "common.h"
+#include "event_queue.h"
+#include "platform_queue.h"
+
+struct PlatformQueue
+{
+    EventQueue* commands;
+    ALooper* looper;
+    int eventFd;
+    atomic_bool wakeupPending; // Set by the producer, cleared by the looper before draining
+    PlatformCommandFunc execute;
+    void* userData;
+};
+
+static int platformQueue_LooperCallback(int fd, int events, void* data)
+{
+    PlatformQueue* queue = data;
+
+    uint64_t count;
+    while (read(fd, &count, sizeof(count)) > 0)
+        ;
+
+    // Cleared before draining, a command posted meanwhile wakes the looper again
+    atomic_exchange(&queue->wakeupPending, false);
+
+    uint32_t size;
+    const void* command;
+    while ((command = eventQueue_Peek(queue->commands, &size)) != NULL)
+    {
+        assert(size == sizeof(PlatformCommand));
+        queue->execute(command, queue->userData);
+        eventQueue_Release(queue->commands);
+    }
+
+    return 1; // Keep the callback registered
+}
+
+PlatformQueue* platformQueue_Create(const PlatformQueueDesc* desc)
+{
+    assert(desc->execute);
+
+    ALooper* looper = ALooper_forThread();
+    if (!looper)
+    {
+        ALOGE("platformQueue_Create() called from a thread without ALooper");
+        return NULL;
+    }
+
+    PlatformQueue* queue = calloc(1, sizeof(PlatformQueue));
+    queue->commands = eventQueue_Create(&(EventQueueDesc){
+        .capacity = desc->capacity * (uint32_t)sizeof(PlatformCommand),
+        .maxElementSize = sizeof(PlatformCommand),
+        .overflow = EventQueueOverflow_Grow, // A lost hideSoftInput would leave the keyboard up
+    });
+    queue->eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    assert(queue->eventFd >= 0);
+    queue->execute = desc->execute;
+    queue->userData = desc->userData;
+
+    queue->looper = looper;
+    ALooper_acquire(looper);
+    ALooper_addFd(looper, queue->eventFd, ALOOPER_POLL_CALLBACK, ALOOPER_EVENT_INPUT, platformQueue_LooperCallback, queue);
+
+    return queue;
+}
+
+void platformQueue_Destroy(PlatformQueue* queue)
+{
+    assert(ALooper_forThread() == queue->looper);
+
+    ALooper_removeFd(queue->looper, queue->eventFd);
+    ALooper_release(queue->looper);
+    close(queue->eventFd);
+
+    EventQueueStats stats = eventQueue_GetStats(queue->commands);
+    ALOGV("platformQueue_Destroy() %u commands posted", stats.receivedCount);
+    eventQueue_Destroy(queue->commands);
+
+    free(queue);
+}
+
+bool platformQueue_Post(PlatformQueue* queue, const PlatformCommand* command)
+{
+    assert(command->type < PlatformCommandType_Count);
+
+    if (!eventQueue_Push(queue->commands, command, sizeof(PlatformCommand)))
+    {
+        ALOGE("platformQueue_Post() command %d dropped", command->type);
+        return false;
+    }
+
+    // Only the first command since the last drain pays for the syscall
+    if (!atomic_exchange(&queue->wakeupPending, true))
+    {
+        uint64_t one = 1;
+        write(queue->eventFd, &one, sizeof(one));
+    }
+    return true;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Commands for the Java UI thread (keyboard, vibration...) posted by the app thread without blocking
+// They are executed from the ALooper of the thread that created the queue, once per wakeup
+// Single producer: only one thread may post
+
+typedef enum PlatformCommandType
+{
+    PlatformCommandType_ShowSoftInput,
+    PlatformCommandType_HideSoftInput,
+    PlatformCommandType_Vibrate,
+    PlatformCommandType_Count
+} PlatformCommandType;
+
+typedef struct PlatformCommand
+{
+    PlatformCommandType type;
+    union
+    {
+        struct { int effectId; } vibrate; // VibrationEffect.EFFECT_*
+    };
+} PlatformCommand;
+
+// Called on the looper thread, in posting order
+typedef void (*PlatformCommandFunc)(const PlatformCommand* command, void* userData);
+
+typedef struct PlatformQueueDesc
+{
+    uint32_t capacity; // In commands, the queue grows if the looper thread falls behind
+    PlatformCommandFunc execute;
+    void* userData;
+} PlatformQueueDesc;
+
+typedef struct PlatformQueue PlatformQueue;
+
+PlatformQueue* platformQueue_Create(const PlatformQueueDesc* desc); // From the looper thread, NULL if it has no ALooper
+void platformQueue_Destroy(PlatformQueue* queue);                   // From the looper thread, pending commands are dropped
+
+// Producer side, never blocks, wakes the looper at most once until it drained the queue
+bool platformQueue_Post(PlatformQueue* queue, const PlatformCommand* command);
+
+#ifdef __cplusplus
+}
+#endif
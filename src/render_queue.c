@@ -0,0 +1,147 @@
+
+#include <stdlib.h> // realloc/free
+#include <string.h> // memcpy/memset
+
+#include "common.h"
+
+#include "gl_state.h"
+#include "render_queue.h"
+
+#define RENDER_KEY_PROGRAM_BITS 12
+#define RENDER_KEY_TEXTURE_BITS 16
+
+uint64_t renderKey_Make(RenderPass pass, GLuint program, GLuint texture, float depth)
+{
+    // The bits of a positive float sort like its value
+    uint32_t depthBits = 0;
+    if (depth > 0.f)
+        memcpy(&depthBits, &depth, sizeof(depthBits));
+
+    uint64_t state = ((uint64_t)(program & ((1u << RENDER_KEY_PROGRAM_BITS) - 1)) << RENDER_KEY_TEXTURE_BITS)
+                   | (texture & ((1u << RENDER_KEY_TEXTURE_BITS) - 1));
+    if (pass == RenderPass_Transparent)
+        return ((uint64_t)pass << 60) | ((uint64_t)(~depthBits) << 28) | state;
+    return ((uint64_t)pass << 60) | (state << 32) | depthBits;
+}
+
+void renderQueue_Init(RenderQueue* queue)
+{
+    *queue = (RenderQueue){ 0 };
+}
+
+void renderQueue_Free(RenderQueue* queue)
+{
+    free(queue->packets);
+    free(queue->items);
+    free(queue->sortScratch);
+    *queue = (RenderQueue){ 0 };
+}
+
+RenderPacket* renderQueue_Append(RenderQueue* queue, uint64_t key)
+{
+    if (queue->count == queue->capacity)
+    {
+        queue->capacity = queue->capacity ? queue->capacity * 2 : 256;
+        queue->packets = realloc(queue->packets, queue->capacity * sizeof(RenderPacket));
+        queue->items = realloc(queue->items, queue->capacity * sizeof(RenderSortItem));
+        queue->sortScratch = realloc(queue->sortScratch, queue->capacity * sizeof(RenderSortItem));
+    }
+
+    int index = queue->count++;
+    queue->items[index] = (RenderSortItem){ key, (uint32_t)index };
+    RenderPacket* packet = &queue->packets[index];
+    memset(packet, 0, sizeof(*packet));
+    return packet;
+}
+
+// LSD radix sort, 8 bits per pass, stable. The histograms of all the passes come from one read of the keys and passes
+// where every key has the same digit are skipped: with few distinct programs and textures most of the key is constant
+void renderQueue_Sort(RenderQueue* queue)
+{
+    int count = queue->count;
+    if (count < 2)
+        return;
+
+    uint32_t histograms[8][256];
+    memset(histograms, 0, sizeof(histograms));
+    for (int i = 0; i < count; ++i)
+    {
+        uint64_t key = queue->items[i].key;
+        for (int digit = 0; digit < 8; ++digit)
+            histograms[digit][(key >> (digit * 8)) & 0xFF]++;
+    }
+
+    RenderSortItem* src = queue->items;
+    RenderSortItem* dst = queue->sortScratch;
+    for (int digit = 0; digit < 8; ++digit)
+    {
+        uint32_t* histogram = histograms[digit];
+        if (histogram[(src[0].key >> (digit * 8)) & 0xFF] == (uint32_t)count)
+            continue;
+
+        uint32_t offset = 0;
+        for (int bucket = 0; bucket < 256; ++bucket)
+        {
+            uint32_t bucketCount = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += bucketCount;
+        }
+
+        for (int i = 0; i < count; ++i)
+            dst[histogram[(src[i].key >> (digit * 8)) & 0xFF]++] = src[i];
+
+        RenderSortItem* swap = src;
+        src = dst;
+        dst = swap;
+    }
+
+    // An odd number of passes leaves the result in the scratch array
+    queue->items = src;
+    queue->sortScratch = dst;
+}
+
+// Redundant binds are skipped by the GL state shadow, which also knows what was bound before the submit and what the
+// callbacks changed
+void renderQueue_Submit(RenderQueue* queue)
+{
+    renderQueue_Sort(queue);
+
+    RenderQueueStats stats = { .packetCount = queue->count };
+    for (int i = 0; i < queue->count; ++i)
+    {
+        const RenderPacket* packet = &queue->packets[queue->items[i].packetIndex];
+
+        if (packet->callback)
+        {
+            packet->callback(packet->userData, packet->data);
+            stats.callbackCount++;
+            continue;
+        }
+
+        glState_UseProgram(packet->program);
+        if (packet->texture)
+            glState_BindTexture(GL_TEXTURE_2D, packet->texture);
+        glState_BindVertexArray(packet->vao);
+        if (packet->uniformBuffer)
+            glState_BindBufferRange(GL_UNIFORM_BUFFER, packet->uniformBinding, packet->uniformBuffer, packet->uniformOffset, packet->uniformSize);
+
+        if (packet->indexType)
+        {
+            if (packet->instanceCount > 1)
+                glDrawElementsInstanced(packet->mode, packet->count, packet->indexType, NULL, packet->instanceCount);
+            else
+                glDrawElements(packet->mode, packet->count, packet->indexType, NULL);
+        }
+        else
+        {
+            if (packet->instanceCount > 1)
+                glDrawArraysInstanced(packet->mode, 0, packet->count, packet->instanceCount);
+            else
+                glDrawArrays(packet->mode, 0, packet->count);
+        }
+        stats.drawCount++;
+    }
+
+    queue->stats = stats;
+    queue->count = 0;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "glad/gles2.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Deferred draw submission: subsystems append packets with a 64-bit sort key, renderQueue_Submit() sorts them
+// (radix sort) and issues the GL calls through the GL state shadow, so binds of what is already bound are skipped
+// GL thread only, buffers the packets read must be uploaded before the submit
+
+typedef enum RenderPass
+{
+    RenderPass_Opaque,      // Sorted by state then front to back
+    RenderPass_Transparent, // Sorted back to front then by state
+    RenderPass_UI,          // Callbacks drawing over everything
+    RenderPass_Count,
+} RenderPass;
+
+// Key layouts, from the most significant bits:
+//   opaque:      pass:4 | program:12 | texture:16 | depth:32
+//   transparent: pass:4 | ~depth:32  | program:12 | texture:16
+// Program and texture names only order the packets, a truncated name can share a key but is still bound
+uint64_t renderKey_Make(RenderPass pass, GLuint program, GLuint texture, float depth); // depth >= 0, view space distance
+
+// Runs instead of a draw, for renderers that set up their own state (ImGui), which must go through gl_state.h
+typedef void (*RenderCallback)(void* userData, const void* data);
+
+typedef struct RenderPacket
+{
+    GLuint program;
+    GLuint texture; // GL_TEXTURE_2D on the active unit, 0 to leave it
+    GLuint vao;
+
+    // Optional uniform block range, bound when uniformBuffer is not 0
+    GLuint uniformBinding;
+    GLuint uniformBuffer;
+    GLintptr uniformOffset;
+    GLsizeiptr uniformSize;
+
+    GLenum mode;
+    GLsizei count;          // Indices, or vertices without indexType
+    GLenum indexType;       // 0 for glDrawArrays
+    GLsizei instanceCount;  // Instanced draw when > 1
+
+    RenderCallback callback;
+    void* userData;
+    const void* data;
+} RenderPacket;
+
+typedef struct RenderSortItem
+{
+    uint64_t key;
+    uint32_t packetIndex;
+} RenderSortItem;
+
+typedef struct RenderQueueStats
+{
+    int packetCount;
+    int drawCount;
+    int callbackCount;
+} RenderQueueStats;
+
+typedef struct RenderQueue
+{
+    RenderPacket* packets;
+    RenderSortItem* items;
+    RenderSortItem* sortScratch;
+    int count;
+    int capacity;
+    RenderQueueStats stats; // Of the last submit
+} RenderQueue;
+
+void renderQueue_Init(RenderQueue* queue);
+void renderQueue_Free(RenderQueue* queue);
+// Returns a zeroed packet to fill, valid until the next append
+RenderPacket* renderQueue_Append(RenderQueue* queue, uint64_t key);
+// Sorts by key, packets with equal keys keep their append order
+void renderQueue_Sort(RenderQueue* queue);
+// Sorts, issues every packet and empties the queue
+void renderQueue_Submit(RenderQueue* queue);
+
+#ifdef __cplusplus
+}
+#endif
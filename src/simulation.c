@@ -0,0 +1,99 @@
+#include <stddef.h> // NULL
+
+#include "common.h"
+#include "job_system.h"
+#include "telemetry.h"
+#include "timing.h"
+
+#include "simulation.h"
+
+void simulation_Init(Simulation* sim, const SimulationDesc* desc)
+{
+    *sim = (Simulation){ .presentOffsetNs = desc->presentOffsetNs };
+    frameClock_Init(&sim->frameClock, &(FrameClockDesc){ .now = desc->now, .userData = desc->nowUserData });
+    touchResampler_Init(&sim->touchResampler, &(TouchResamplerDesc){ .latencyNs = desc->touchLatencyNs });
+    gestureRecognizer_Init(&sim->gestureRecognizer, &(GestureDesc){ 0 });
+    int64_t framePeriodNs = desc->framePeriodNs ? desc->framePeriodNs : TIME_NS_PER_SECOND / 60;
+    sim->telemetry = telemetry_Create((uint32_t)(framePeriodNs / 1000));
+}
+
+static void simulation_TerminateGame(Simulation* sim)
+{
+    game_Terminate(sim->game);
+    jobSystem_Destroy(sim->jobSystem);
+    sim->game = NULL;
+    sim->jobSystem = NULL;
+}
+
+void simulation_Terminate(Simulation* sim)
+{
+    if (sim->game)
+        simulation_TerminateGame(sim);
+    telemetry_Destroy(sim->telemetry);
+    sim->telemetry = NULL;
+}
+
+void simulation_HandleEvent(Simulation* sim, const Event* event)
+{
+    switch (event->type)
+    {
+        case EventType_Create:
+            sim->jobSystem = jobSystem_Create(0);
+            {
+                TIME_SCOPE("game_Init");
+                sim->game = game_Init(sim->jobSystem);
+            }
+            break;
+
+        case EventType_Destroy:
+            simulation_TerminateGame(sim);
+            break;
+
+        case EventType_SurfaceChanged:
+            sim->gameInputs.displayWidth = event->surfaceChanged.width;
+            sim->gameInputs.displayHeight = event->surfaceChanged.height;
+            break;
+
+        case EventType_SurfaceDestroyed:
+            frameClock_Reset(&sim->frameClock); // Time without a surface is not simulated
+            break;
+
+        case EventType_Pause:
+            frameClock_Reset(&sim->frameClock); // Time paused is not simulated
+            touchResampler_Reset(&sim->touchResampler);
+            gestureRecognizer_Cancel(&sim->gestureRecognizer);
+            telemetry_Restart(sim->telemetry);
+            break;
+
+        case EventType_DispatchMotionEvent:
+            touchState_HandleMotion(&sim->touches, &event->dispatchTouchEvent.motionEvent);
+            touchResampler_AddMotion(&sim->touchResampler, &event->dispatchTouchEvent.motionEvent);
+            gestureRecognizer_HandleMotion(&sim->gestureRecognizer, &event->dispatchTouchEvent.motionEvent);
+            break;
+
+        default:
+            break;
+    }
+}
+
+void simulation_BeginFrame(Simulation* sim)
+{
+    touchState_BeginFrame(&sim->touches);
+}
+
+void simulation_Update(Simulation* sim, GameFrame* frame)
+{
+    GameInputs* inputs = &sim->gameInputs;
+    inputs->stepCount = frameClock_Tick(&sim->frameClock);
+    inputs->deltaTime = frameClock_GetFixedDeltaTime(&sim->frameClock);
+    inputs->alpha = frameClock_GetAlpha(&sim->frameClock);
+    inputs->frameDeltaTime = frameClock_GetFrameDeltaTime(&sim->frameClock);
+
+    gestureRecognizer_Update(&sim->gestureRecognizer, sim->frameClock.lastTime);
+    gestureRecognizer_TakeFrame(&sim->gestureRecognizer, &inputs->gestures);
+    inputs->touches = sim->touches;
+    touchResampler_Apply(&sim->touchResampler, sim->frameClock.lastTime + sim->presentOffsetNs, &inputs->touches);
+
+    if (sim->game)
+        game_Update(sim->game, inputs, frame);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "app_event.h"
+#include "frame_clock.h"
+#include "gesture.h"
+#include "touch_resampler.h"
+#include "touch_state.h"
+
+#include "game.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Simulation side of the app thread: the game, the inputs it reads and how events and frames update them
+// Shared by the app thread and tools/replay.c so a replay runs the same handlers, each adds GL, sound and ImGui around it
+
+typedef struct Telemetry Telemetry;
+
+typedef struct SimulationDesc
+{
+    FrameClockNowFunc now;    // time_Now() if NULL, the replay reads the recorded clock
+    void* nowUserData;
+    int64_t framePeriodNs;    // Display refresh period, frames longer than TELEMETRY_JANK_FACTOR times it are janks, 60 Hz if 0
+    int64_t presentOffsetNs;  // From the frame clock reading to when the frame reaches the screen, touches are resampled for then
+    int64_t touchLatencyNs;   // See TouchResamplerDesc
+} SimulationDesc;
+
+typedef struct Simulation
+{
+    int64_t presentOffsetNs;
+
+    JobSystem* jobSystem; // The simulation thread is worker 0, NULL outside Create/Destroy
+    Game* game;           // NULL outside Create/Destroy
+    GameInputs gameInputs;
+    TouchState touches;   // Raw, gameInputs.touches is its resampled copy
+    TouchResampler touchResampler;
+    GestureRecognizer gestureRecognizer;
+    FrameClock frameClock;
+    Telemetry* telemetry; // Recorded by the caller, restarted on pause
+} Simulation;
+
+void simulation_Init(Simulation* sim, const SimulationDesc* desc);
+void simulation_Terminate(Simulation* sim); // Also terminates the game when no Destroy event was handled
+
+// Once the caller handled its own side of the event: on Destroy, the game is terminated last
+void simulation_HandleEvent(Simulation* sim, const Event* event);
+
+void simulation_BeginFrame(Simulation* sim);               // Before handling the events of the frame
+void simulation_Update(Simulation* sim, GameFrame* frame); // Ticks the frame clock, takes the gestures and updates the game
+
+#ifdef __cplusplus
+}
+#endif
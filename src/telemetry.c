@@ -0,0 +1,321 @@
+
+#include <stdlib.h> // calloc/free/qsort
+#include <stdio.h>  // fopen
+#include <string.h> // memmove
+#include <assert.h> // assert
+
+#include <stdatomic.h>
+
+#include "common.h"
+#include "timing.h"
+#include "telemetry.h"
+
+_Static_assert((TELEMETRY_CAPACITY & (TELEMETRY_CAPACITY - 1)) == 0, "TELEMETRY_CAPACITY must be a power of two");
+_Static_assert(sizeof(TelemetryFileHeader) == 24, "TelemetryFileHeader is a file format");
+
+// Records are written with relaxed atomics, readers validate their copy against startedCount (seqlock-like)
+typedef struct TelemetrySlot
+{
+    _Atomic uint32_t values[sizeof(TelemetryRecord) / sizeof(uint32_t)];
+} TelemetrySlot;
+
+struct Telemetry
+{
+    uint32_t targetFrameUs;
+
+    // Producer only
+    int64_t lastSwapTime;
+    uint32_t jankCount;
+
+    _Atomic uint64_t startedCount;   // Records being written or written
+    _Atomic uint64_t completedCount; // Records written
+    _Atomic uint32_t totalJankCount;
+    TelemetrySlot slots[TELEMETRY_CAPACITY];
+
+    _Atomic uint32_t latencyBuckets[2][TELEMETRY_LATENCY_BUCKET_COUNT]; // [vsync]
+};
+
+static uint32_t telemetry_ToUs(int64_t ns)
+{
+    if (ns <= 0)
+        return 0;
+    int64_t us = ns / 1000;
+    return us > UINT32_MAX ? UINT32_MAX : (uint32_t)us;
+}
+
+static bool telemetry_IsJank(uint32_t frameUs, uint32_t targetFrameUs)
+{
+    return frameUs > targetFrameUs * TELEMETRY_JANK_FACTOR;
+}
+
+Telemetry* telemetry_Create(uint32_t targetFrameUs)
+{
+    Telemetry* telemetry = calloc(1, sizeof(Telemetry));
+    telemetry->targetFrameUs = targetFrameUs;
+    return telemetry;
+}
+
+void telemetry_Destroy(Telemetry* telemetry)
+{
+    free(telemetry);
+}
+
+void telemetry_Restart(Telemetry* telemetry)
+{
+    telemetry->lastSwapTime = 0;
+}
+
+void telemetry_Record(Telemetry* telemetry, const FrameTimestamps* timestamps)
+{
+    const int64_t* phases = timestamps->phases;
+    assert(phases[FramePhase_Swap] != 0);
+
+    TelemetryRecord record = {
+        .frameIndex = (uint32_t)timestamps->frameIndex,
+        .frameUs    = telemetry->lastSwapTime ? telemetry_ToUs(phases[FramePhase_Swap] - telemetry->lastSwapTime) : 0,
+        .pollUs     = telemetry_ToUs(phases[FramePhase_Poll]   - phases[FramePhase_Begin]),
+        .updateUs   = telemetry_ToUs(phases[FramePhase_Update] - phases[FramePhase_Poll]),
+        .imguiUs    = telemetry_ToUs(phases[FramePhase_ImGui]  - phases[FramePhase_Update]),
+        .swapUs     = telemetry_ToUs(phases[FramePhase_Swap]   - phases[FramePhase_ImGui]),
+    };
+    telemetry->lastSwapTime = phases[FramePhase_Swap];
+
+    if (telemetry_IsJank(record.frameUs, telemetry->targetFrameUs))
+        telemetry->jankCount++;
+
+    uint64_t index = atomic_load_explicit(&telemetry->completedCount, memory_order_relaxed);
+    TelemetrySlot* slot = &telemetry->slots[index & (TELEMETRY_CAPACITY - 1)];
+
+    atomic_store_explicit(&telemetry->startedCount, index + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    const uint32_t* values = (const uint32_t*)&record;
+    for (int i = 0; i < ARRAYSIZE(slot->values); ++i)
+        atomic_store_explicit(&slot->values[i], values[i], memory_order_relaxed);
+
+    atomic_store_explicit(&telemetry->totalJankCount, telemetry->jankCount, memory_order_relaxed);
+    atomic_store_explicit(&telemetry->completedCount, index + 1, memory_order_release);
+}
+
+void telemetry_RecordLatency(Telemetry* telemetry, int64_t latencyNs, bool vsync)
+{
+    uint32_t bucket = telemetry_ToUs(latencyNs) / TELEMETRY_LATENCY_BUCKET_US;
+    if (bucket >= TELEMETRY_LATENCY_BUCKET_COUNT)
+        bucket = TELEMETRY_LATENCY_BUCKET_COUNT - 1;
+    atomic_fetch_add_explicit(&telemetry->latencyBuckets[vsync][bucket], 1, memory_order_relaxed);
+}
+
+static void telemetry_LogLatency(const uint32_t buckets[TELEMETRY_LATENCY_BUCKET_COUNT], bool vsync)
+{
+    uint32_t count = 0;
+    for (int i = 0; i < TELEMETRY_LATENCY_BUCKET_COUNT; ++i)
+        count += buckets[i];
+
+    if (count == 0)
+        return;
+
+    // Percentiles are the upper bound of the bucket they fall in
+    uint32_t p50 = 0, p95 = 0, sum = 0;
+    char histogram[TELEMETRY_LATENCY_BUCKET_COUNT * 16];
+    int length = 0;
+    for (int i = 0; i < TELEMETRY_LATENCY_BUCKET_COUNT; ++i)
+    {
+        sum += buckets[i];
+        if (!p50 && sum * 2 >= count)
+            p50 = (i + 1) * TELEMETRY_LATENCY_BUCKET_US;
+        if (!p95 && sum * 100 >= count * 95)
+            p95 = (i + 1) * TELEMETRY_LATENCY_BUCKET_US;
+        if (buckets[i])
+            length += snprintf(histogram + length, sizeof(histogram) - length, " <%u:%u", (i + 1) * TELEMETRY_LATENCY_BUCKET_US / 1000, buckets[i]);
+    }
+
+    ALOGV("Input latency (VSYNC %s) over %u frames: p50 < %u ms, p95 < %u ms", vsync ? "on" : "off", count, p50 / 1000, p95 / 1000);
+    ALOGV("  ms:%s", histogram);
+}
+
+static uint32_t telemetry_SnapshotEx(const Telemetry* telemetry, TelemetryRecord records[TELEMETRY_CAPACITY], uint32_t* totalJankCount)
+{
+    Telemetry* self = (Telemetry*)telemetry; // Atomic loads need non-const pointers in C11
+
+    uint64_t end = atomic_load_explicit(&self->completedCount, memory_order_acquire);
+    uint64_t begin = end > TELEMETRY_CAPACITY ? end - TELEMETRY_CAPACITY : 0;
+    if (totalJankCount)
+        *totalJankCount = atomic_load_explicit(&self->totalJankCount, memory_order_relaxed);
+
+    for (uint64_t i = begin; i < end; ++i)
+    {
+        TelemetrySlot* slot = &self->slots[i & (TELEMETRY_CAPACITY - 1)];
+        uint32_t* values = (uint32_t*)&records[i - begin];
+        for (int v = 0; v < ARRAYSIZE(slot->values); ++v)
+            values[v] = atomic_load_explicit(&slot->values[v], memory_order_relaxed);
+    }
+
+    // Records the producer started to overwrite meanwhile may be torn, drop them
+    atomic_thread_fence(memory_order_acquire);
+    uint64_t started = atomic_load_explicit(&self->startedCount, memory_order_relaxed);
+    uint64_t validBegin = started > TELEMETRY_CAPACITY ? started - TELEMETRY_CAPACITY : 0;
+    if (validBegin >= end)
+        return 0;
+
+    if (validBegin > begin)
+    {
+        memmove(records, records + (validBegin - begin), (end - validBegin) * sizeof(TelemetryRecord));
+        begin = validBegin;
+    }
+    return (uint32_t)(end - begin);
+}
+
+uint32_t telemetry_Snapshot(const Telemetry* telemetry, TelemetryRecord records[TELEMETRY_CAPACITY])
+{
+    return telemetry_SnapshotEx(telemetry, records, NULL);
+}
+
+void telemetry_TakeSnapshot(const Telemetry* telemetry, TelemetrySnapshot* snapshot)
+{
+    Telemetry* self = (Telemetry*)telemetry;
+    snapshot->targetFrameUs = telemetry->targetFrameUs;
+    snapshot->recordCount = telemetry_SnapshotEx(telemetry, snapshot->records, &snapshot->totalJankCount);
+    for (int vsync = 0; vsync < 2; ++vsync)
+    {
+        for (int i = 0; i < TELEMETRY_LATENCY_BUCKET_COUNT; ++i)
+            snapshot->latencyBuckets[vsync][i] = atomic_load_explicit(&self->latencyBuckets[vsync][i], memory_order_relaxed);
+    }
+}
+
+bool telemetry_Save(const Telemetry* telemetry, const char* filename)
+{
+    TelemetrySnapshot* snapshot = malloc(sizeof(TelemetrySnapshot));
+    telemetry_TakeSnapshot(telemetry, snapshot);
+    bool success = telemetry_SaveSnapshot(snapshot, filename);
+    free(snapshot);
+    return success;
+}
+
+void telemetry_Log(const Telemetry* telemetry)
+{
+    TelemetrySnapshot* snapshot = malloc(sizeof(TelemetrySnapshot));
+    telemetry_TakeSnapshot(telemetry, snapshot);
+    telemetry_LogSnapshot(snapshot);
+    free(snapshot);
+}
+
+bool telemetry_SaveSnapshot(const TelemetrySnapshot* snapshot, const char* filename)
+{
+    TelemetryFileHeader header = {
+        .magic = TELEMETRY_FILE_MAGIC,
+        .version = TELEMETRY_FILE_VERSION,
+        .recordSize = sizeof(TelemetryRecord),
+        .recordCount = snapshot->recordCount,
+        .targetFrameUs = snapshot->targetFrameUs,
+        .totalJankCount = snapshot->totalJankCount,
+    };
+
+    bool success = false;
+    FILE* file = fopen(filename, "wb");
+    if (file)
+    {
+        success = fwrite(&header, sizeof(header), 1, file) == 1
+               && fwrite(snapshot->records, sizeof(TelemetryRecord), header.recordCount, file) == header.recordCount;
+        success = (fclose(file) == 0) && success;
+    }
+
+    if (success)
+        ALOGV("Telemetry saved to '%s', %u frames", filename, header.recordCount);
+    else
+        ALOGE("Telemetry saving failed on '%s'", filename);
+    return success;
+}
+
+void telemetry_LogSnapshot(const TelemetrySnapshot* snapshot)
+{
+    TelemetryStats stats;
+    telemetry_ComputeStats(snapshot->records, snapshot->recordCount, snapshot->targetFrameUs, &stats);
+
+    static const char* metricNames[] = { "frame", "poll", "update", "imgui", "swap" };
+    _Static_assert(ARRAYSIZE(metricNames) == TelemetryMetric_Count, "");
+
+    if (stats.frameCount)
+    {
+        ALOGV("Telemetry over %u frames: %u janks (%u total)", stats.frameCount, stats.jankCount, snapshot->totalJankCount);
+        for (int metric = 0; metric < TelemetryMetric_Count; ++metric)
+        {
+            const TelemetryPercentiles* p = &stats.metrics[metric];
+            ALOGV("  %-6s p50 %.2f ms, p95 %.2f ms, p99 %.2f ms, max %.2f ms", metricNames[metric],
+                p->p50 / 1000.0, p->p95 / 1000.0, p->p99 / 1000.0, p->max / 1000.0);
+        }
+    }
+
+    telemetry_LogLatency(snapshot->latencyBuckets[true], true);
+    telemetry_LogLatency(snapshot->latencyBuckets[false], false);
+}
+
+/*
+================================================================================
+Stats, shared with the host tools
+================================================================================
+*/
+
+uint32_t telemetry_GetMetric(const TelemetryRecord* record, TelemetryMetric metric)
+{
+    switch (metric)
+    {
+        case TelemetryMetric_Frame:  return record->frameUs;
+        case TelemetryMetric_Poll:   return record->pollUs;
+        case TelemetryMetric_Update: return record->updateUs;
+        case TelemetryMetric_ImGui:  return record->imguiUs;
+        case TelemetryMetric_Swap:   return record->swapUs;
+        default: assert(0); return 0;
+    }
+}
+
+static int compareU32(const void* a, const void* b)
+{
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of sorted values
+static uint32_t percentile(const uint32_t* sorted, uint32_t count, uint32_t percent)
+{
+    uint32_t rank = (percent * count + 99) / 100;
+    return sorted[rank ? rank - 1 : 0];
+}
+
+void telemetry_ComputeStats(const TelemetryRecord* records, uint32_t count, uint32_t targetFrameUs, TelemetryStats* stats)
+{
+    *stats = (TelemetryStats){ 0 };
+    if (count == 0)
+        return;
+
+    uint32_t* values = malloc(count * sizeof(uint32_t));
+    for (int metric = 0; metric < TelemetryMetric_Count; ++metric)
+    {
+        // Frames right after a pause have no frame time
+        uint32_t valueCount = 0;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            if (metric != TelemetryMetric_Frame || records[i].frameUs != 0)
+                values[valueCount++] = telemetry_GetMetric(&records[i], metric);
+        }
+
+        if (valueCount == 0)
+            continue;
+
+        qsort(values, valueCount, sizeof(uint32_t), compareU32);
+        stats->metrics[metric] = (TelemetryPercentiles){
+            .p50 = percentile(values, valueCount, 50),
+            .p95 = percentile(values, valueCount, 95),
+            .p99 = percentile(values, valueCount, 99),
+            .max = values[valueCount - 1],
+        };
+    }
+    free(values);
+
+    stats->frameCount = count;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (telemetry_IsJank(records[i].frameUs, targetFrameUs))
+            stats->jankCount++;
+    }
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Frame-time telemetry: one record per rendered frame, kept in a ring of the last TELEMETRY_CAPACITY frames
+// The app thread records, any thread can compute stats from a snapshot of the ring
+// telemetry_Save() writes a compact binary log, the format below is also read by tools/telemetry_report.c
+
+#define TELEMETRY_CAPACITY 1024 // Power of two
+
+#define TELEMETRY_FILE_MAGIC 0x314D4C54u // "TLM1", little-endian
+#define TELEMETRY_FILE_VERSION 1
+
+// Durations in microseconds, see FramePhase
+typedef struct TelemetryRecord
+{
+    uint32_t frameIndex; // Low bits of the frame index, gaps mean frames missing from the log
+    uint32_t frameUs;    // Between this swap and the previous one
+    uint32_t pollUs;
+    uint32_t updateUs;
+    uint32_t imguiUs;
+    uint32_t swapUs;     // Submit, render and eglSwapBuffers()
+} TelemetryRecord;
+
+typedef enum TelemetryMetric
+{
+    TelemetryMetric_Frame,
+    TelemetryMetric_Poll,
+    TelemetryMetric_Update,
+    TelemetryMetric_ImGui,
+    TelemetryMetric_Swap,
+    TelemetryMetric_Count,
+} TelemetryMetric;
+
+typedef struct TelemetryFileHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t recordSize;    // sizeof(TelemetryRecord)
+    uint32_t recordCount;   // Records following the header, oldest first
+    uint32_t targetFrameUs; // Frames longer than TELEMETRY_JANK_FACTOR times this are janks
+    uint32_t totalJankCount; // Since the app started, including frames no longer in the log
+    uint32_t reserved;
+} TelemetryFileHeader;
+
+#define TELEMETRY_JANK_FACTOR 1.5f
+
+// Input-to-swap latency histogram, split by VSYNC state (see ImGuiTestIO::disableVSYNCOnMotion)
+#define TELEMETRY_LATENCY_BUCKET_US 2000
+#define TELEMETRY_LATENCY_BUCKET_COUNT 32 // The last bucket also counts longer latencies
+
+typedef struct TelemetryPercentiles
+{
+    uint32_t p50;
+    uint32_t p95;
+    uint32_t p99;
+    uint32_t max;
+} TelemetryPercentiles;
+
+typedef struct TelemetryStats
+{
+    uint32_t frameCount;
+    uint32_t jankCount;
+    TelemetryPercentiles metrics[TelemetryMetric_Count]; // In microseconds
+} TelemetryStats;
+
+// Copy of the telemetry at one point in time, to log and save it later on another thread or without holding up the caller
+typedef struct TelemetrySnapshot
+{
+    uint32_t targetFrameUs;
+    uint32_t totalJankCount;
+    uint32_t recordCount;
+    TelemetryRecord records[TELEMETRY_CAPACITY]; // Oldest first
+    uint32_t latencyBuckets[2][TELEMETRY_LATENCY_BUCKET_COUNT]; // [vsync]
+} TelemetrySnapshot;
+
+typedef struct FrameTimestamps FrameTimestamps;
+typedef struct Telemetry Telemetry;
+
+Telemetry* telemetry_Create(uint32_t targetFrameUs);
+void telemetry_Destroy(Telemetry* telemetry);
+
+void telemetry_Record(Telemetry* telemetry, const FrameTimestamps* timestamps); // Single producer, frames in order, Swap reached
+void telemetry_Restart(Telemetry* telemetry); // Producer, the next frame time is not measured (e.g. after a pause)
+void telemetry_RecordLatency(Telemetry* telemetry, int64_t latencyNs, bool vsync); // Any thread
+uint32_t telemetry_Snapshot(const Telemetry* telemetry, TelemetryRecord records[TELEMETRY_CAPACITY]); // Oldest first, returns the record count
+bool telemetry_Save(const Telemetry* telemetry, const char* filename);
+void telemetry_Log(const Telemetry* telemetry);
+
+// Copies, no allocation nor I/O: cheap enough for a handler the UI thread waits for
+void telemetry_TakeSnapshot(const Telemetry* telemetry, TelemetrySnapshot* snapshot);
+bool telemetry_SaveSnapshot(const TelemetrySnapshot* snapshot, const char* filename);
+void telemetry_LogSnapshot(const TelemetrySnapshot* snapshot);
+
+// Also used on the host, does not depend on a Telemetry
+uint32_t telemetry_GetMetric(const TelemetryRecord* record, TelemetryMetric metric);
+void telemetry_ComputeStats(const TelemetryRecord* records, uint32_t count, uint32_t targetFrameUs, TelemetryStats* stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,75 @@
+
+#include <assert.h> // assert
+#include <time.h>   // clock_gettime
+
+#include <stdatomic.h>
+
+#include "common.h"
+#include "timing.h"
+
+typedef struct FrameSlot
+{
+    _Atomic uint64_t frameIndex;
+    _Atomic int64_t phases[FramePhase_Count];
+} FrameSlot;
+
+static FrameSlot g_frames[TIME_FRAME_HISTORY];
+static uint64_t g_nextFrameIndex = 1; // 0 marks unused slots
+
+int64_t time_Now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_nsec + t.tv_sec * TIME_NS_PER_SECOND;
+}
+
+void time_ScopeEnd(TimeScope* scope)
+{
+    ALOGV("%s: %.3f ms", scope->name, time_ToMs(time_Now() - scope->start));
+}
+
+/*
+================================================================================
+Frame phases
+================================================================================
+*/
+
+uint64_t time_BeginFrame(void)
+{
+    uint64_t frameIndex = g_nextFrameIndex++;
+    FrameSlot* slot = &g_frames[frameIndex % TIME_FRAME_HISTORY];
+
+    // Readers check frameIndex before and after copying the phases, the slot is invalid meanwhile
+    atomic_store_explicit(&slot->frameIndex, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    for (int i = 0; i < FramePhase_Count; ++i)
+        atomic_store_explicit(&slot->phases[i], 0, memory_order_relaxed);
+    atomic_store_explicit(&slot->frameIndex, frameIndex, memory_order_release);
+
+    time_MarkPhase(frameIndex, FramePhase_Begin);
+    return frameIndex;
+}
+
+void time_MarkPhase(uint64_t frameIndex, FramePhase phase)
+{
+    assert(phase < FramePhase_Count);
+    FrameSlot* slot = &g_frames[frameIndex % TIME_FRAME_HISTORY];
+
+    // A late thread must not write into a recycled slot
+    if (atomic_load_explicit(&slot->frameIndex, memory_order_acquire) == frameIndex)
+        atomic_store_explicit(&slot->phases[phase], time_Now(), memory_order_relaxed);
+}
+
+bool time_GetFrame(uint64_t frameIndex, FrameTimestamps* timestamps)
+{
+    const FrameSlot* slot = &g_frames[frameIndex % TIME_FRAME_HISTORY];
+    if (frameIndex == 0 || atomic_load_explicit(&slot->frameIndex, memory_order_acquire) != frameIndex)
+        return false;
+
+    timestamps->frameIndex = frameIndex;
+    for (int i = 0; i < FramePhase_Count; ++i)
+        timestamps->phases[i] = atomic_load_explicit(&slot->phases[i], memory_order_relaxed);
+
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&slot->frameIndex, memory_order_relaxed) == frameIndex;
+}
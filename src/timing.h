@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// One monotonic nanosecond clock shared by every subsystem, and a ring of per-frame phase timestamps
+
+#define TIME_NS_PER_MS 1000000LL
+#define TIME_NS_PER_SECOND 1000000000LL
+
+int64_t time_Now(void); // Nanoseconds, CLOCK_MONOTONIC
+
+static inline double time_ToMs(int64_t ns)      { return (double)ns / TIME_NS_PER_MS; }
+static inline double time_ToSeconds(int64_t ns) { return (double)ns / TIME_NS_PER_SECOND; }
+
+// Scoped timer, logs the duration of the enclosing block when it exits
+// e.g. { TIME_SCOPE("game_Init"); ... }
+typedef struct TimeScope
+{
+    const char* name;
+    int64_t start;
+} TimeScope;
+
+void time_ScopeEnd(TimeScope* scope);
+
+#define TIME_CONCAT_(a, b) a##b
+#define TIME_CONCAT(a, b) TIME_CONCAT_(a, b)
+#define TIME_SCOPE(name) TimeScope TIME_CONCAT(timeScope, __LINE__) __attribute__((cleanup(time_ScopeEnd))) = { name, time_Now() }
+
+// Each phase timestamp is taken when the phase ends, the duration of a phase is the difference with the previous one
+// Swap is marked by the thread rendering the frame, which may not be the one that began it
+typedef enum FramePhase
+{
+    FramePhase_Begin,
+    FramePhase_Poll,   // Events handled
+    FramePhase_Update, // game_Update()
+    FramePhase_ImGui,  // test_Update()
+    FramePhase_Swap,   // eglSwapBuffers() returned
+    FramePhase_Count,
+} FramePhase;
+
+#define TIME_FRAME_HISTORY 128 // Frames kept in the ring
+
+typedef struct FrameTimestamps
+{
+    uint64_t frameIndex;
+    int64_t phases[FramePhase_Count]; // 0 if the phase was not reached (yet)
+} FrameTimestamps;
+
+uint64_t time_BeginFrame(void);                             // Frame producer thread only, marks FramePhase_Begin
+void time_MarkPhase(uint64_t frameIndex, FramePhase phase); // Any thread
+bool time_GetFrame(uint64_t frameIndex, FrameTimestamps* timestamps); // False once the frame was overwritten in the ring
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,255 @@
+
+#include <string.h> // memmove
+#include <math.h>   // sqrt
+
+#include "common.h"
+#include "timing.h"
+#include "touch_resampler.h"
+
+static TouchTrack* touchResampler_FindTrack(const TouchResampler* resampler, int32_t pointerId)
+{
+    for (int i = 0; i < MOTION_EVENT_MAX_POINTERS; ++i)
+        if (resampler->tracks[i].pointerId == pointerId)
+            return (TouchTrack*)&resampler->tracks[i];
+    return NULL;
+}
+
+static TouchTrack* touchResampler_StartTrack(TouchResampler* resampler, int32_t pointerId)
+{
+    TouchTrack* track = touchResampler_FindTrack(resampler, pointerId);
+    if (!track)
+        track = touchResampler_FindTrack(resampler, -1);
+    if (track)
+    {
+        track->pointerId = pointerId;
+        track->count = 0;
+    }
+    return track;
+}
+
+static void touchResampler_EndTrack(TouchResampler* resampler, int32_t pointerId)
+{
+    TouchTrack* track = touchResampler_FindTrack(resampler, pointerId);
+    if (track)
+        *track = (TouchTrack){ .pointerId = -1 };
+}
+
+static void touchTrack_Push(TouchTrack* track, int64_t time, float x, float y)
+{
+    if (track->count > 0)
+    {
+        int64_t newest = track->time[track->count - 1];
+        if (time < newest)
+            return;
+
+        // Same millisecond, keep the latest position
+        if (time == newest)
+        {
+            track->x[track->count - 1] = x;
+            track->y[track->count - 1] = y;
+            return;
+        }
+    }
+
+    if (track->count == TOUCH_RESAMPLER_MAX_SAMPLES)
+    {
+        int keep = TOUCH_RESAMPLER_MAX_SAMPLES - 1;
+        memmove(track->time, track->time + 1, keep * sizeof(int64_t));
+        memmove(track->x, track->x + 1, keep * sizeof(float));
+        memmove(track->y, track->y + 1, keep * sizeof(float));
+        track->count = keep;
+    }
+
+    track->time[track->count] = time;
+    track->x[track->count] = x;
+    track->y[track->count] = y;
+    track->count++;
+}
+
+void touchResampler_Init(TouchResampler* resampler, const TouchResamplerDesc* desc)
+{
+    resampler->desc = *desc;
+    if (resampler->desc.maxPredictionNs == 0)
+        resampler->desc.maxPredictionNs = 8 * TIME_NS_PER_MS;
+    if (resampler->desc.minSampleDeltaNs == 0)
+        resampler->desc.minSampleDeltaNs = 2 * TIME_NS_PER_MS;
+
+    touchResampler_Reset(resampler);
+}
+
+void touchResampler_Reset(TouchResampler* resampler)
+{
+    for (int i = 0; i < MOTION_EVENT_MAX_POINTERS; ++i)
+        resampler->tracks[i] = (TouchTrack){ .pointerId = -1 };
+}
+
+void touchResampler_AddMotion(TouchResampler* resampler, const MotionEvent* motionEvent)
+{
+    int action = motionEvent_GetActionMasked(motionEvent);
+    int index = motionEvent_GetActionIndex(motionEvent);
+    int pointerCount = motionEvent->pointerCount;
+
+    if (action == AMOTION_EVENT_ACTION_DOWN)
+        touchResampler_Reset(resampler);
+    if ((action == AMOTION_EVENT_ACTION_DOWN || action == AMOTION_EVENT_ACTION_POINTER_DOWN) && index < pointerCount)
+        touchResampler_StartTrack(resampler, motionEvent->pointerId[index]);
+
+    // Pointers already down when the resampler was reset get a track on their next sample
+    for (int p = 0; p < pointerCount; ++p)
+    {
+        TouchTrack* track = touchResampler_FindTrack(resampler, motionEvent->pointerId[p]);
+        if (!track)
+            track = touchResampler_StartTrack(resampler, motionEvent->pointerId[p]);
+        if (!track)
+            continue;
+
+        for (int i = 0; i < motionEvent->historySize; ++i)
+            touchTrack_Push(track, motionEvent->historyTime[i], motionEvent->historyX[i * pointerCount + p], motionEvent->historyY[i * pointerCount + p]);
+        touchTrack_Push(track, motionEvent->eventTime, motionEvent->x[p], motionEvent->y[p]);
+    }
+
+    if (action == AMOTION_EVENT_ACTION_UP || action == AMOTION_EVENT_ACTION_CANCEL)
+        touchResampler_Reset(resampler);
+    else if (action == AMOTION_EVENT_ACTION_POINTER_UP && index < pointerCount)
+        touchResampler_EndTrack(resampler, motionEvent->pointerId[index]);
+}
+
+bool touchResampler_Sample(const TouchResampler* resampler, int32_t pointerId, int64_t time, float* x, float* y)
+{
+    const TouchTrack* track = touchResampler_FindTrack(resampler, pointerId);
+    if (pointerId < 0 || !track || track->count == 0)
+        return false;
+
+    int newest = track->count - 1;
+    *x = track->x[newest];
+    *y = track->y[newest];
+
+    if (time <= track->time[0])
+    {
+        *x = track->x[0];
+        *y = track->y[0];
+        return true;
+    }
+
+    // Interpolation between the two samples around `time`
+    if (time <= track->time[newest])
+    {
+        int i = 1;
+        while (track->time[i] < time)
+            ++i;
+        float t = (float)(time - track->time[i - 1]) / (float)(track->time[i] - track->time[i - 1]);
+        *x = track->x[i - 1] + (track->x[i] - track->x[i - 1]) * t;
+        *y = track->y[i - 1] + (track->y[i] - track->y[i - 1]) * t;
+        return true;
+    }
+
+    // Prediction from the velocity between the newest sample and one far enough before it, noisy panels give jittery deltas otherwise
+    if (resampler->desc.maxPredictionNs < 0)
+        return true;
+
+    int previous = newest - 1;
+    while (previous > 0 && track->time[newest] - track->time[previous] < resampler->desc.minSampleDeltaNs)
+        --previous;
+    if (previous < 0 || track->time[newest] - track->time[previous] < resampler->desc.minSampleDeltaNs)
+        return true;
+
+    int64_t ahead = time - track->time[newest];
+    if (ahead > resampler->desc.maxPredictionNs)
+        ahead = resampler->desc.maxPredictionNs;
+
+    float t = (float)ahead / (float)(track->time[newest] - track->time[previous]);
+    *x += (track->x[newest] - track->x[previous]) * t;
+    *y += (track->y[newest] - track->y[previous]) * t;
+    return true;
+}
+
+void touchResampler_Apply(const TouchResampler* resampler, int64_t presentTime, TouchState* touches)
+{
+    int64_t time = presentTime - resampler->desc.latencyNs;
+    for (int i = 0; i < touches->count; ++i)
+    {
+        if (touches->phase[i] == TouchPhase_Ended)
+            continue;
+        touchResampler_Sample(resampler, touches->pointerId[i], time, &touches->x[i], &touches->y[i]);
+    }
+}
+
+/*
+================================================================================
+Offline evaluation
+================================================================================
+*/
+
+static void touchResamplerError_Add(TouchResamplerError* error, float dx, float dy)
+{
+    float distance = sqrtf(dx * dx + dy * dy);
+    error->count++;
+    error->sum += distance;
+    error->sumSquares += (double)distance * distance;
+    if (distance > error->max)
+        error->max = distance;
+}
+
+static void touchResampler_AddSampleError(const TouchResampler* resampler, int32_t pointerId, int64_t time, float x, float y, TouchResamplerError* error)
+{
+    float predictedX, predictedY;
+    if (!touchResampler_Sample(resampler, pointerId, time, &predictedX, &predictedY))
+        return;
+
+    touchResamplerError_Add(error, predictedX - x, predictedY - y);
+}
+
+void touchResampler_AddError(const TouchResampler* resampler, const MotionEvent* motionEvent, TouchResamplerError* error)
+{
+    // Only moves, a down has nothing to predict from and an up repeats the last move
+    if (motionEvent_GetActionMasked(motionEvent) != AMOTION_EVENT_ACTION_MOVE)
+        return;
+
+    int pointerCount = motionEvent->pointerCount;
+    for (int p = 0; p < pointerCount; ++p)
+    {
+        for (int i = 0; i < motionEvent->historySize; ++i)
+            touchResampler_AddSampleError(resampler, motionEvent->pointerId[p], motionEvent->historyTime[i],
+                motionEvent->historyX[i * pointerCount + p], motionEvent->historyY[i * pointerCount + p], error);
+        touchResampler_AddSampleError(resampler, motionEvent->pointerId[p], motionEvent->eventTime, motionEvent->x[p], motionEvent->y[p], error);
+    }
+}
+
+void touchResampler_LogError(const TouchResamplerError* error, const char* name)
+{
+    if (error->count == 0)
+    {
+        ALOGV("%s: no sample", name);
+        return;
+    }
+
+    ALOGV("%s: %d samples, mean %.2f px, rms %.2f px, max %.2f px", name, error->count,
+        error->sum / error->count, sqrt(error->sumSquares / error->count), error->max);
+}
+
+void touchResampler_AddFrameError(const TouchResampler* resampler, int64_t presentTime, const TouchState* raw,
+    const TouchState* resampled, TouchResamplerFrameError* error)
+{
+    // touchResampler_Apply() works on a copy of the raw touches, slots match
+    int64_t time = presentTime - resampler->desc.latencyNs;
+    for (int i = 0; i < raw->count && i < resampled->count; ++i)
+    {
+        if (raw->phase[i] == TouchPhase_Ended)
+            continue;
+
+        const TouchTrack* track = touchResampler_FindTrack(resampler, raw->pointerId[i]);
+        if (!track || track->count == 0)
+            continue;
+
+        if (time < track->time[0])
+            error->staleCount++;
+        touchResamplerError_Add(&error->distance, resampled->x[i] - raw->x[i], resampled->y[i] - raw->y[i]);
+    }
+}
+
+void touchResampler_LogFrameError(const TouchResamplerFrameError* error, const char* name)
+{
+    touchResampler_LogError(&error->distance, name);
+    if (error->staleCount)
+        ALOGE("%s: %d touches resampled before their oldest sample, the frame clock does not match the event times", name, error->staleCount);
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "event.h"
+#include "touch_state.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Touch panels sample at their own rate, out of phase with the display
+// The resampler keeps the recent samples of each pointer and moves touches to where they should be at the present time of the frame:
+// interpolated between two samples when the target time is covered, extrapolated from the newest ones otherwise
+
+#define TOUCH_RESAMPLER_MAX_SAMPLES 16 // Per pointer
+
+typedef struct TouchResamplerDesc
+{
+    int64_t latencyNs;        // Target time is the present time minus this, larger values interpolate more and predict less
+    int64_t maxPredictionNs;  // Extrapolation beyond the newest sample is clamped, 8 ms if 0, < 0 disables prediction
+    int64_t minSampleDeltaNs; // Samples closer than this are not used for velocities, 2 ms if 0
+} TouchResamplerDesc;
+
+typedef struct TouchTrack
+{
+    int32_t pointerId; // -1 if unused
+    int count;         // Samples, oldest first
+    int64_t time[TOUCH_RESAMPLER_MAX_SAMPLES];
+    float x[TOUCH_RESAMPLER_MAX_SAMPLES];
+    float y[TOUCH_RESAMPLER_MAX_SAMPLES];
+} TouchTrack;
+
+typedef struct TouchResampler
+{
+    TouchResamplerDesc desc;
+    TouchTrack tracks[MOTION_EVENT_MAX_POINTERS];
+} TouchResampler;
+
+void touchResampler_Init(TouchResampler* resampler, const TouchResamplerDesc* desc);
+void touchResampler_Reset(TouchResampler* resampler); // Forgets every pointer
+
+// Adds the history and current samples, tracks start on DOWN/POINTER_DOWN and are dropped on UP/POINTER_UP/CANCEL
+void touchResampler_AddMotion(TouchResampler* resampler, const MotionEvent* motionEvent);
+
+// Position of the pointer at `time`, false if the pointer is not down
+bool touchResampler_Sample(const TouchResampler* resampler, int32_t pointerId, int64_t time, float* x, float* y);
+
+// Moves the touches that are still down to their position at presentTime - latencyNs, ended touches keep their last position
+void touchResampler_Apply(const TouchResampler* resampler, int64_t presentTime, TouchState* touches);
+
+/*
+================================================================================
+Offline evaluation
+================================================================================
+*/
+
+// Prediction error against the real samples, in pixels
+typedef struct TouchResamplerError
+{
+    int count;
+    double sum;
+    double sumSquares;
+    float max;
+} TouchResamplerError;
+
+// Predicts each sample of `motionEvent` at its own time from the samples given so far, before adding them
+// Feed the resampler with samples at least `horizon` older to measure the error of predicting that far ahead
+void touchResampler_AddError(const TouchResampler* resampler, const MotionEvent* motionEvent, TouchResamplerError* error);
+void touchResampler_LogError(const TouchResamplerError* error, const char* name);
+
+// Touches of each frame after touchResampler_Apply() against the raw ones they were resampled from
+typedef struct TouchResamplerFrameError
+{
+    TouchResamplerError distance; // From the newest raw sample, per touch still down
+    int staleCount;               // Touches resampled before their oldest sample: the frame clock and the event times disagree
+} TouchResamplerFrameError;
+
+void touchResampler_AddFrameError(const TouchResampler* resampler, int64_t presentTime, const TouchState* raw,
+    const TouchState* resampled, TouchResamplerFrameError* error);
+void touchResampler_LogFrameError(const TouchResamplerFrameError* error, const char* name);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,136 @@
+
+#include "common.h"
+#include "touch_state.h"
+
+void touchState_BeginFrame(TouchState* state)
+{
+    int count = 0;
+    for (int i = 0; i < state->count; ++i)
+    {
+        if (state->phase[i] == TouchPhase_Ended)
+            continue;
+
+        state->pointerId[count] = state->pointerId[i];
+        state->phase[count]     = TouchPhase_Stationary;
+        state->canceled[count]  = false;
+        state->x[count]         = state->x[i];
+        state->y[count]         = state->y[i];
+        state->pressure[count]  = state->pressure[i];
+        state->startX[count]    = state->startX[i];
+        state->startY[count]    = state->startY[i];
+        state->startTime[count] = state->startTime[i];
+        ++count;
+    }
+    state->count = count;
+}
+
+int touchState_Find(const TouchState* state, int32_t pointerId)
+{
+    // Ended touches stay in the snapshot, a new touch with the same id gets its own slot
+    for (int i = 0; i < state->count; ++i)
+        if (state->pointerId[i] == pointerId && state->phase[i] != TouchPhase_Ended)
+            return i;
+    return -1;
+}
+
+static void touchState_Down(TouchState* state, const MotionEvent* motionEvent, int index)
+{
+    int32_t pointerId = motionEvent->pointerId[index];
+    int slot = touchState_Find(state, pointerId);
+    if (slot < 0)
+    {
+        if (state->count == TOUCH_STATE_MAX_TOUCHES)
+        {
+            ALOGE("touchState_Down() too many touches, pointer %d ignored", pointerId);
+            return;
+        }
+        slot = state->count++;
+    }
+
+    state->pointerId[slot] = pointerId;
+    state->phase[slot]     = TouchPhase_Began;
+    state->canceled[slot]  = false;
+    state->x[slot]         = state->startX[slot] = motionEvent->x[index];
+    state->y[slot]         = state->startY[slot] = motionEvent->y[index];
+    state->pressure[slot]  = motionEvent->pressure[index];
+    state->startTime[slot] = motionEvent->receivedTime;
+}
+
+static void touchState_Up(TouchState* state, const MotionEvent* motionEvent, int index, bool canceled)
+{
+    int slot = touchState_Find(state, motionEvent->pointerId[index]);
+    if (slot < 0)
+        return;
+
+    state->phase[slot]    = TouchPhase_Ended;
+    state->canceled[slot] = canceled;
+    state->x[slot]        = motionEvent->x[index];
+    state->y[slot]        = motionEvent->y[index];
+    state->pressure[slot] = motionEvent->pressure[index];
+}
+
+static void touchState_Move(TouchState* state, const MotionEvent* motionEvent)
+{
+    for (int i = 0; i < motionEvent->pointerCount; ++i)
+    {
+        int slot = touchState_Find(state, motionEvent->pointerId[i]);
+        if (slot < 0)
+            continue;
+
+        if (state->x[slot] != motionEvent->x[i] || state->y[slot] != motionEvent->y[i])
+        {
+            // A touch that began this frame stays Began so the down is not missed
+            if (state->phase[slot] == TouchPhase_Stationary)
+                state->phase[slot] = TouchPhase_Moved;
+            state->x[slot] = motionEvent->x[i];
+            state->y[slot] = motionEvent->y[i];
+        }
+        state->pressure[slot] = motionEvent->pressure[i];
+    }
+}
+
+static void touchState_EndAll(TouchState* state, bool canceled)
+{
+    for (int i = 0; i < state->count; ++i)
+    {
+        if (state->phase[i] != TouchPhase_Ended)
+        {
+            state->phase[i] = TouchPhase_Ended;
+            state->canceled[i] = canceled;
+        }
+    }
+}
+
+void touchState_HandleMotion(TouchState* state, const MotionEvent* motionEvent)
+{
+    int index = motionEvent_GetActionIndex(motionEvent);
+    switch (motionEvent_GetActionMasked(motionEvent))
+    {
+        case AMOTION_EVENT_ACTION_DOWN:
+        case AMOTION_EVENT_ACTION_POINTER_DOWN:
+            if (index < motionEvent->pointerCount)
+                touchState_Down(state, motionEvent, index);
+            break;
+
+        case AMOTION_EVENT_ACTION_POINTER_UP:
+            if (index < motionEvent->pointerCount)
+                touchState_Up(state, motionEvent, index, false);
+            break;
+
+        case AMOTION_EVENT_ACTION_UP: // Last pointer, also ends the ones beyond MOTION_EVENT_MAX_POINTERS
+            touchState_Up(state, motionEvent, 0, false);
+            touchState_EndAll(state, false);
+            break;
+
+        case AMOTION_EVENT_ACTION_MOVE:
+            touchState_Move(state, motionEvent);
+            break;
+
+        case AMOTION_EVENT_ACTION_CANCEL:
+            touchState_EndAll(state, true);
+            break;
+
+        default:
+            break;
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "event.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Per-frame snapshot of the active touches built from the motion events, game code reads it without scanning events
+// Touches keep their slot from down to up, slots are only compacted by touchState_BeginFrame()
+
+#define TOUCH_STATE_MAX_TOUCHES MOTION_EVENT_MAX_POINTERS
+
+typedef enum TouchPhase
+{
+    TouchPhase_Began,      // Went down this frame, may have moved since
+    TouchPhase_Moved,
+    TouchPhase_Stationary,
+    TouchPhase_Ended,      // Went up (or canceled) this frame, removed by the next touchState_BeginFrame()
+} TouchPhase;
+
+// Struct of arrays indexed by slot, in order of first contact
+typedef struct TouchState
+{
+    int count;
+    int32_t pointerId[TOUCH_STATE_MAX_TOUCHES];
+    uint8_t phase[TOUCH_STATE_MAX_TOUCHES];  // TouchPhase
+    bool canceled[TOUCH_STATE_MAX_TOUCHES];  // Ended by ACTION_CANCEL, not a release
+    float x[TOUCH_STATE_MAX_TOUCHES];
+    float y[TOUCH_STATE_MAX_TOUCHES];
+    float pressure[TOUCH_STATE_MAX_TOUCHES];
+    float startX[TOUCH_STATE_MAX_TOUCHES];   // Where the touch went down
+    float startY[TOUCH_STATE_MAX_TOUCHES];
+    int64_t startTime[TOUCH_STATE_MAX_TOUCHES]; // receivedTime of the down event
+} TouchState;
+
+void touchState_BeginFrame(TouchState* state); // Drops ended touches, the others become stationary
+void touchState_HandleMotion(TouchState* state, const MotionEvent* motionEvent);
+int touchState_Find(const TouchState* state, int32_t pointerId); // Slot, -1 if not down
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,125 @@
+
+#include <assert.h> // assert
+#include <stddef.h> // NULL
+
+#include "common.h"
+
+#include "gl_state.h"
+#include "uniform_ring.h"
+
+#define UNIFORM_RING_WAIT_TIMEOUT_NS 1000000000ull
+
+static int align_Up(int size, int alignment)
+{
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+static void uniformRing_Allocate(UniformRing* ring, int regionSize)
+{
+    ring->regionSize = align_Up(regionSize, ring->alignment);
+    ring->regionIndex = UNIFORM_RING_REGION_COUNT - 1; // The first frame uses region 0
+    ring->offset = 0;
+
+    glGenBuffers(1, &ring->buffer);
+    glState_BindBuffer(GL_UNIFORM_BUFFER, ring->buffer);
+    glBufferData(GL_UNIFORM_BUFFER, ring->regionSize * UNIFORM_RING_REGION_COUNT, NULL, GL_DYNAMIC_DRAW);
+}
+
+// Deleting the buffer while the GPU still reads it is fine, the driver keeps the storage alive until it is done
+static void uniformRing_Free(UniformRing* ring)
+{
+    for (int i = 0; i < UNIFORM_RING_REGION_COUNT; ++i)
+    {
+        if (ring->fences[i])
+            glDeleteSync(ring->fences[i]);
+        ring->fences[i] = NULL;
+    }
+    glState_DeleteBuffers(1, &ring->buffer);
+    ring->buffer = 0;
+}
+
+void uniformRing_Create(UniformRing* ring, int regionSize)
+{
+    *ring = (UniformRing){ 0 };
+
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    ring->alignment = alignment > 16 ? alignment : 16; // std140 vec4 alignment at least
+
+    uniformRing_Allocate(ring, regionSize);
+}
+
+void uniformRing_Destroy(UniformRing* ring)
+{
+    assert(ring->mapped == NULL);
+    uniformRing_Free(ring);
+}
+
+int uniformRing_AlignedSize(const UniformRing* ring, int size)
+{
+    return align_Up(size, ring->alignment);
+}
+
+void uniformRing_BeginFrame(UniformRing* ring, int size)
+{
+    assert(ring->mapped == NULL);
+
+    // Everything submitted so far, the previous frame's draws included, is what its region waits for
+    GLsync* fence = &ring->fences[ring->regionIndex];
+    if (*fence)
+        glDeleteSync(*fence);
+    *fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    if (size > ring->regionSize)
+    {
+        int regionSize = ring->regionSize * 2 > size ? ring->regionSize * 2 : size;
+        ALOGV("uniformRing_BeginFrame() growing regions from %d to %d bytes", ring->regionSize, align_Up(regionSize, ring->alignment));
+        uniformRing_Free(ring);
+        uniformRing_Allocate(ring, regionSize);
+    }
+
+    ring->regionIndex = (ring->regionIndex + 1) % UNIFORM_RING_REGION_COUNT;
+    ring->offset = 0;
+
+    fence = &ring->fences[ring->regionIndex];
+    if (*fence)
+    {
+        GLenum result = glClientWaitSync(*fence, GL_SYNC_FLUSH_COMMANDS_BIT, UNIFORM_RING_WAIT_TIMEOUT_NS);
+        if (result == GL_TIMEOUT_EXPIRED || result == GL_WAIT_FAILED)
+            ALOGE("uniformRing_BeginFrame() region %d still in use after 1 s (0x%x)", ring->regionIndex, result);
+        glDeleteSync(*fence);
+        *fence = NULL;
+    }
+
+    // Unsynchronized: the fence already did the synchronization the driver would do
+    glState_BindBuffer(GL_UNIFORM_BUFFER, ring->buffer);
+    ring->mapped = glMapBufferRange(GL_UNIFORM_BUFFER, ring->regionIndex * ring->regionSize, ring->regionSize,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (ring->mapped == NULL)
+        ALOGE("uniformRing_BeginFrame() glMapBufferRange failed (0x%x)", glGetError());
+}
+
+void* uniformRing_Alloc(UniformRing* ring, int size, GLintptr* offset)
+{
+    int alignedSize = align_Up(size, ring->alignment);
+    if (ring->mapped == NULL || ring->offset + alignedSize > ring->regionSize)
+    {
+        ALOGE("uniformRing_Alloc() %d bytes do not fit, the frame asked for less in uniformRing_BeginFrame()", size);
+        return NULL;
+    }
+
+    *offset = ring->regionIndex * ring->regionSize + ring->offset;
+    void* data = ring->mapped + ring->offset;
+    ring->offset += alignedSize;
+    return data;
+}
+
+void uniformRing_EndFrame(UniformRing* ring)
+{
+    if (ring->mapped == NULL)
+        return;
+
+    glState_BindBuffer(GL_UNIFORM_BUFFER, ring->buffer);
+    glUnmapBuffer(GL_UNIFORM_BUFFER);
+    ring->mapped = NULL;
+}
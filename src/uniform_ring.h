@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "glad/gles2.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Uniform buffer ring: one GL_UNIFORM_BUFFER split in a region per frame in flight
+// Each frame maps its region once, writes the uniform blocks of all its draws, then draws bind them with
+// glBindBufferRange(). A fence per region makes sure the GPU is done with it before it is written again
+// GL thread only
+
+#define UNIFORM_RING_REGION_COUNT 3 // Frames the CPU can be ahead of the GPU before uniformRing_BeginFrame() waits
+
+typedef struct UniformRing
+{
+    GLuint buffer;
+    int alignment;  // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+    int regionSize; // In bytes, multiple of alignment
+    int regionIndex;
+    int offset;     // Next free byte in the current region
+    uint8_t* mapped; // Current region, between uniformRing_BeginFrame() and uniformRing_EndFrame()
+    GLsync fences[UNIFORM_RING_REGION_COUNT];
+} UniformRing;
+
+void uniformRing_Create(UniformRing* ring, int regionSize);
+void uniformRing_Destroy(UniformRing* ring);
+
+// Size a block takes in the ring, ranges bound with glBindBufferRange() must start on an alignment multiple
+int uniformRing_AlignedSize(const UniformRing* ring, int size);
+
+// Fences the previous frame's region, waits for the next one to be free and maps it, grows the ring when size does not fit
+void uniformRing_BeginFrame(UniformRing* ring, int size);
+// Returns where to write size bytes, *offset is the value for glBindBufferRange()
+void* uniformRing_Alloc(UniformRing* ring, int size, GLintptr* offset);
+// Unmaps the region: the buffer cannot be used by draws while it is mapped
+void uniformRing_EndFrame(UniformRing* ring);
+
+#ifdef __cplusplus
+}
+#endif
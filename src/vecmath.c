@@ -0,0 +1,184 @@
+
+#include <string.h> // memcpy
+
+#include "vecmath.h"
+
+/*
+============================================================================================================================
+Scalar references
+============================================================================================================================
+*/
+
+static inline float3 mat4_transformPoint(const float4x4* m, float3 p)
+{
+    return (float3){{
+        m->c[0].x * p.x + m->c[1].x * p.y + m->c[2].x * p.z + m->c[3].x,
+        m->c[0].y * p.x + m->c[1].y * p.y + m->c[2].y * p.z + m->c[3].y,
+        m->c[0].z * p.x + m->c[1].z * p.y + m->c[2].z * p.z + m->c[3].z,
+    }};
+}
+
+void vecmath_TransformPointsScalar(const float4x4* m, const float3* points, float3* out, int count)
+{
+    for (int i = 0; i < count; ++i)
+        out[i] = mat4_transformPoint(m, points[i]);
+}
+
+void vecmath_NormalizeVectorsScalar(const float3* vectors, float3* out, int count)
+{
+    for (int i = 0; i < count; ++i)
+        out[i] = v3_normalize(vectors[i]);
+}
+
+void vecmath_MulMatricesScalar(const float4x4* a, const float4x4* b, int count, float* out, size_t outStride)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        float4x4 result = mat4_mul(a, &b[i]);
+        memcpy((unsigned char*)out + i * outStride, result.e, sizeof(result.e));
+    }
+}
+
+/*
+============================================================================================================================
+SIMD kernels
+============================================================================================================================
+*/
+
+#if VECMATH_SCALAR
+
+void vecmath_TransformPoints(const float4x4* m, const float3* points, float3* out, int count)
+{
+    vecmath_TransformPointsScalar(m, points, out, count);
+}
+
+void vecmath_NormalizeVectors(const float3* vectors, float3* out, int count)
+{
+    vecmath_NormalizeVectorsScalar(vectors, out, count);
+}
+
+void vecmath_MulMatrices(const float4x4* a, const float4x4* b, int count, float* out, size_t outStride)
+{
+    vecmath_MulMatricesScalar(a, b, count, out, outStride);
+}
+
+#else
+
+// 4 float3 at a time as x, y and z vectors so every lane does useful work
+typedef struct f32x4x3
+{
+    f32x4 x, y, z;
+} f32x4x3;
+
+#if VECMATH_NEON
+
+static inline f32x4x3 f32x4x3_LoadInterleaved(const float3* p)
+{
+    float32x4x3_t v = vld3q_f32(p->e);
+    return (f32x4x3){ v.val[0], v.val[1], v.val[2] };
+}
+
+static inline void f32x4x3_StoreInterleaved(float3* p, f32x4x3 v)
+{
+    vst3q_f32(p->e, (float32x4x3_t){ { v.x, v.y, v.z } });
+}
+
+#elif VECMATH_SSE
+
+// a = x0 y0 z0 x1, b = y1 z1 x2 y2, c = z2 x3 y3 z3
+static inline f32x4x3 f32x4x3_LoadInterleaved(const float3* p)
+{
+    f32x4 a = _mm_loadu_ps(p->e);
+    f32x4 b = _mm_loadu_ps(p->e + 4);
+    f32x4 c = _mm_loadu_ps(p->e + 8);
+
+    f32x4 x02 = _mm_shuffle_ps(b, c, _MM_SHUFFLE(0, 1, 0, 2)); // x2 . x3 .
+    f32x4 y01 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 0, 1)); // y0 . y1 .
+    f32x4 y23 = _mm_shuffle_ps(b, c, _MM_SHUFFLE(0, 2, 0, 3)); // y2 . y3 .
+    f32x4 z01 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 1, 0, 2)); // z0 . z1 .
+    return (f32x4x3){
+        _mm_shuffle_ps(a, x02, _MM_SHUFFLE(2, 0, 3, 0)),
+        _mm_shuffle_ps(y01, y23, _MM_SHUFFLE(2, 0, 2, 0)),
+        _mm_shuffle_ps(z01, c, _MM_SHUFFLE(3, 0, 2, 0)),
+    };
+}
+
+static inline void f32x4x3_StoreInterleaved(float3* p, f32x4x3 v)
+{
+    f32x4 x0y0 = _mm_shuffle_ps(v.x, v.y, _MM_SHUFFLE(0, 0, 0, 0)); // x0 . y0 .
+    f32x4 z0x1 = _mm_shuffle_ps(v.z, v.x, _MM_SHUFFLE(0, 1, 0, 0)); // z0 . x1 .
+    f32x4 y1z1 = _mm_shuffle_ps(v.y, v.z, _MM_SHUFFLE(0, 1, 0, 1)); // y1 . z1 .
+    f32x4 x2y2 = _mm_shuffle_ps(v.x, v.y, _MM_SHUFFLE(0, 2, 0, 2)); // x2 . y2 .
+    f32x4 z2x3 = _mm_shuffle_ps(v.z, v.x, _MM_SHUFFLE(0, 3, 0, 2)); // z2 . x3 .
+    f32x4 y3z3 = _mm_shuffle_ps(v.y, v.z, _MM_SHUFFLE(0, 3, 0, 3)); // y3 . z3 .
+    _mm_storeu_ps(p->e, _mm_shuffle_ps(x0y0, z0x1, _MM_SHUFFLE(2, 0, 2, 0)));
+    _mm_storeu_ps(p->e + 4, _mm_shuffle_ps(y1z1, x2y2, _MM_SHUFFLE(2, 0, 2, 0)));
+    _mm_storeu_ps(p->e + 8, _mm_shuffle_ps(z2x3, y3z3, _MM_SHUFFLE(2, 0, 2, 0)));
+}
+
+#endif
+
+void vecmath_TransformPoints(const float4x4* m, const float3* points, float3* out, int count)
+{
+    f32x4 mx[4], my[4], mz[4];
+    for (int c = 0; c < 4; ++c)
+    {
+        mx[c] = f32x4_Splat(m->c[c].x);
+        my[c] = f32x4_Splat(m->c[c].y);
+        mz[c] = f32x4_Splat(m->c[c].z);
+    }
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        f32x4x3 p = f32x4x3_LoadInterleaved(&points[i]);
+        f32x4x3 r;
+        r.x = f32x4_Add(f32x4_Add(f32x4_Add(f32x4_Mul(mx[0], p.x), f32x4_Mul(mx[1], p.y)), f32x4_Mul(mx[2], p.z)), mx[3]);
+        r.y = f32x4_Add(f32x4_Add(f32x4_Add(f32x4_Mul(my[0], p.x), f32x4_Mul(my[1], p.y)), f32x4_Mul(my[2], p.z)), my[3]);
+        r.z = f32x4_Add(f32x4_Add(f32x4_Add(f32x4_Mul(mz[0], p.x), f32x4_Mul(mz[1], p.y)), f32x4_Mul(mz[2], p.z)), mz[3]);
+        f32x4x3_StoreInterleaved(&out[i], r);
+    }
+    vecmath_TransformPointsScalar(m, &points[i], &out[i], count - i);
+}
+
+void vecmath_NormalizeVectors(const float3* vectors, float3* out, int count)
+{
+    f32x4 one = f32x4_Splat(1.f);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        f32x4x3 v = f32x4x3_LoadInterleaved(&vectors[i]);
+        f32x4 lengthSq = f32x4_Add(f32x4_Add(f32x4_Mul(v.x, v.x), f32x4_Mul(v.y, v.y)), f32x4_Mul(v.z, v.z));
+        // Exact square root and division like v3_normalize(), the estimate instructions would not match it
+        f32x4 invLength = f32x4_Div(one, f32x4_Sqrt(lengthSq));
+        v.x = f32x4_Mul(v.x, invLength);
+        v.y = f32x4_Mul(v.y, invLength);
+        v.z = f32x4_Mul(v.z, invLength);
+        f32x4x3_StoreInterleaved(&out[i], v);
+    }
+    vecmath_NormalizeVectorsScalar(&vectors[i], &out[i], count - i);
+}
+
+void vecmath_MulMatrices(const float4x4* a, const float4x4* b, int count, float* out, size_t outStride)
+{
+    f32x4 ac[4];
+    for (int c = 0; c < 4; ++c)
+        ac[c] = f32x4_Load(a->c[c].e);
+
+    for (int i = 0; i < count; ++i)
+    {
+        float* result = (float*)((unsigned char*)out + i * outStride);
+        for (int c = 0; c < 4; ++c)
+        {
+            f32x4 bc = f32x4_Load(b[i].c[c].e);
+            f32x4 r = f32x4_Mul(ac[0], f32x4_SplatLane(bc, 0));
+            r = f32x4_Add(r, f32x4_Mul(ac[1], f32x4_SplatLane(bc, 1)));
+            r = f32x4_Add(r, f32x4_Mul(ac[2], f32x4_SplatLane(bc, 2)));
+            r = f32x4_Add(r, f32x4_Mul(ac[3], f32x4_SplatLane(bc, 3)));
+            f32x4_Store(result + 4 * c, r);
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "math3d.h"
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#define VECMATH_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define VECMATH_SSE 1
+#else
+#define VECMATH_SCALAR 1
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// SIMD math: NEON on arm64, SSE on x86, plain C elsewhere
+// math3d.h stays the scalar reference for single values, the batch kernels are where the volume is
+// The kernels do the same operations in the same order as the scalar references, results are bit-identical unless the
+// compiler fuses the scalar multiply-adds (-ffp-contract, arm64), then within a few ulps, see tools/math_bench
+
+/*
+============================================================================================================================
+Four floats
+============================================================================================================================
+*/
+
+#if VECMATH_NEON
+typedef float32x4_t f32x4;
+static inline f32x4 f32x4_Load(const float* p)          { return vld1q_f32(p); }
+static inline void  f32x4_Store(float* p, f32x4 a)      { vst1q_f32(p, a); }
+static inline f32x4 f32x4_Splat(float a)                { return vdupq_n_f32(a); }
+static inline f32x4 f32x4_Add(f32x4 a, f32x4 b)         { return vaddq_f32(a, b); }
+static inline f32x4 f32x4_Sub(f32x4 a, f32x4 b)         { return vsubq_f32(a, b); }
+static inline f32x4 f32x4_Mul(f32x4 a, f32x4 b)         { return vmulq_f32(a, b); }
+static inline f32x4 f32x4_Div(f32x4 a, f32x4 b)         { return vdivq_f32(a, b); }
+static inline f32x4 f32x4_Sqrt(f32x4 a)                 { return vsqrtq_f32(a); }
+#define f32x4_SplatLane(a, lane)                          vdupq_laneq_f32(a, lane)
+#elif VECMATH_SSE
+typedef __m128 f32x4;
+static inline f32x4 f32x4_Load(const float* p)          { return _mm_loadu_ps(p); }
+static inline void  f32x4_Store(float* p, f32x4 a)      { _mm_storeu_ps(p, a); }
+static inline f32x4 f32x4_Splat(float a)                { return _mm_set1_ps(a); }
+static inline f32x4 f32x4_Add(f32x4 a, f32x4 b)         { return _mm_add_ps(a, b); }
+static inline f32x4 f32x4_Sub(f32x4 a, f32x4 b)         { return _mm_sub_ps(a, b); }
+static inline f32x4 f32x4_Mul(f32x4 a, f32x4 b)         { return _mm_mul_ps(a, b); }
+static inline f32x4 f32x4_Div(f32x4 a, f32x4 b)         { return _mm_div_ps(a, b); }
+static inline f32x4 f32x4_Sqrt(f32x4 a)                 { return _mm_sqrt_ps(a); }
+#define f32x4_SplatLane(a, lane)                          _mm_shuffle_ps(a, a, _MM_SHUFFLE(lane, lane, lane, lane))
+#endif
+
+/*
+============================================================================================================================
+Batch kernels
+============================================================================================================================
+*/
+
+// out[i] = m * (points[i], 1), xyz only: m is affine. out can be points
+void vecmath_TransformPoints(const float4x4* m, const float3* points, float3* out, int count);
+// out[i] = v3_normalize(vectors[i]), out can be vectors
+void vecmath_NormalizeVectors(const float3* vectors, float3* out, int count);
+// out[i] = mat4_mul(a, &b[i]), out is strided to write straight into interleaved per-instance data
+void vecmath_MulMatrices(const float4x4* a, const float4x4* b, int count, float* out, size_t outStride);
+
+// Scalar references, what the kernels fall back to without SIMD and for the last count % 4 elements
+void vecmath_TransformPointsScalar(const float4x4* m, const float3* points, float3* out, int count);
+void vecmath_NormalizeVectorsScalar(const float3* vectors, float3* out, int count);
+void vecmath_MulMatricesScalar(const float4x4* a, const float4x4* b, int count, float* out, size_t outStride);
+
+#ifdef __cplusplus
+}
+#endif
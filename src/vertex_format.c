@@ -0,0 +1,239 @@
+
+#include <string.h> // memcpy/memcmp
+#include <math.h>   // lrintf
+#include <assert.h> // assert
+
+#include "common.h"
+
+#include "glad/gles2.h"
+
+#include "vertex_format.h"
+
+typedef struct AttribFormatInfo
+{
+    int size; // In bytes
+    GLint componentCount;
+    GLenum type;
+    GLboolean normalized;
+} AttribFormatInfo;
+
+static const AttribFormatInfo g_attribFormatInfos[VertexAttribFormat_Count] =
+{
+    [VertexAttribFormat_None]      = { 0,  0, 0,                     GL_FALSE },
+    [VertexAttribFormat_Float2]    = { 8,  2, GL_FLOAT,              GL_FALSE },
+    [VertexAttribFormat_Float3]    = { 12, 3, GL_FLOAT,              GL_FALSE },
+    [VertexAttribFormat_Half2]     = { 4,  2, GL_HALF_FLOAT,         GL_FALSE },
+    [VertexAttribFormat_Snorm10x3] = { 4,  4, GL_INT_2_10_10_10_REV, GL_TRUE },
+    [VertexAttribFormat_Unorm8x4]  = { 4,  4, GL_UNSIGNED_BYTE,      GL_TRUE },
+};
+
+// Vertex member read by each attribute
+static const struct
+{
+    size_t offset;
+    int componentCount;
+} g_vertexMembers[VertexAttrib_Count] =
+{
+    [VertexAttrib_Position] = { OFFSETOF(Vertex, position), 3 },
+    [VertexAttrib_Normal]   = { OFFSETOF(Vertex, normal),   3 },
+    [VertexAttrib_Color]    = { OFFSETOF(Vertex, color),    3 },
+    [VertexAttrib_UV]       = { OFFSETOF(Vertex, uv),       2 },
+};
+
+const VertexFormatDesc g_vertexFormatFloat =
+{
+    .formats = {
+        [VertexAttrib_Position] = VertexAttribFormat_Float3,
+        [VertexAttrib_Normal]   = VertexAttribFormat_Float3,
+        [VertexAttrib_Color]    = VertexAttribFormat_Float3,
+        [VertexAttrib_UV]       = VertexAttribFormat_Float2,
+    },
+};
+
+const VertexFormatDesc g_vertexFormatCompact =
+{
+    .formats = {
+        [VertexAttrib_Position] = VertexAttribFormat_Float3,
+        [VertexAttrib_Normal]   = VertexAttribFormat_Snorm10x3,
+        [VertexAttrib_Color]    = VertexAttribFormat_Unorm8x4,
+        [VertexAttrib_UV]       = VertexAttribFormat_Half2,
+    },
+};
+
+static const float* vertex_GetAttrib(const Vertex* vertex, VertexAttrib attrib)
+{
+    return (const float*)((const unsigned char*)vertex + g_vertexMembers[attrib].offset);
+}
+
+// Round to nearest even, overflows to infinity, keeps subnormals
+static uint16_t half_FromFloat(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t floatExponent = (bits >> 23) & 0xFF;
+    uint32_t mantissa = bits & 0x7FFFFF;
+
+    if (floatExponent == 0xFF) // Infinity or NaN
+        return sign | 0x7C00 | (mantissa ? 0x200 : 0);
+
+    int exponent = (int)floatExponent - 127 + 15;
+    if (exponent >= 31)
+        return sign | 0x7C00;
+
+    uint32_t half;
+    uint32_t shift;
+    if (exponent > 0)
+    {
+        half = ((uint32_t)exponent << 10) | (mantissa >> 13);
+        shift = 13;
+    }
+    else
+    {
+        if (exponent < -10)
+            return sign;
+        mantissa |= 0x800000;
+        shift = 14 - exponent;
+        half = mantissa >> shift;
+    }
+
+    // A carry out of the mantissa correctly bumps the exponent
+    uint32_t remainder = mantissa & ((1u << shift) - 1);
+    uint32_t halfway = 1u << (shift - 1);
+    if (remainder > halfway || (remainder == halfway && (half & 1)))
+        half++;
+    return sign | half;
+}
+
+static uint32_t snorm10_FromFloat(float value)
+{
+    value = value < -1.f ? -1.f : value > 1.f ? 1.f : value;
+    return (uint32_t)lrintf(value * 511.f) & 0x3FF;
+}
+
+static uint8_t unorm8_FromFloat(float value)
+{
+    value = value < 0.f ? 0.f : value > 1.f ? 1.f : value;
+    return (uint8_t)lrintf(value * 255.f);
+}
+
+void vertexFormat_Init(VertexFormat* format, const VertexFormatDesc* desc)
+{
+    *format = (VertexFormat){ 0 };
+    memcpy(format->constants, desc->constants, sizeof(format->constants));
+
+    int offset = 0;
+    for (int attrib = 0; attrib < VertexAttrib_Count; ++attrib)
+    {
+        VertexAttribFormat attribFormat = desc->formats[attrib];
+        assert(attribFormat < VertexAttribFormat_Count);
+        format->formats[attrib] = attribFormat;
+        format->offsets[attrib] = (uint8_t)offset;
+        offset += g_attribFormatInfos[attribFormat].size;
+    }
+    format->stride = offset;
+}
+
+void vertexFormat_RemoveConstants(VertexFormatDesc* desc, const Vertex* vertices, int vertexCount)
+{
+    if (vertexCount == 0)
+        return;
+
+    for (int attrib = 0; attrib < VertexAttrib_Count; ++attrib)
+    {
+        if (desc->formats[attrib] == VertexAttribFormat_None)
+            continue;
+
+        const float* first = vertex_GetAttrib(&vertices[0], attrib);
+        size_t size = g_vertexMembers[attrib].componentCount * sizeof(float);
+        bool constant = true;
+        for (int i = 1; i < vertexCount && constant; ++i)
+            constant = memcmp(vertex_GetAttrib(&vertices[i], attrib), first, size) == 0;
+
+        if (constant)
+        {
+            desc->formats[attrib] = VertexAttribFormat_None;
+            float* value = desc->constants[attrib];
+            value[0] = value[1] = value[2] = 0.f;
+            value[3] = 1.f;
+            memcpy(value, first, size);
+        }
+    }
+}
+
+void vertexFormat_Pack(const VertexFormat* format, const Vertex* vertices, int vertexCount, void* dst)
+{
+    for (int attrib = 0; attrib < VertexAttrib_Count; ++attrib)
+    {
+        VertexAttribFormat attribFormat = format->formats[attrib];
+        if (attribFormat == VertexAttribFormat_None)
+            continue;
+
+        unsigned char* out = (unsigned char*)dst + format->offsets[attrib];
+        for (int i = 0; i < vertexCount; ++i, out += format->stride)
+        {
+            const float* value = vertex_GetAttrib(&vertices[i], attrib);
+            switch (attribFormat)
+            {
+                case VertexAttribFormat_Float2:
+                    memcpy(out, value, 2 * sizeof(float));
+                    break;
+
+                case VertexAttribFormat_Float3:
+                    memcpy(out, value, 3 * sizeof(float));
+                    break;
+
+                case VertexAttribFormat_Half2:
+                {
+                    uint16_t half[2] = { half_FromFloat(value[0]), half_FromFloat(value[1]) };
+                    memcpy(out, half, sizeof(half));
+                    break;
+                }
+
+                case VertexAttribFormat_Snorm10x3:
+                {
+                    uint32_t packed = snorm10_FromFloat(value[0]) | (snorm10_FromFloat(value[1]) << 10) | (snorm10_FromFloat(value[2]) << 20);
+                    memcpy(out, &packed, sizeof(packed));
+                    break;
+                }
+
+                case VertexAttribFormat_Unorm8x4:
+                {
+                    int componentCount = g_vertexMembers[attrib].componentCount;
+                    uint8_t packed[4] = { 0, 0, 0, 255 };
+                    for (int c = 0; c < componentCount && c < 4; ++c)
+                        packed[c] = unorm8_FromFloat(value[c]);
+                    memcpy(out, packed, sizeof(packed));
+                    break;
+                }
+
+                default:
+                    assert(0);
+                    break;
+            }
+        }
+    }
+}
+
+void vertexFormat_SetupAttribs(const VertexFormat* format)
+{
+    for (int attrib = 0; attrib < VertexAttrib_Count; ++attrib)
+    {
+        const AttribFormatInfo* info = &g_attribFormatInfos[format->formats[attrib]];
+        if (format->formats[attrib] == VertexAttribFormat_None)
+        {
+            glDisableVertexAttribArray(attrib);
+            continue;
+        }
+
+        glEnableVertexAttribArray(attrib);
+        glVertexAttribPointer(attrib, info->componentCount, info->type, info->normalized, format->stride, (void*)(size_t)format->offsets[attrib]);
+    }
+}
+
+void vertexFormat_SetConstants(const VertexFormat* format)
+{
+    for (int attrib = 0; attrib < VertexAttrib_Count; ++attrib)
+        if (format->formats[attrib] == VertexAttribFormat_None)
+            glVertexAttrib4fv(attrib, format->constants[attrib]);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "geometry.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Packed GPU vertex layouts described per attribute, meshes are generated as float Vertex then packed once
+
+// Attribute locations in the shaders, one per Vertex member
+typedef enum VertexAttrib
+{
+    VertexAttrib_Position,
+    VertexAttrib_Normal,
+    VertexAttrib_Color,
+    VertexAttrib_UV,
+    VertexAttrib_Count,
+} VertexAttrib;
+
+typedef enum VertexAttribFormat
+{
+    VertexAttribFormat_None,      // Not stored, the shader reads the constant value
+    VertexAttribFormat_Float2,
+    VertexAttribFormat_Float3,
+    VertexAttribFormat_Half2,     // GL_HALF_FLOAT, 11 bits of mantissa
+    VertexAttribFormat_Snorm10x3, // GL_INT_2_10_10_10_REV normalized, for unit vectors, w = 0
+    VertexAttribFormat_Unorm8x4,  // GL_UNSIGNED_BYTE normalized, for colors, w = 1
+    VertexAttribFormat_Count,
+} VertexAttribFormat;
+
+typedef struct VertexFormatDesc
+{
+    VertexAttribFormat formats[VertexAttrib_Count];
+    float constants[VertexAttrib_Count][4]; // Value of VertexAttribFormat_None attributes
+} VertexFormatDesc;
+
+typedef struct VertexFormat
+{
+    VertexAttribFormat formats[VertexAttrib_Count];
+    uint8_t offsets[VertexAttrib_Count];
+    float constants[VertexAttrib_Count][4];
+    int stride; // In bytes, attributes are 4-byte aligned
+} VertexFormat;
+
+extern const VertexFormatDesc g_vertexFormatFloat;   // Vertex as is, 44 bytes
+extern const VertexFormatDesc g_vertexFormatCompact; // Float3 position, Snorm10x3 normal, Unorm8x4 color, Half2 UV
+
+void vertexFormat_Init(VertexFormat* format, const VertexFormatDesc* desc);
+
+// Turns the attributes every vertex has the same value for into constants, in place
+void vertexFormat_RemoveConstants(VertexFormatDesc* desc, const Vertex* vertices, int vertexCount);
+
+// Writes vertexCount * format->stride bytes to dst
+void vertexFormat_Pack(const VertexFormat* format, const Vertex* vertices, int vertexCount, void* dst);
+
+// GL thread, setup of the bound VAO from the bound GL_ARRAY_BUFFER
+void vertexFormat_SetupAttribs(const VertexFormat* format);
+
+// GL thread, constant attribute values are context state and not VAO state, call before drawing
+void vertexFormat_SetConstants(const VertexFormat* format);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,228 @@
+// JNI cost per touch event of the input ring (see src/input_ring.h) against the mirror object it replaced, on a desktop JVM
+// Usage:
+//   make tools/jni_bench JAVA_HOME=/usr/lib/jvm/default-java
+//   java -Djava.library.path=tools -cp tools JniBench [--events n] > jni.csv
+// Sends the same MOVE events through both paths of tools/jni_bench.c: "mirror" fills a NativeWrapper.MotionEvent like
+// object and calls dispatchTouchEvent() per event, native code reads it back with motionEvent_FromJava() as the app did
+// before, "ring" writes records into a direct ByteBuffer and rings inputDoorbell() once per event or once per batch of
+// historical samples, native code reads them with inputRing_Read(). Java and native sides are both timed.
+// Prints one line per path, pointer count and events per JNI call with the best run, fails when a path does not deliver
+// the events the mirror path did
+
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+
+public class JniBench
+{
+    private static final int BENCH_MIN_RUNS = 5;
+    private static final long BENCH_MIN_TIME_NS = 500L * 1000000L; // Per case, after the warm-up
+    private static final int BENCH_WARMUP_RUNS = 20;               // Until the JIT compiled both paths
+
+    // Mirror of the removed NativeWrapper.MotionEvent
+    static class MotionEvent
+    {
+        int action;
+        int pointerCount;
+        int x[] = new int[10];
+        int y[] = new int[10];
+    }
+
+    static native long create(ByteBuffer inputRing);
+    static native void destroy(long handle);
+    static native long takeChecksum(long handle); // Of the events read since the last call, then resets it
+    static native int takeEventCount(long handle);
+
+    // Old path, see motionEvent_FromJava() in tools/jni_bench.c
+    static native boolean dispatchTouchEvent(long handle, MotionEvent motionEvent);
+    // New path, see nativeWrapper_InputDoorbell() in src/activity.c
+    static native void inputDoorbell(long handle, int writeOffset);
+
+    // Input ring writer of NativeActivity.java, reading the synthetic events instead of an android.view.MotionEvent
+    private static final int INPUT_RING_SIZE = 64 * 1024;
+    private static final int INPUT_RECORD_WRAP = 0;
+    private static final int INPUT_RECORD_MOTION = 2;
+    private static final int INPUT_MAX_POINTERS = 10;
+    private static final int INPUT_MAX_RECORD_SIZE = Math.max(4 * (5 + 4 * INPUT_MAX_POINTERS), 8 + 256);
+
+    private long mNativeHandle;
+    private ByteBuffer mInputRing = ByteBuffer.allocateDirect(INPUT_RING_SIZE).order(ByteOrder.nativeOrder());
+    private int mInputWriteOffset;
+    private int mInputBatchSize;
+    private MotionEvent mMotionEvent = new MotionEvent();
+
+    // Synthetic one and two finger drags, whole pixels so both paths carry the same coordinates
+    private int mEventCount;
+    private float mX[];
+    private float mY[];
+
+    private int inputRing_Reserve(int size)
+    {
+        if (mInputBatchSize + 2 * INPUT_MAX_RECORD_SIZE > INPUT_RING_SIZE)
+            inputRing_Doorbell();
+
+        int remaining = INPUT_RING_SIZE - mInputWriteOffset;
+        if (remaining < size)
+        {
+            if (remaining >= 4)
+                mInputRing.putInt(mInputWriteOffset, INPUT_RECORD_WRAP);
+            mInputBatchSize += remaining;
+            mInputWriteOffset = 0;
+        }
+
+        int offset = mInputWriteOffset;
+        mInputWriteOffset += size;
+        mInputBatchSize += size;
+        return offset;
+    }
+
+    private void inputRing_Doorbell()
+    {
+        inputDoorbell(mNativeHandle, mInputWriteOffset);
+        mInputBatchSize = 0;
+    }
+
+    private void inputRing_WriteMotion(int action, int pointerCount, int event)
+    {
+        int size = 4 * (5 + 4 * pointerCount);
+        int offset = inputRing_Reserve(size);
+        mInputRing.putInt(offset, INPUT_RECORD_MOTION | (size << 16));
+        mInputRing.putInt(offset + 4, action);
+        mInputRing.putInt(offset + 8, pointerCount);
+        mInputRing.putLong(offset + 12, event * 4166666L);
+        for (int i = 0; i < pointerCount; ++i)
+        {
+            mInputRing.putInt(offset + 20 + 4 * i, i);
+            mInputRing.putFloat(offset + 20 + 4 * (pointerCount + i), mX[event * INPUT_MAX_POINTERS + i]);
+            mInputRing.putFloat(offset + 20 + 4 * (2 * pointerCount + i), mY[event * INPUT_MAX_POINTERS + i]);
+            mInputRing.putFloat(offset + 20 + 4 * (3 * pointerCount + i), 0.5f);
+        }
+    }
+
+    private JniBench(int eventCount)
+    {
+        mNativeHandle = create(mInputRing);
+        mEventCount = eventCount;
+        mX = new float[eventCount * INPUT_MAX_POINTERS];
+        mY = new float[eventCount * INPUT_MAX_POINTERS];
+        for (int e = 0; e < eventCount; ++e)
+        {
+            for (int i = 0; i < INPUT_MAX_POINTERS; ++i)
+            {
+                mX[e * INPUT_MAX_POINTERS + i] = 100 + (e * 3) % 800 + i * 100;
+                mY[e * INPUT_MAX_POINTERS + i] = 300 + (e * 7) % 1600 - i * 100;
+            }
+        }
+    }
+
+    // Old NativeActivity.dispatchTouchEvent(), one JNI call per event
+    private void runMirror(int pointerCount)
+    {
+        for (int e = 0; e < mEventCount; ++e)
+        {
+            mMotionEvent.action = 2; // ACTION_MOVE
+            mMotionEvent.pointerCount = pointerCount;
+            for (int i = 0; i < pointerCount; ++i)
+            {
+                mMotionEvent.x[i] = (int)mX[e * INPUT_MAX_POINTERS + i];
+                mMotionEvent.y[i] = (int)mY[e * INPUT_MAX_POINTERS + i];
+            }
+            dispatchTouchEvent(mNativeHandle, mMotionEvent);
+        }
+    }
+
+    // NativeActivity.dispatchTouchEvent(), the historical samples and the event then one doorbell
+    private void runRing(int pointerCount, int eventsPerCall)
+    {
+        for (int e = 0; e < mEventCount; ++e)
+        {
+            inputRing_WriteMotion(2, pointerCount, e);
+            if ((e + 1) % eventsPerCall == 0 || e + 1 == mEventCount)
+                inputRing_Doorbell();
+        }
+    }
+
+    private void run(boolean ring, int pointerCount, int eventsPerCall)
+    {
+        if (ring)
+            runRing(pointerCount, eventsPerCall);
+        else
+            runMirror(pointerCount);
+    }
+
+    public static void main(String[] args)
+    {
+        int eventCount = 100000;
+        for (int i = 0; i < args.length; ++i)
+        {
+            if (args[i].equals("--events") && i + 1 < args.length)
+                eventCount = Integer.parseInt(args[++i]);
+            else
+            {
+                System.err.println("usage: java -Djava.library.path=tools -cp tools JniBench [--events n]");
+                System.exit(1);
+            }
+        }
+
+        System.loadLibrary("jni_bench");
+        JniBench bench = new JniBench(Math.max(eventCount, 1));
+
+        // path, pointer count, events per JNI call: the app rings once per MotionEvent, with 3 historical samples when
+        // the touch screen samples at 4 times the frame rate
+        final boolean[] caseRing = { false, true, true, false, true, true };
+        final int[] casePointers = { 1, 1, 1, 2, 2, 2 };
+        final int[] caseEventsPerCall = { 1, 1, 4, 1, 1, 4 };
+        double[] caseNs = new double[caseRing.length];
+        boolean passed = true;
+
+        System.out.println("path,pointers,events_per_call,ns_per_event");
+        long mirrorChecksum = 0;
+        for (int c = 0; c < caseRing.length; ++c)
+        {
+            for (int run = 0; run < BENCH_WARMUP_RUNS; ++run)
+                bench.run(caseRing[c], casePointers[c], caseEventsPerCall[c]);
+            takeChecksum(bench.mNativeHandle);
+            takeEventCount(bench.mNativeHandle);
+
+            long bestTime = Long.MAX_VALUE;
+            long benchStart = System.nanoTime();
+            for (int run = 0; run < BENCH_MIN_RUNS || System.nanoTime() - benchStart < BENCH_MIN_TIME_NS; ++run)
+            {
+                long start = System.nanoTime();
+                bench.run(caseRing[c], casePointers[c], caseEventsPerCall[c]);
+                long elapsed = System.nanoTime() - start;
+                if (elapsed < bestTime)
+                    bestTime = elapsed;
+
+                // Every run must deliver every event, with what the mirror path delivered
+                long checksum = takeChecksum(bench.mNativeHandle);
+                int delivered = takeEventCount(bench.mNativeHandle);
+                if (!caseRing[c])
+                    mirrorChecksum = checksum;
+                if (delivered != bench.mEventCount || checksum != mirrorChecksum)
+                {
+                    System.err.println((caseRing[c] ? "ring" : "mirror") + " with " + casePointers[c] + " pointers delivered "
+                        + delivered + " of " + bench.mEventCount + " events" + (checksum != mirrorChecksum ? ", not the mirror ones" : ""));
+                    passed = false;
+                    break;
+                }
+            }
+
+            caseNs[c] = (double)bestTime / bench.mEventCount;
+            System.out.printf("%s,%d,%d,%.1f%n", caseRing[c] ? "ring" : "mirror", casePointers[c], caseEventsPerCall[c], caseNs[c]);
+            System.out.flush();
+        }
+
+        for (int c = 0; c < caseRing.length; ++c)
+        {
+            if (caseRing[c])
+            {
+                int mirror = c - (caseEventsPerCall[c] == 1 ? 1 : 2);
+                System.err.printf("%d pointers, %d events per call: ring %.1f ns per event, mirror %.1f (%.2fx)%n",
+                    casePointers[c], caseEventsPerCall[c], caseNs[c], caseNs[mirror], caseNs[mirror] / caseNs[c]);
+            }
+        }
+
+        destroy(bench.mNativeHandle);
+        System.exit(passed ? 0 : 1);
+    }
+}
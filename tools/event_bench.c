@@ -0,0 +1,233 @@
+// Bytes moved per event through the event queue, with the variable-length encoding (see src/app_event.h) against
+// fixed-size Event slots, on Linux
+// Usage:
+//   tools/event_bench [--gestures n] > events.csv
+// Queues a synthetic session: lifecycle events, one finger drags, two finger pinches, keys and text commits. Prints one
+// line per event type with the bytes a fixed slot copies (sizeof(Event)), the encoded size and what the ring stores
+// (record header and alignment included), then the whole session pushed one record per event and with MOVE events
+// merged like the app does. Fails when an event does not decode to what was encoded
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "common.h"
+#include "app_event.h"
+#include "event_queue.h"
+
+typedef struct TypeBytes
+{
+    uint32_t count;
+    uint64_t encodedBytes;
+    uint64_t ringBytes;
+} TypeBytes;
+
+typedef struct Session
+{
+    Event* events;
+    int count;
+    int capacity;
+} Session;
+
+static Event* session_Add(Session* session, EventType type)
+{
+    if (session->count == session->capacity)
+    {
+        session->capacity = session->capacity ? session->capacity * 2 : 1024;
+        session->events = realloc(session->events, session->capacity * sizeof(Event));
+    }
+    Event* event = &session->events[session->count++];
+    memset(event, 0, sizeof(*event));
+    event->type = type;
+    return event;
+}
+
+static void session_AddMotion(Session* session, int action, int pointerCount, int64_t time, float x, float y, float spread)
+{
+    Event* event = session_Add(session, EventType_DispatchMotionEvent);
+    MotionEvent* motionEvent = &event->dispatchTouchEvent.motionEvent;
+    event->dispatchTouchEvent.type = AINPUT_EVENT_TYPE_MOTION;
+    motionEvent->action = action;
+    motionEvent->pointerCount = pointerCount;
+    for (int i = 0; i < pointerCount; ++i)
+    {
+        motionEvent->pointerId[i] = i;
+        motionEvent->x[i] = x + i * spread;
+        motionEvent->y[i] = y - i * spread;
+        motionEvent->pressure[i] = 0.5f;
+    }
+    motionEvent->eventTime = time;
+    motionEvent->receivedTime = time + 2000000;
+}
+
+static void session_AddKey(Session* session, int action, int keyCode)
+{
+    Event* event = session_Add(session, EventType_DispatchKeyEvent);
+    event->dispatchKeyEvent.type = AINPUT_EVENT_TYPE_KEY;
+    event->dispatchKeyEvent.keyEvent = (KeyEvent){ action, keyCode, keyCode + 8, 'a' + keyCode % 26, 0 };
+}
+
+static void session_AddText(Session* session, const char* text)
+{
+    Event* event = session_Add(session, EventType_CommitText);
+    event->commitText.type = INPUT_EVENT_TYPE_TEXT;
+    event->commitText.textEvent.size = (int)strlen(text);
+    strcpy(event->commitText.textEvent.utf8, text);
+}
+
+// Touch events come at 120 Hz, the mix is what a UI heavy session looks like: mostly one finger moves
+static void session_Build(Session* session, int gestureCount)
+{
+    static const Config config = { "/data/user/0/com.example.app/files", 48000, 192 };
+    session_Add(session, EventType_Create)->create.config = &config;
+    session_Add(session, EventType_Start);
+    session_Add(session, EventType_Resume);
+    session_Add(session, EventType_SurfaceCreated)->surfaceCreated.nativeWindow = (struct ANativeWindow*)session;
+    Event* changed = session_Add(session, EventType_SurfaceChanged);
+    changed->surfaceChanged.format = 1;
+    changed->surfaceChanged.width = 1080;
+    changed->surfaceChanged.height = 2400;
+    session_Add(session, EventType_WindowFocusChanged)->windowFocusChanged.hasFocus = true;
+
+    int64_t time = 0;
+    for (int gesture = 0; gesture < gestureCount; ++gesture)
+    {
+        float x = 100.f + gesture % 7 * 120.f, y = 300.f + gesture % 11 * 150.f;
+        time += 500000000;
+        if (gesture % 5 == 4)
+        {
+            // Pinch
+            session_AddMotion(session, AMOTION_EVENT_ACTION_DOWN, 1, time, x, y, 0.f);
+            session_AddMotion(session, AMOTION_EVENT_ACTION_POINTER_DOWN | (1 << AMOTION_EVENT_ACTION_POINTER_INDEX_SHIFT), 2, time += 8333333, x, y, 100.f);
+            for (int i = 0; i < 40; ++i)
+                session_AddMotion(session, AMOTION_EVENT_ACTION_MOVE, 2, time += 8333333, x, y, 100.f + i * 5.f);
+            session_AddMotion(session, AMOTION_EVENT_ACTION_POINTER_UP | (1 << AMOTION_EVENT_ACTION_POINTER_INDEX_SHIFT), 2, time += 8333333, x, y, 300.f);
+            session_AddMotion(session, AMOTION_EVENT_ACTION_UP, 1, time += 8333333, x, y, 0.f);
+        }
+        else
+        {
+            // Drag
+            session_AddMotion(session, AMOTION_EVENT_ACTION_DOWN, 1, time, x, y, 0.f);
+            for (int i = 0; i < 30; ++i)
+                session_AddMotion(session, AMOTION_EVENT_ACTION_MOVE, 1, time += 8333333, x + i * 3.5f, y + i * 1.25f, 0.f);
+            session_AddMotion(session, AMOTION_EVENT_ACTION_UP, 1, time += 8333333, x + 105.f, y + 37.5f, 0.f);
+        }
+
+        if (gesture % 10 == 9)
+        {
+            session_AddKey(session, 0, 29 + gesture % 26);
+            session_AddKey(session, 1, 29 + gesture % 26);
+            session_AddText(session, gesture % 20 == 19 ? "Pasted text, a little longer than a word" : "word");
+        }
+    }
+
+    session_Add(session, EventType_WindowFocusChanged)->windowFocusChanged.hasFocus = false;
+    session_Add(session, EventType_Pause);
+    session_Add(session, EventType_SurfaceDestroyed);
+    session_Add(session, EventType_Stop);
+    session_Add(session, EventType_Destroy);
+}
+
+// Pushes the session through a queue. Without merging every record is popped and checked right after its push, with
+// merging they are popped once the whole session is queued. Returns the number of records popped, -1 if an event did not
+// survive the round trip
+static int bench_Push(const Session* session, bool mergeMoves, TypeBytes* types, EventQueueStats* stats)
+{
+    EventQueueDesc desc = {
+        .capacity = 64 * 1024,
+        .maxElementSize = EVENT_MAX_ENCODED_SIZE,
+        .overflow = EventQueueOverflow_Grow,
+    };
+    EventQueue* queue = eventQueue_Create(&desc);
+
+    int recordCount = 0;
+    bool valid = true;
+    for (int i = 0; i < session->count; ++i)
+    {
+        const Event* event = &session->events[i];
+        unsigned char record[EVENT_MAX_ENCODED_SIZE];
+        uint32_t size = event_Encode(event, record);
+
+        uint64_t writtenBytes = eventQueue_GetStats(queue).writtenBytes;
+        if (mergeMoves && event->type == EventType_DispatchMotionEvent)
+            eventQueue_PushMerge(queue, record, size, event_MergeMotion, NULL);
+        else
+            eventQueue_Push(queue, record, size);
+
+        if (types)
+        {
+            types[event->type].count++;
+            types[event->type].encodedBytes += size;
+            types[event->type].ringBytes += eventQueue_GetStats(queue).writtenBytes - writtenBytes;
+
+            // Without merging, every record must decode to the event and encode to the same bytes
+            uint32_t poppedSize;
+            const void* popped = eventQueue_Peek(queue, &poppedSize);
+            Event decoded;
+            unsigned char encoded[EVENT_MAX_ENCODED_SIZE];
+            event_Decode(&decoded, popped);
+            if (poppedSize != size || memcmp(popped, record, size) != 0 || event_Encode(&decoded, encoded) != size
+                || memcmp(encoded, record, size) != 0)
+            {
+                fprintf(stderr, "event %d (%s) does not round trip\n", i, eventTypeStr[event->type]);
+                valid = false;
+            }
+            eventQueue_Release(queue);
+            recordCount++;
+        }
+    }
+
+    // Merged records are popped once the whole session is queued, like after a long frame
+    uint32_t size;
+    while (eventQueue_Peek(queue, &size))
+    {
+        eventQueue_Release(queue);
+        recordCount++;
+    }
+
+    *stats = eventQueue_GetStats(queue);
+    eventQueue_Destroy(queue);
+    return valid ? recordCount : -1;
+}
+
+int main(int argc, char** argv)
+{
+    int gestureCount = 1000;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--gestures") == 0 && i + 1 < argc)
+            gestureCount = atoi(argv[++i]);
+        else
+        {
+            fprintf(stderr, "usage: %s [--gestures n]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    Session session = { 0 };
+    session_Build(&session, gestureCount);
+
+    TypeBytes types[EventType_Count] = { { 0 } };
+    EventQueueStats unmerged, merged;
+    int unmergedRecords = bench_Push(&session, false, types, &unmerged);
+    int mergedRecords = bench_Push(&session, true, NULL, &merged);
+
+    printf("type,events,records,fixed_bytes,encoded_bytes,ring_bytes\n");
+    for (int type = 0; type < EventType_Count; ++type)
+    {
+        const TypeBytes* bytes = &types[type];
+        if (bytes->count)
+            printf("%s,%u,%u,%zu,%.1f,%.1f\n", eventTypeStr[type], bytes->count, bytes->count, sizeof(Event),
+                bytes->encodedBytes / (double)bytes->count, bytes->ringBytes / (double)bytes->count);
+    }
+    printf("session,%d,%d,%zu,,%.1f\n", session.count, unmergedRecords, sizeof(Event), unmerged.writtenBytes / (double)session.count);
+    printf("session_moves_merged,%d,%d,%zu,,%.1f\n", session.count, mergedRecords, sizeof(Event), merged.writtenBytes / (double)session.count);
+    fflush(stdout);
+
+    fprintf(stderr, "%d events: %zu bytes per event in fixed slots, %.1f encoded (%.1fx less), %.1f with MOVE events merged "
+        "into %d records\n", session.count, sizeof(Event), unmerged.writtenBytes / (double)session.count,
+        sizeof(Event) / (unmerged.writtenBytes / (double)session.count), merged.writtenBytes / (double)session.count, mergedRecords);
+
+    free(session.events);
+    return unmergedRecords == session.count ? 0 : 1;
+}
@@ -0,0 +1,188 @@
+// Stress test of the event queue (see src/event_queue.h) with each overflow policy, on Linux
+// Usage:
+//   tools/event_queue_bench [--records n] [--capacity bytes] > event_queue.csv
+// A producer thread pushes records of 16 to 80 bytes as fast as it can into a small ring while the consumer checks
+// every one of them: order, payload and, with the coalesce policy, that the merged records still account for every push.
+// Prints one line per policy, fails when a record is lost, duplicated, reordered or corrupted
+
+#include <stddef.h> // offsetof
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <pthread.h>
+
+#include "common.h"
+#include "event_queue.h"
+#include "timing.h"
+
+#define BENCH_MAX_PAYLOAD_SIZE 64
+
+typedef enum BenchKind
+{
+    BenchKind_Move, // Mergeable, like touch moves
+    BenchKind_End,
+} BenchKind;
+
+typedef struct BenchRecord
+{
+    uint32_t kind;
+    uint32_t seq;
+    uint32_t count;       // Pushes merged into this record
+    uint32_t payloadSize;
+    unsigned char payload[BENCH_MAX_PAYLOAD_SIZE];
+} BenchRecord;
+
+#define BENCH_HEADER_SIZE ((uint32_t)offsetof(BenchRecord, payload))
+
+typedef struct BenchRun
+{
+    EventQueue* queue;
+    uint32_t recordCount;
+
+    // Consumer results
+    uint64_t receivedRecords;
+    uint64_t receivedCount; // Sum of the merged counts
+    uint64_t errorCount;
+} BenchRun;
+
+static unsigned char bench_PayloadByte(uint32_t seq, uint32_t i)
+{
+    return (unsigned char)(seq * 31u + i);
+}
+
+static uint32_t bench_Fill(BenchRecord* record, uint32_t seq)
+{
+    record->kind = BenchKind_Move;
+    record->seq = seq;
+    record->count = 1;
+    record->payloadSize = (seq * 2654435761u >> 16) % BENCH_MAX_PAYLOAD_SIZE;
+    for (uint32_t i = 0; i < record->payloadSize; ++i)
+        record->payload[i] = bench_PayloadByte(seq, i);
+    return BENCH_HEADER_SIZE + record->payloadSize;
+}
+
+// The newest record replaces the last one, counts add up. Never shrinks: the queue grows merged records in place
+static uint32_t bench_Merge(void* last, uint32_t lastSize, uint32_t maxSize, const void* element, uint32_t elementSize, void* userData)
+{
+    BenchRecord* lastRecord = last;
+    const BenchRecord* record = element;
+    if (lastRecord->kind != BenchKind_Move || record->kind != BenchKind_Move || elementSize > maxSize)
+        return 0;
+
+    uint32_t count = lastRecord->count + record->count;
+    memcpy(lastRecord, record, elementSize);
+    lastRecord->count = count;
+    return elementSize > lastSize ? elementSize : lastSize;
+}
+
+static void* bench_Producer(void* userData)
+{
+    BenchRun* run = userData;
+    BenchRecord record;
+    for (uint32_t seq = 0; seq < run->recordCount; ++seq)
+    {
+        uint32_t size = bench_Fill(&record, seq);
+        eventQueue_Push(run->queue, &record, size);
+    }
+
+    // Flushes a record still pending with the coalesce policy, the end marker cannot be merged and would drop it
+    eventQueue_WaitEmpty(run->queue);
+    record = (BenchRecord){ .kind = BenchKind_End };
+    eventQueue_Push(run->queue, &record, BENCH_HEADER_SIZE);
+    return NULL;
+}
+
+static void bench_Consume(BenchRun* run)
+{
+    int64_t lastSeq = -1;
+    for (;;)
+    {
+        uint32_t size;
+        const BenchRecord* record = eventQueue_Peek(run->queue, &size);
+        if (record == NULL)
+        {
+            eventQueue_Wait(run->queue);
+            continue;
+        }
+
+        if (record->kind == BenchKind_End)
+        {
+            eventQueue_Release(run->queue);
+            return;
+        }
+
+        bool valid = size >= BENCH_HEADER_SIZE && record->payloadSize <= size - BENCH_HEADER_SIZE
+                  && (int64_t)record->seq > lastSeq && record->count >= 1;
+        for (uint32_t i = 0; valid && i < record->payloadSize; ++i)
+            valid = record->payload[i] == bench_PayloadByte(record->seq, i);
+        if (!valid && run->errorCount++ < 10)
+            fprintf(stderr, "bad record %u after %lld: size %u, payload %u, count %u\n", record->seq, (long long)lastSeq, size,
+                record->payloadSize, record->count);
+
+        lastSeq = record->seq;
+        run->receivedRecords++;
+        run->receivedCount += record->count;
+        eventQueue_Release(run->queue);
+    }
+}
+
+static bool bench_Policy(const char* name, EventQueueOverflow overflow, uint32_t recordCount, uint32_t capacity)
+{
+    EventQueueDesc desc = {
+        .capacity = capacity,
+        .maxElementSize = sizeof(BenchRecord),
+        .overflow = overflow,
+        .coalesce = bench_Merge,
+    };
+    BenchRun run = { .queue = eventQueue_Create(&desc), .recordCount = recordCount };
+
+    int64_t start = time_Now();
+    pthread_t producer;
+    pthread_create(&producer, NULL, bench_Producer, &run);
+    bench_Consume(&run);
+    pthread_join(producer, NULL);
+    int64_t elapsed = time_Now() - start;
+
+    EventQueueStats stats = eventQueue_GetStats(run.queue);
+    eventQueue_Destroy(run.queue);
+
+    // Only the coalesce policy may merge records, the end marker is received too
+    bool passed = run.errorCount == 0 && stats.droppedCount == 0 && stats.receivedCount == recordCount + 1
+               && run.receivedCount == recordCount && (overflow == EventQueueOverflow_Coalesce || run.receivedRecords == recordCount);
+
+    printf("%s,%u,%llu,%.3f,%.1f,%.2f,%u,%.1f\n", name, recordCount, (unsigned long long)run.receivedRecords,
+        time_ToMs(elapsed), (double)elapsed / recordCount, recordCount / time_ToSeconds(elapsed) / 1e6,
+        stats.droppedCount, (double)stats.writtenBytes / (run.receivedRecords + 1));
+    fflush(stdout);
+
+    fprintf(stderr, "%s: %u pushes -> %llu records (%llu counted), %.1f ns per push, %s\n", name, recordCount,
+        (unsigned long long)run.receivedRecords, (unsigned long long)run.receivedCount, (double)elapsed / recordCount,
+        passed ? "ok" : "FAILED");
+    return passed;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t recordCount = 3000000;
+    uint32_t capacity = 4096;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--records") == 0 && i + 1 < argc)
+            recordCount = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--capacity") == 0 && i + 1 < argc)
+            capacity = (uint32_t)atoi(argv[++i]);
+        else
+        {
+            fprintf(stderr, "usage: %s [--records n] [--capacity bytes]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    printf("policy,pushes,records,total_ms,ns_per_push,mpushes_per_s,dropped,bytes_per_record\n");
+    bool passed = true;
+    passed &= bench_Policy("grow", EventQueueOverflow_Grow, recordCount, capacity);
+    passed &= bench_Policy("block", EventQueueOverflow_Block, recordCount, capacity);
+    passed &= bench_Policy("coalesce", EventQueueOverflow_Coalesce, recordCount, capacity);
+    return passed ? 0 : 1;
+}
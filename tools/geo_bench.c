@@ -0,0 +1,115 @@
+// Compares the icosphere generators (see src/geometry.h) across subdivision depths, on Linux
+// Usage:
+//   tools/geo_bench [--max-depth n] > geo.csv
+// Prints one line per depth and layout: vertex and index counts, memory, generation time (best run) and
+// the average transformed vertices per triangle (ACMR) with a GEO_VERTEX_CACHE_SIZE FIFO cache
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "common.h"
+#include "geometry.h"
+#include "job_system.h"
+#include "timing.h"
+
+#define BENCH_MIN_RUNS 3
+#define BENCH_MIN_TIME_NS (200 * TIME_NS_PER_MS) // Per depth and layout
+
+typedef struct BenchResult
+{
+    int vertexCount;
+    int indexCount;
+    int64_t bestTime;
+    float acmr;
+} BenchResult;
+
+static void bench_Print(const char* layout, int depth, const BenchResult* result)
+{
+    size_t bytes = result->vertexCount * sizeof(Vertex) + result->indexCount * sizeof(uint32_t);
+    printf("%d,%s,%d,%d,%.1f,%.3f,%.3f\n", depth, layout, result->vertexCount, result->indexCount,
+        bytes / 1024.0, time_ToMs(result->bestTime), result->acmr);
+}
+
+static BenchResult bench_Soup(JobSystem* jobSystem, int depth)
+{
+    BenchResult result = { geo_getIcosahedronSoupVertexCount(depth), 0, INT64_MAX, 3.f };
+    Vertex* vertices = malloc(result.vertexCount * sizeof(Vertex));
+
+    int64_t benchStart = time_Now();
+    for (int run = 0; run < BENCH_MIN_RUNS || time_Now() - benchStart < BENCH_MIN_TIME_NS; ++run)
+    {
+        int64_t start = time_Now();
+        geo_genIcosahedron(jobSystem, vertices, 1.f, depth);
+        int64_t elapsed = time_Now() - start;
+        if (elapsed < result.bestTime)
+            result.bestTime = elapsed;
+    }
+
+    free(vertices);
+    return result;
+}
+
+static BenchResult bench_Icosphere(int depth, GeoNormals normals, bool optimizeVertexCache)
+{
+    BenchResult result = { 0, 0, INT64_MAX, 0.f };
+    IcosphereDesc desc = { depth, normals, optimizeVertexCache };
+
+    Mesh mesh;
+    int64_t benchStart = time_Now();
+    for (int run = 0; run < BENCH_MIN_RUNS || time_Now() - benchStart < BENCH_MIN_TIME_NS; ++run)
+    {
+        int64_t start = time_Now();
+        if (!geo_genIcosphere(&mesh, &desc))
+            exit(1);
+        int64_t elapsed = time_Now() - start;
+        if (elapsed < result.bestTime)
+            result.bestTime = elapsed;
+        mesh_Free(&mesh);
+    }
+
+    geo_genIcosphere(&mesh, &desc);
+    result.vertexCount = mesh.vertexCount;
+    result.indexCount = mesh.indexCount;
+    result.acmr = geo_computeACMR(mesh.indices, mesh.indexCount, mesh.vertexCount, GEO_VERTEX_CACHE_SIZE);
+    mesh_Free(&mesh);
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    int maxDepth = 7;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--max-depth") == 0 && i + 1 < argc)
+            maxDepth = atoi(argv[++i]);
+        else
+        {
+            fprintf(stderr, "usage: %s [--max-depth n]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    JobSystem* jobSystem = jobSystem_Create(0);
+
+    printf("depth,layout,vertices,indices,kib,gen_ms,acmr\n");
+    for (int depth = 0; depth <= maxDepth; ++depth)
+    {
+        BenchResult soup = bench_Soup(jobSystem, depth);
+        BenchResult smooth = bench_Icosphere(depth, GeoNormals_Smooth, false);
+        BenchResult optimized = bench_Icosphere(depth, GeoNormals_Smooth, true);
+        BenchResult flat = bench_Icosphere(depth, GeoNormals_Flat, false);
+
+        bench_Print("soup", depth, &soup);
+        bench_Print("indexed_smooth", depth, &smooth);
+        bench_Print("indexed_smooth_tipsify", depth, &optimized);
+        bench_Print("indexed_flat", depth, &flat);
+        fflush(stdout);
+
+        fprintf(stderr, "depth %d: %d -> %d vertices (%.1fx fewer), ACMR %.3f -> %.3f\n", depth,
+            soup.vertexCount, optimized.vertexCount, soup.vertexCount / (float)optimized.vertexCount, smooth.acmr, optimized.acmr);
+    }
+
+    jobSystem_Destroy(jobSystem);
+    return 0;
+}
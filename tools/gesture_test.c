@@ -0,0 +1,403 @@
+// Checks the gesture recognizer (see src/gesture.h) against synthetic touch streams, on Linux
+// Usage:
+//   tools/gesture_test > gestures.csv
+// Each case feeds motion events sampled at 120 Hz to a recognizer updated at 60 Hz like the app thread does, then
+// compares the gestures of every frame with what the case expects: type, phase, position, movement, scale, velocity
+// and, for long presses, the frame. Consecutive Changed records are summed across frames before comparing.
+// Recorded cases go through an event recording and the simulation instead, like the app thread records them and
+// tools/replay.c plays them back, so the recorded clock must match the motion event times.
+// Prints every gesture recognized, fails when a case does not give exactly the expected ones
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <unistd.h> // mkstemp, close, unlink
+
+#include "common.h"
+#include "app_event.h"
+#include "event_recording.h"
+#include "gesture.h"
+#include "simulation.h"
+#include "timing.h"
+
+#define TEST_MAX_EVENTS 128
+#define TEST_MAX_GESTURES 16
+#define TEST_START_NS TIME_NS_PER_SECOND // Motion times are never 0, the recognizer uses 0 for "no previous tap"
+#define TEST_SAMPLE_NS 8333333           // 120 Hz touch sampling
+#define TEST_FRAME_NS 16666667           // 60 Hz frames
+
+#define ANY_FRAME -1
+
+typedef struct TestStream
+{
+    int count;
+    MotionEvent events[TEST_MAX_EVENTS];
+} TestStream;
+
+typedef struct TestGesture
+{
+    GestureType type;
+    GesturePhase phase;
+    bool canceled;
+    int frame;    // ANY_FRAME if not checked
+    float x, y;
+    float dx, dy;
+    float scale;
+    float vx, vy; // Checked within 1%
+} TestGesture;
+
+typedef struct TestCase
+{
+    const char* name;
+    bool recorded; // Through an event recording and the simulation, see test_RunRecording()
+    TestStream stream;
+    int expectedCount;
+    TestGesture expected[TEST_MAX_GESTURES];
+} TestCase;
+
+// `sample` is the index of the 120 Hz sample, positions are x0, y0, x1, y1 for two pointers
+static void stream_Add(TestStream* stream, int sample, int action, int pointerCount, float x0, float y0, float x1, float y1)
+{
+    MotionEvent* event = &stream->events[stream->count++];
+    *event = (MotionEvent){
+        .action = action,
+        .pointerCount = pointerCount,
+        .pointerId = { 0, 1 },
+        .x = { x0, x1 },
+        .y = { y0, y1 },
+        .pressure = { 1.f, 1.f },
+        .eventTime = TEST_START_NS + (int64_t)sample * TEST_SAMPLE_NS,
+    };
+    event->receivedTime = event->eventTime;
+}
+
+static void stream_Add1(TestStream* stream, int sample, int action, float x, float y)
+{
+    stream_Add(stream, sample, action, 1, x, y, 0.f, 0.f);
+}
+
+#define POINTER_1(action) ((action) | (1 << AMOTION_EVENT_ACTION_POINTER_INDEX_SHIFT))
+
+static void case_Tap(TestCase* test)
+{
+    test->name = "tap";
+    stream_Add1(&test->stream, 0, AMOTION_EVENT_ACTION_DOWN, 100.f, 200.f);
+    stream_Add1(&test->stream, 5, AMOTION_EVENT_ACTION_MOVE, 102.f, 201.f); // Within the slop
+    stream_Add1(&test->stream, 10, AMOTION_EVENT_ACTION_UP, 102.f, 201.f);
+
+    test->expected[test->expectedCount++] = (TestGesture){ GestureType_Tap, GesturePhase_Ended, false, ANY_FRAME, 100.f, 200.f, 0.f, 0.f, 1.f, 0.f, 0.f };
+}
+
+static void case_DoubleTap(TestCase* test)
+{
+    test->name = "double_tap";
+    stream_Add1(&test->stream, 0, AMOTION_EVENT_ACTION_DOWN, 100.f, 200.f);
+    stream_Add1(&test->stream, 10, AMOTION_EVENT_ACTION_UP, 100.f, 200.f);
+    stream_Add1(&test->stream, 24, AMOTION_EVENT_ACTION_DOWN, 104.f, 203.f); // 117 ms after the first up, 5 px away
+    stream_Add1(&test->stream, 31, AMOTION_EVENT_ACTION_UP, 104.f, 203.f);
+
+    test->expected[test->expectedCount++] = (TestGesture){ GestureType_Tap, GesturePhase_Ended, false, ANY_FRAME, 100.f, 200.f, 0.f, 0.f, 1.f, 0.f, 0.f };
+    test->expected[test->expectedCount++] = (TestGesture){ GestureType_DoubleTap, GesturePhase_Ended, false, ANY_FRAME, 104.f, 203.f, 0.f, 0.f, 1.f, 0.f, 0.f };
+}
+
+static void case_LongPress(TestCase* test)
+{
+    test->name = "long_press";
+    stream_Add1(&test->stream, 0, AMOTION_EVENT_ACTION_DOWN, 300.f, 400.f);
+    for (int i = 1; i <= 4; ++i)
+        stream_Add1(&test->stream, i * 12, AMOTION_EVENT_ACTION_MOVE, 300.f + i, 400.f - i); // Every 100 ms, within the slop
+    stream_Add1(&test->stream, 84, AMOTION_EVENT_ACTION_UP, 304.f, 396.f); // 700 ms, not a tap anymore
+
+    // Published by the first frame 500 ms after the down, not by the next sample: 30 * 16.67 ms
+    test->expected[test->expectedCount++] = (TestGesture){ GestureType_LongPress, GesturePhase_Ended, false, 30, 300.f, 400.f, 0.f, 0.f, 1.f, 0.f, 0.f };
+}
+
+// Same frame once recorded with absolute times, replayed on the recorded frame clock
+static void case_LongPressRecorded(TestCase* test)
+{
+    case_LongPress(test);
+    test->name = "long_press_recorded";
+    test->recorded = true;
+}
+
+static void case_Drag(TestCase* test)
+{
+    test->name = "drag";
+    stream_Add1(&test->stream, 0, AMOTION_EVENT_ACTION_DOWN, 100.f, 800.f);
+    for (int i = 1; i <= 10; ++i)
+        stream_Add1(&test->stream, i, AMOTION_EVENT_ACTION_MOVE, 100.f, 800.f - 10.f * i);
+    for (int i = 11; i <= 25; ++i)
+        stream_Add1(&test->stream, i, AMOTION_EVENT_ACTION_MOVE, 100.f, 700.f); // Held still for 125 ms
+    stream_Add1(&test->stream, 26, AMOTION_EVENT_ACTION_UP, 100.f, 700.f);
+
+    // Begins on the first sample beyond the 24 px slop, released too slowly to fling
+    test->expected[test->expectedCount++] = (TestGesture){ GestureType_Drag, GesturePhase_Began, false, ANY_FRAME, 100.f, 770.f, 0.f, -30.f, 1.f, 0.f, 0.f };
+    test->expected[test->expectedCount++] = (TestGesture){ GestureType_Drag, GesturePhase_Changed, false, ANY_FRAME, 100.f, 700.f, 0.f, -70.f, 1.f, 0.f, 0.f };
+    test->expected[test->expectedCount++] = (TestGesture){ GestureType_Drag, GesturePhase_Ended, false, ANY_FRAME, 100.f, 700.f, 0.f, 0.f, 1.f, 0.f, 0.f };
+}
+
+static void case_DragCancel(TestCase* test)
+{
+    test->name = "drag_cancel";
+    stream_Add1(&test->stream, 0, AMOTION_EVENT_ACTION_DOWN, 500.f, 500.f);
+    for (int i = 1; i <= 6; ++i)
+        stream_Add1(&test->stream, i, AMOTION_EVENT_ACTION_MOVE, 500.f + 10.f * i, 500.f);
+    stream_Add1(&test->stream, 7, AMOTION_EVENT_ACTION_CANCEL, 570.f, 500.f);
+
+    test->expected[test->expectedCount++] = (TestGesture){ GestureType_Drag, GesturePhase_Began, false, ANY_FRAME, 530.f, 500.f, 30.f, 0.f, 1.f, 0.f, 0.f };
+    test->expected[test->expectedCount++] = (TestGesture){ GestureType_Drag, GesturePhase_Changed, false, ANY_FRAME, 560.f, 500.f, 30.f, 0.f, 1.f, 0.f, 0.f };
+    test->expected[test->expectedCount++] = (TestGesture){ GestureType_Drag, GesturePhase_Ended, true, ANY_FRAME, 560.f, 500.f, 0.f, 0.f, 1.f, 0.f, 0.f };
+}
+
+static void case_Fling(TestCase* test)
+{
+    test->name = "fling";
+    stream_Add1(&test->stream, 0, AMOTION_EVENT_ACTION_DOWN, 100.f, 800.f);
+    for (int i = 1; i <= 15; ++i)
+        stream_Add1(&test->stream, i, AMOTION_EVENT_ACTION_MOVE, 100.f, 800.f - 20.f * i);
+    stream_Add1(&test->stream, 16, AMOTION_EVENT_ACTION_UP, 100.f, 480.f); // Still moving when released
+
+    // 20 px every 8.33 ms
+    test->expected[test->expectedCount++] = (TestGesture){ GestureType_Drag, GesturePhase_Began, false, ANY_FRAME, 100.f, 760.f, 0.f, -40.f, 1.f, 0.f, 0.f };
+    test->expected[test->expectedCount++] = (TestGesture){ GestureType_Drag, GesturePhase_Changed, false, ANY_FRAME, 100.f, 480.f, 0.f, -280.f, 1.f, 0.f, 0.f };
+    test->expected[test->expectedCount++] = (TestGesture){ GestureType_Drag, GesturePhase_Ended, false, ANY_FRAME, 100.f, 480.f, 0.f, 0.f, 1.f, 0.f, 0.f };
+    test->expected[test->expectedCount++] = (TestGesture){ GestureType_Fling, GesturePhase_Ended, false, ANY_FRAME, 100.f, 480.f, 0.f, 0.f, 1.f, 0.f, -2400.f };
+}
+
+static void case_Pinch(TestCase* test)
+{
+    test->name = "pinch";
+    stream_Add1(&test->stream, 0, AMOTION_EVENT_ACTION_DOWN, 400.f, 600.f);
+    stream_Add(&test->stream, 1, POINTER_1(AMOTION_EVENT_ACTION_POINTER_DOWN), 2, 400.f, 600.f, 500.f, 600.f);
+    for (int i = 1; i <= 10; ++i)
+        stream_Add(&test->stream, 1 + i, AMOTION_EVENT_ACTION_MOVE, 2, 400.f - 10.f * i, 600.f, 500.f + 10.f * i, 600.f);
+    stream_Add(&test->stream, 12, POINTER_1(AMOTION_EVENT_ACTION_POINTER_UP), 2, 300.f, 600.f, 600.f, 600.f);
+    stream_Add1(&test->stream, 13, AMOTION_EVENT_ACTION_UP, 300.f, 600.f); // Only ends the gesture already ended
+
+    // Spread from 100 to 300 px around a fixed centroid
+    test->expected[test->expectedCount++] = (TestGesture){ GestureType_Pinch, GesturePhase_Began, false, ANY_FRAME, 450.f, 600.f, 0.f, 0.f, 1.f, 0.f, 0.f };
+    test->expected[test->expectedCount++] = (TestGesture){ GestureType_Pinch, GesturePhase_Changed, false, ANY_FRAME, 450.f, 600.f, 0.f, 0.f, 3.f, 0.f, 0.f };
+    test->expected[test->expectedCount++] = (TestGesture){ GestureType_Pinch, GesturePhase_Ended, false, ANY_FRAME, 450.f, 600.f, 0.f, 0.f, 1.f, 0.f, 0.f };
+}
+
+static bool test_Near(float value, float expected, float tolerance)
+{
+    return fabsf(value - expected) <= tolerance;
+}
+
+static bool test_Matches(const TestGesture* got, const TestGesture* expected)
+{
+    return got->type == expected->type && got->phase == expected->phase && got->canceled == expected->canceled
+        && (expected->frame == ANY_FRAME || got->frame == expected->frame)
+        && test_Near(got->x, expected->x, 0.01f) && test_Near(got->y, expected->y, 0.01f)
+        && test_Near(got->dx, expected->dx, 0.01f) && test_Near(got->dy, expected->dy, 0.01f)
+        && test_Near(got->scale, expected->scale, 0.001f * expected->scale)
+        && test_Near(got->vx, expected->vx, 0.01f * fabsf(expected->vx) + 0.01f)
+        && test_Near(got->vy, expected->vy, 0.01f * fabsf(expected->vy) + 0.01f);
+}
+
+static void test_Print(const char* name, const TestGesture* gesture)
+{
+    static const char* phaseStr[] = { "Began", "Changed", "Ended" };
+    printf("%s,%d,%s,%s,%d,%.2f,%.2f,%.2f,%.2f,%.4f,%.1f,%.1f\n", name, gesture->frame, gestureTypeStr[gesture->type],
+        phaseStr[gesture->phase], gesture->canceled, gesture->x, gesture->y, gesture->dx, gesture->dy, gesture->scale,
+        gesture->vx, gesture->vy);
+}
+
+typedef struct TestResult
+{
+    int gotCount;
+    int dropped;
+    TestGesture got[TEST_MAX_GESTURES];
+} TestResult;
+
+static void result_AddFrame(TestResult* result, const GestureFrame* frame, int frameIndex)
+{
+    result->dropped += frame->droppedCount;
+    for (int i = 0; i < frame->count; ++i)
+    {
+        const Gesture* g = &frame->gestures[i];
+        TestGesture* last = result->gotCount ? &result->got[result->gotCount - 1] : NULL;
+        if (last && g->phase == GesturePhase_Changed && last->phase == GesturePhase_Changed && last->type == g->type)
+        {
+            last->x = g->x;
+            last->y = g->y;
+            last->dx += g->dx;
+            last->dy += g->dy;
+            last->scale *= g->scale;
+            continue;
+        }
+
+        if (result->gotCount == TEST_MAX_GESTURES)
+        {
+            result->dropped++;
+            continue;
+        }
+        result->got[result->gotCount++] = (TestGesture){ g->type, g->phase, g->canceled, frameIndex, g->x, g->y, g->dx, g->dy, g->scale, g->vx, g->vy };
+    }
+}
+
+static int64_t test_GetEndTime(const TestCase* test)
+{
+    return test->stream.events[test->stream.count - 1].eventTime + TIME_NS_PER_SECOND;
+}
+
+// Events are handled before the frame they precede, then the recognizer is updated and its frame taken
+static void test_RunRecognizer(const TestCase* test, TestResult* result)
+{
+    GestureRecognizer recognizer;
+    gestureRecognizer_Init(&recognizer, &(GestureDesc){ 0 });
+
+    int next = 0;
+    for (int frameIndex = 1; TEST_START_NS + (int64_t)frameIndex * TEST_FRAME_NS <= test_GetEndTime(test); ++frameIndex)
+    {
+        int64_t frameTime = TEST_START_NS + (int64_t)frameIndex * TEST_FRAME_NS;
+        while (next < test->stream.count && test->stream.events[next].eventTime <= frameTime)
+            gestureRecognizer_HandleMotion(&recognizer, &test->stream.events[next++]);
+
+        GestureFrame frame;
+        gestureRecognizer_Update(&recognizer, frameTime);
+        gestureRecognizer_TakeFrame(&recognizer, &frame);
+        result_AddFrame(result, &frame, frameIndex);
+    }
+}
+
+static int64_t test_Now(void* userData)
+{
+    return *(const int64_t*)userData;
+}
+
+// Records the stream like the app thread: time_Now() based event times, events consumed when the frame begins, then
+// plays it back like tools/replay.c, the simulation reading the recorded frame clock
+static bool test_RunRecording(const TestCase* test, TestResult* result)
+{
+    char filename[] = "/tmp/gesture_test_XXXXXX";
+    int fd = mkstemp(filename);
+    if (fd < 0)
+    {
+        fprintf(stderr, "%s: cannot create a recording\n", test->name);
+        return false;
+    }
+    close(fd);
+
+    EventRecorder* recorder = eventRecorder_Create(filename);
+    if (!recorder)
+    {
+        unlink(filename);
+        return false;
+    }
+
+    int64_t shift = time_Now() - TEST_START_NS; // After the recording start, like the app's clock
+    int next = 0;
+    for (int frameIndex = 1; TEST_START_NS + (int64_t)frameIndex * TEST_FRAME_NS <= test_GetEndTime(test); ++frameIndex)
+    {
+        int64_t frameTime = TEST_START_NS + (int64_t)frameIndex * TEST_FRAME_NS + shift;
+        while (next < test->stream.count && test->stream.events[next].eventTime + shift <= frameTime)
+        {
+            Event event = {
+                .type = EventType_DispatchMotionEvent,
+                .dispatchTouchEvent = { .type = AINPUT_EVENT_TYPE_MOTION, .motionEvent = test->stream.events[next++] },
+            };
+            event.dispatchTouchEvent.motionEvent.eventTime += shift;
+            event.dispatchTouchEvent.motionEvent.receivedTime += shift;
+
+            unsigned char record[EVENT_MAX_ENCODED_SIZE];
+            uint32_t size = event_Encode(&event, record);
+            eventRecorder_AddEvent(recorder, frameTime, record, size);
+        }
+        eventRecorder_AddFrame(recorder, frameTime);
+    }
+    eventRecorder_Destroy(recorder);
+
+    EventPlayer* player = eventPlayer_Open(filename);
+    unlink(filename);
+    if (!player)
+        return false;
+
+    // No Create event, the simulation runs without a game
+    int64_t clockTime = 0;
+    GameFrame frame = { 0 }; // Stays empty
+    Simulation sim;
+    simulation_Init(&sim, &(SimulationDesc){ .now = test_Now, .nowUserData = &clockTime });
+
+    int frameIndex = 1;
+    EventRecordingEntry entry;
+    const void* data;
+    while (eventPlayer_Next(player, &entry, &data))
+    {
+        if (entry.kind == EventRecordingKind_Event)
+        {
+            Event event;
+            event_Decode(&event, data);
+            simulation_HandleEvent(&sim, &event);
+        }
+        else if (entry.kind == EventRecordingKind_Frame)
+        {
+            clockTime = eventPlayer_GetTime(player, &entry);
+            simulation_Update(&sim, &frame);
+            result_AddFrame(result, &sim.gameInputs.gestures, frameIndex++);
+            simulation_BeginFrame(&sim);
+        }
+    }
+
+    simulation_Terminate(&sim);
+    eventPlayer_Close(player);
+    return true;
+}
+
+static bool test_Run(const TestCase* test)
+{
+    TestResult result = { 0 };
+    bool passed = true;
+    if (test->recorded)
+        passed = test_RunRecording(test, &result);
+    else
+        test_RunRecognizer(test, &result);
+
+    passed &= result.gotCount == test->expectedCount && result.dropped == 0;
+    for (int i = 0; i < result.gotCount; ++i)
+    {
+        test_Print(test->name, &result.got[i]);
+        if (i < test->expectedCount && !test_Matches(&result.got[i], &test->expected[i]))
+        {
+            fprintf(stderr, "%s: gesture %d does not match, expected:\n", test->name, i);
+            const TestGesture* e = &test->expected[i];
+            fprintf(stderr, "  %s phase %d canceled %d frame %d at (%.2f, %.2f) delta (%.2f, %.2f) scale %.4f velocity (%.1f, %.1f)\n",
+                gestureTypeStr[e->type], e->phase, e->canceled, e->frame, e->x, e->y, e->dx, e->dy, e->scale, e->vx, e->vy);
+            passed = false;
+        }
+    }
+    fflush(stdout);
+
+    if (result.gotCount != test->expectedCount || result.dropped)
+        fprintf(stderr, "%s: %d gestures (%d dropped), expected %d\n", test->name, result.gotCount, result.dropped, test->expectedCount);
+    fprintf(stderr, "%s: %s\n", test->name, passed ? "ok" : "FAILED");
+    return passed;
+}
+
+int main(int argc, char** argv)
+{
+    static void (*const cases[])(TestCase*) = {
+        case_Tap,
+        case_DoubleTap,
+        case_LongPress,
+        case_LongPressRecorded,
+        case_Drag,
+        case_DragCancel,
+        case_Fling,
+        case_Pinch,
+    };
+
+    printf("case,frame,gesture,phase,canceled,x,y,dx,dy,scale,vx,vy\n");
+    bool passed = true;
+    for (int i = 0; i < ARRAYSIZE(cases); ++i)
+    {
+        TestCase* test = calloc(1, sizeof(TestCase));
+        cases[i](test);
+        passed &= test_Run(test);
+        free(test);
+    }
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,157 @@
+// Native side of tools/JniBench.java, loaded by a desktop JVM
+// Usage:
+//   make tools/jni_bench JAVA_HOME=/usr/lib/jvm/default-java
+// Reads touch events the way src/activity.c did before the input ring (mirror object, field and array access per event)
+// and the way it does now (inputRing_Read() per doorbell). Events are folded into a checksum instead of being queued, the
+// queue push is the same on both paths
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <jni.h>
+
+#include "common.h"
+#include "event.h"
+#include "input_ring.h"
+
+typedef struct MotionEventProto
+{
+    jclass clazz;
+    jfieldID action;
+    jfieldID pointerCount;
+    jfieldID x;
+    jfieldID y;
+} MotionEventProto;
+
+typedef struct BenchState
+{
+    MotionEventProto motionEvent;
+    InputRing inputRing;
+    uint64_t checksum;
+    uint32_t eventCount;
+} BenchState;
+
+// Removed from src/activity.c with NativeWrapper.MotionEvent
+static void motionEvent_Register(JNIEnv* env, MotionEventProto* proto)
+{
+    proto->clazz = (*env)->FindClass(env, "JniBench$MotionEvent");
+    proto->action = (*env)->GetFieldID(env, proto->clazz, "action", "I");
+    proto->pointerCount = (*env)->GetFieldID(env, proto->clazz, "pointerCount", "I");
+    proto->x = (*env)->GetFieldID(env, proto->clazz, "x", "[I");
+    proto->y = (*env)->GetFieldID(env, proto->clazz, "y", "[I");
+}
+
+static void jni_FillIntArray(int* dst, int size, JNIEnv* env, jobject object, jfieldID field)
+{
+    jintArray intArrJava = (*env)->GetObjectField(env, object, field);
+    int* intArrNative = (*env)->GetIntArrayElements(env, intArrJava, NULL);
+    memcpy(dst, intArrNative, size * sizeof(int));
+    (*env)->ReleaseIntArrayElements(env, intArrJava, intArrNative, 0);
+}
+
+// The old path only carried integer positions, without pointer ids or pressure
+static void motionEvent_FromJava(JNIEnv* env, MotionEventProto* proto, jobject object, InputEvent* event)
+{
+    int x[MOTION_EVENT_MAX_POINTERS], y[MOTION_EVENT_MAX_POINTERS];
+    *event = (InputEvent){ AINPUT_EVENT_TYPE_MOTION };
+
+    event->motionEvent.pointerCount = (*env)->GetIntField(env, object, proto->pointerCount);
+    jni_FillIntArray(x, event->motionEvent.pointerCount, env, object, proto->x);
+    jni_FillIntArray(y, event->motionEvent.pointerCount, env, object, proto->y);
+    event->motionEvent.action = (*env)->GetIntField(env, object, proto->action);
+
+    for (int i = 0; i < event->motionEvent.pointerCount; ++i)
+    {
+        event->motionEvent.x[i] = (float)x[i];
+        event->motionEvent.y[i] = (float)y[i];
+    }
+}
+
+// What both paths deliver, must not depend on the path
+static void bench_AddEvent(BenchState* state, const InputEvent* event)
+{
+    const MotionEvent* motionEvent = &event->motionEvent;
+    uint64_t hash = state->checksum ^ ((uint64_t)motionEvent->action << 32 | (uint32_t)motionEvent->pointerCount);
+    for (int i = 0; i < motionEvent->pointerCount; ++i)
+        hash = (hash ^ ((uint64_t)(int64_t)motionEvent->x[i] << 32 | (uint32_t)(int32_t)motionEvent->y[i])) * 1099511628211ull;
+    state->checksum = hash * 1099511628211ull;
+    state->eventCount++;
+}
+
+static jlong jniBench_Create(JNIEnv* jniEnv, jclass clazz, jobject inputRing)
+{
+    BenchState* state = calloc(1, sizeof(BenchState));
+    motionEvent_Register(jniEnv, &state->motionEvent);
+    inputRing_Init(&state->inputRing, (*jniEnv)->GetDirectBufferAddress(jniEnv, inputRing),
+        (uint32_t)(*jniEnv)->GetDirectBufferCapacity(jniEnv, inputRing));
+    return (jlong)(size_t)state;
+}
+
+static void jniBench_Destroy(JNIEnv* jniEnv, jclass clazz, jlong handle)
+{
+    free((BenchState*)((size_t)handle));
+}
+
+static jlong jniBench_TakeChecksum(JNIEnv* jniEnv, jclass clazz, jlong handle)
+{
+    BenchState* state = (BenchState*)((size_t)handle);
+    uint64_t checksum = state->checksum;
+    state->checksum = 0;
+    return (jlong)checksum;
+}
+
+static jint jniBench_TakeEventCount(JNIEnv* jniEnv, jclass clazz, jlong handle)
+{
+    BenchState* state = (BenchState*)((size_t)handle);
+    uint32_t eventCount = state->eventCount;
+    state->eventCount = 0;
+    return (jint)eventCount;
+}
+
+static jboolean jniBench_DispatchTouchEvent(JNIEnv* jniEnv, jclass clazz, jlong handle, jobject motionEvent)
+{
+    BenchState* state = (BenchState*)((size_t)handle);
+    InputEvent inputEvent;
+    motionEvent_FromJava(jniEnv, &state->motionEvent, motionEvent, &inputEvent);
+    bench_AddEvent(state, &inputEvent);
+    return JNI_TRUE;
+}
+
+static void jniBench_InputDoorbell(JNIEnv* jniEnv, jclass clazz, jlong handle, jint writeOffset)
+{
+    BenchState* state = (BenchState*)((size_t)handle);
+    InputEvent inputEvent;
+    while (inputRing_Read(&state->inputRing, (uint32_t)writeOffset, &inputEvent))
+        bench_AddEvent(state, &inputEvent);
+}
+
+// X(javaName, signature, function), must match JniBench.java
+#define JNI_BENCH_METHODS(X) \
+    X("create", "(Ljava/nio/ByteBuffer;)J", jniBench_Create) \
+    X("destroy", "(J)V", jniBench_Destroy) \
+    X("takeChecksum", "(J)J", jniBench_TakeChecksum) \
+    X("takeEventCount", "(J)I", jniBench_TakeEventCount) \
+    X("dispatchTouchEvent", "(JLJniBench$MotionEvent;)Z", jniBench_DispatchTouchEvent) \
+    X("inputDoorbell", "(JI)V", jniBench_InputDoorbell)
+
+#define NATIVE_METHOD(name, signature, function) { name, signature, (void*)function },
+
+static const JNINativeMethod jniBenchMethods[] = { JNI_BENCH_METHODS(NATIVE_METHOD) };
+
+JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM* vm, void* reserved)
+{
+    JNIEnv* env;
+    if ((*vm)->GetEnv(vm, (void**)&env, JNI_VERSION_1_6) != JNI_OK)
+        return JNI_ERR;
+
+    jclass clazz = (*env)->FindClass(env, "JniBench");
+    if (!clazz || (*env)->RegisterNatives(env, clazz, jniBenchMethods, ARRAYSIZE(jniBenchMethods)) != JNI_OK)
+    {
+        (*env)->ExceptionClear(env);
+        ALOGE("RegisterNatives() failed for JniBench");
+        return JNI_ERR;
+    }
+    (*env)->DeleteLocalRef(env, clazz);
+
+    return JNI_VERSION_1_6;
+}
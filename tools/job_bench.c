@@ -0,0 +1,244 @@
+// Scaling of the job system (see src/job_system.h) from 1 to N workers, on Linux
+// Usage:
+//   tools/job_bench [--max-workers n] > jobs.csv
+// Runs each workload on job systems of 1 to n workers (one per core by default): a parallel-for over independent
+// items, chains of dependent jobs joined by a last one, and the icosahedron faces game_Init() generates.
+// Prints one line per worker count and workload with the best run and the speedup over one worker, fails when a
+// workload gives a different result than on one worker or runs its jobs out of order
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <unistd.h> // sysconf
+
+#include "common.h"
+#include "geometry.h"
+#include "job_system.h"
+#include "timing.h"
+
+#define BENCH_MIN_RUNS 3
+#define BENCH_MIN_TIME_NS (200 * TIME_NS_PER_MS) // Per worker count and workload
+
+#define BENCH_ITEM_COUNT (1 << 16)
+#define BENCH_ITEM_ROUNDS 256   // Hash rounds per item, about as long as a few matrix products
+#define BENCH_CHAIN_COUNT 64
+#define BENCH_CHAIN_LENGTH 16   // Chains * length stays well under JOB_POOL_SIZE
+#define BENCH_LINK_ROUNDS 4096
+#define BENCH_SOUP_DEPTH 6
+
+typedef enum BenchWorkload
+{
+    BenchWorkload_ParallelFor,
+    BenchWorkload_Chains,
+    BenchWorkload_Icosahedron,
+    BenchWorkload_Count,
+} BenchWorkload;
+
+static const char* workloadStr[] = { "parallel_for", "chains", "icosahedron" };
+
+typedef struct BenchChain
+{
+    uint32_t nextLink; // Only touched by the job of that link, in order
+    uint32_t value;
+} BenchChain;
+
+typedef struct BenchState
+{
+    JobSystem* jobSystem;
+    uint32_t* items;
+    BenchChain chains[BENCH_CHAIN_COUNT];
+    uint32_t orderErrors;
+    Vertex* vertices;
+} BenchState;
+
+typedef struct BenchLink
+{
+    BenchState* state;
+    uint32_t chain;
+    uint32_t link;
+} BenchLink;
+
+static uint32_t bench_Hash(uint32_t x, int rounds)
+{
+    for (int i = 0; i < rounds; ++i)
+    {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        x += 0x9E3779B9u;
+    }
+    return x;
+}
+
+static void bench_Item(void* userData, uint32_t begin, uint32_t end)
+{
+    BenchState* state = userData;
+    for (uint32_t i = begin; i < end; ++i)
+        state->items[i] = bench_Hash(i, BENCH_ITEM_ROUNDS);
+}
+
+static void bench_Link(void* userData, uint32_t begin, uint32_t end)
+{
+    const BenchLink* link = userData;
+    BenchChain* chain = &link->state->chains[link->chain];
+    if (chain->nextLink++ != link->link)
+        link->state->orderErrors++; // Only written when the dependencies are broken, any count fails the run
+    chain->value = bench_Hash(chain->value + link->link, BENCH_LINK_ROUNDS);
+}
+
+static void bench_Join(void* userData, uint32_t begin, uint32_t end)
+{
+    BenchState* state = userData;
+    for (int c = 0; c < BENCH_CHAIN_COUNT; ++c)
+    {
+        if (state->chains[c].nextLink != BENCH_CHAIN_LENGTH)
+            state->orderErrors++;
+    }
+}
+
+static void bench_Chains(BenchState* state)
+{
+    static BenchLink links[BENCH_CHAIN_COUNT][BENCH_CHAIN_LENGTH];
+    memset(state->chains, 0, sizeof(state->chains));
+
+    Job* join = jobSystem_CreateJob(state->jobSystem, bench_Join, state);
+    for (uint32_t c = 0; c < BENCH_CHAIN_COUNT; ++c)
+    {
+        Job* previous = NULL;
+        for (uint32_t l = 0; l < BENCH_CHAIN_LENGTH; ++l)
+        {
+            links[c][l] = (BenchLink){ state, c, l };
+            Job* job = jobSystem_CreateJob(state->jobSystem, bench_Link, &links[c][l]);
+            if (previous)
+                jobSystem_AddDependency(job, previous);
+            jobSystem_Submit(state->jobSystem, job);
+            previous = job;
+        }
+        jobSystem_AddDependency(join, previous);
+    }
+    jobSystem_Submit(state->jobSystem, join);
+    jobSystem_Wait(state->jobSystem, join);
+}
+
+static void bench_Run(BenchState* state, BenchWorkload workload)
+{
+    switch (workload)
+    {
+        case BenchWorkload_ParallelFor:
+            jobSystem_ParallelFor(state->jobSystem, BENCH_ITEM_COUNT, 256, bench_Item, state);
+            break;
+        case BenchWorkload_Chains:
+            bench_Chains(state);
+            break;
+        case BenchWorkload_Icosahedron:
+            geo_genIcosahedron(state->jobSystem, state->vertices, 1.f, BENCH_SOUP_DEPTH);
+            break;
+        default:
+            break;
+    }
+}
+
+// Hash of what the workload produced, must not depend on the worker count
+static uint64_t bench_Result(const BenchState* state, BenchWorkload workload)
+{
+    const unsigned char* bytes = NULL;
+    size_t size = 0;
+    switch (workload)
+    {
+        case BenchWorkload_ParallelFor:
+            bytes = (const unsigned char*)state->items;
+            size = BENCH_ITEM_COUNT * sizeof(uint32_t);
+            break;
+        case BenchWorkload_Chains:
+            bytes = (const unsigned char*)state->chains;
+            size = sizeof(state->chains);
+            break;
+        case BenchWorkload_Icosahedron:
+            bytes = (const unsigned char*)state->vertices;
+            size = geo_getIcosahedronSoupVertexCount(BENCH_SOUP_DEPTH) * sizeof(Vertex);
+            break;
+        default:
+            break;
+    }
+
+    uint64_t hash = 14695981039346656037ull; // FNV-1a
+    for (size_t i = 0; i < size; ++i)
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    return hash;
+}
+
+int main(int argc, char** argv)
+{
+    int maxWorkers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--max-workers") == 0 && i + 1 < argc)
+            maxWorkers = atoi(argv[++i]);
+        else
+        {
+            fprintf(stderr, "usage: %s [--max-workers n]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (maxWorkers < 1)
+        maxWorkers = 1;
+
+    BenchState state = { 0 };
+    state.items = malloc(BENCH_ITEM_COUNT * sizeof(uint32_t));
+    state.vertices = malloc(geo_getIcosahedronSoupVertexCount(BENCH_SOUP_DEPTH) * sizeof(Vertex));
+
+    int64_t singleTime[BenchWorkload_Count];
+    uint64_t singleResult[BenchWorkload_Count];
+    double speedup[BenchWorkload_Count];
+    bool passed = true;
+
+    printf("workers,workload,best_ms,speedup\n");
+    for (int workerCount = 1; workerCount <= maxWorkers; ++workerCount)
+    {
+        state.jobSystem = jobSystem_Create(workerCount);
+        for (int workload = 0; workload < BenchWorkload_Count; ++workload)
+        {
+            int64_t bestTime = INT64_MAX;
+            int64_t benchStart = time_Now();
+            for (int run = 0; run < BENCH_MIN_RUNS || time_Now() - benchStart < BENCH_MIN_TIME_NS; ++run)
+            {
+                int64_t start = time_Now();
+                bench_Run(&state, workload);
+                int64_t elapsed = time_Now() - start;
+                if (elapsed < bestTime)
+                    bestTime = elapsed;
+            }
+
+            uint64_t result = bench_Result(&state, workload);
+            if (workerCount == 1)
+            {
+                singleTime[workload] = bestTime;
+                singleResult[workload] = result;
+            }
+            else if (result != singleResult[workload])
+            {
+                fprintf(stderr, "%s: %d workers give a different result than 1\n", workloadStr[workload], workerCount);
+                passed = false;
+            }
+
+            speedup[workload] = (double)singleTime[workload] / bestTime;
+            printf("%d,%s,%.3f,%.2f\n", workerCount, workloadStr[workload], time_ToMs(bestTime), speedup[workload]);
+        }
+        jobSystem_Destroy(state.jobSystem);
+        fflush(stdout);
+    }
+
+    if (state.orderErrors)
+    {
+        fprintf(stderr, "chains: %u jobs ran before their dependency\n", state.orderErrors);
+        passed = false;
+    }
+
+    for (int workload = 0; workload < BenchWorkload_Count; ++workload)
+        fprintf(stderr, "%s: %.2fx faster on %d workers than on 1\n", workloadStr[workload], speedup[workload], maxWorkers);
+
+    free(state.vertices);
+    free(state.items);
+    return passed ? 0 : 1;
+}
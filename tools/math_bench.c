@@ -0,0 +1,152 @@
+// Compares the SIMD batch kernels (see src/vecmath.h) with their scalar references, on Linux
+// Usage:
+//   tools/math_bench > math.csv
+// Prints one line per kernel and count: best time per element of both, the speedup and how far the SIMD results are
+// from the scalar ones (largest difference in ulps, 0 when bit-identical), fails beyond 4 ulps
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "timing.h"
+#include "vecmath.h"
+
+#define BENCH_MIN_RUNS 3
+#define BENCH_MIN_TIME_NS (100 * TIME_NS_PER_MS) // Per kernel, count and implementation
+
+typedef struct BenchData
+{
+    int count;
+    float4x4 matrix;
+    float3* vectors;
+    float4x4* matrices;
+} BenchData;
+
+typedef struct Kernel
+{
+    const char* name;
+    int outFloatsPerElement;
+    void (*run)(const BenchData* data, float* out, bool simd);
+} Kernel;
+
+static void kernel_TransformPoints(const BenchData* data, float* out, bool simd)
+{
+    (simd ? vecmath_TransformPoints : vecmath_TransformPointsScalar)(&data->matrix, data->vectors, (float3*)out, data->count);
+}
+
+static void kernel_NormalizeVectors(const BenchData* data, float* out, bool simd)
+{
+    (simd ? vecmath_NormalizeVectors : vecmath_NormalizeVectorsScalar)(data->vectors, (float3*)out, data->count);
+}
+
+static void kernel_MulMatrices(const BenchData* data, float* out, bool simd)
+{
+    (simd ? vecmath_MulMatrices : vecmath_MulMatricesScalar)(&data->matrix, data->matrices, data->count, out, sizeof(float4x4));
+}
+
+static const Kernel g_kernels[] =
+{
+    { "transform_points",  3,  kernel_TransformPoints },
+    { "normalize_vectors", 3,  kernel_NormalizeVectors },
+    { "mul_matrices",      16, kernel_MulMatrices },
+};
+
+static uint32_t g_randomState = 0x12345678u;
+
+static float random_Float(float min, float max)
+{
+    g_randomState = g_randomState * 1664525u + 1013904223u;
+    return min + (max - min) * (g_randomState >> 8) * (1.f / 16777216.f);
+}
+
+// Distance between two floats of the same sign in representable values
+static uint32_t float_UlpDistance(float a, float b)
+{
+    int32_t ia, ib;
+    memcpy(&ia, &a, sizeof(ia));
+    memcpy(&ib, &b, sizeof(ib));
+    if (ia < 0)
+        ia = INT32_MIN - ia;
+    if (ib < 0)
+        ib = INT32_MIN - ib;
+    return ia > ib ? (uint32_t)ia - (uint32_t)ib : (uint32_t)ib - (uint32_t)ia;
+}
+
+static int64_t bench_Best(const Kernel* kernel, const BenchData* data, float* out, bool simd)
+{
+    int64_t bestTime = INT64_MAX;
+    int64_t benchStart = time_Now();
+    for (int run = 0; run < BENCH_MIN_RUNS || time_Now() - benchStart < BENCH_MIN_TIME_NS; ++run)
+    {
+        int64_t start = time_Now();
+        kernel->run(data, out, simd);
+        int64_t duration = time_Now() - start;
+        if (duration < bestTime)
+            bestTime = duration;
+    }
+    return bestTime;
+}
+
+int main(int argc, char** argv)
+{
+#if VECMATH_NEON
+    const char* isa = "neon";
+#elif VECMATH_SSE
+    const char* isa = "sse";
+#else
+    const char* isa = "scalar";
+#endif
+    static const int counts[] = { 1000, 1003, 100000 }; // 1003: the scalar tail after the 4-wide loops is checked too
+    bool failed = false;
+
+    printf("kernel,isa,count,scalar_ns,simd_ns,speedup,max_ulps\n");
+    for (int c = 0; c < (int)(sizeof(counts) / sizeof(counts[0])); ++c)
+    {
+        BenchData data = { .count = counts[c] };
+        float4x4 rotation = mat4_rotateY(0.7f);
+        float4x4 local = mat4_translateScale((float3){{ 0.5f, -1.f, 2.f }}, 1.5f);
+        data.matrix = mat4_mul(&rotation, &local);
+        data.vectors = malloc(data.count * sizeof(float3));
+        data.matrices = malloc(data.count * sizeof(float4x4));
+        for (int i = 0; i < data.count; ++i)
+        {
+            data.vectors[i] = (float3){{ random_Float(-10.f, 10.f), random_Float(-10.f, 10.f), random_Float(-10.f, 10.f) }};
+            for (int e = 0; e < 16; ++e)
+                data.matrices[i].e[e] = random_Float(-2.f, 2.f);
+        }
+
+        for (int k = 0; k < (int)(sizeof(g_kernels) / sizeof(g_kernels[0])); ++k)
+        {
+            const Kernel* kernel = &g_kernels[k];
+            int outCount = data.count * kernel->outFloatsPerElement;
+            float* scalarOut = malloc(outCount * sizeof(float));
+            float* simdOut = malloc(outCount * sizeof(float));
+
+            int64_t scalarTime = bench_Best(kernel, &data, scalarOut, false);
+            int64_t simdTime = bench_Best(kernel, &data, simdOut, true);
+
+            uint32_t maxUlps = 0;
+            for (int i = 0; i < outCount; ++i)
+            {
+                uint32_t ulps = float_UlpDistance(scalarOut[i], simdOut[i]);
+                if (ulps > maxUlps)
+                    maxUlps = ulps;
+            }
+            failed |= maxUlps > 4;
+
+            printf("%s,%s,%d,%.3f,%.3f,%.2f,%u\n", kernel->name, isa, data.count, (double)scalarTime / data.count,
+                (double)simdTime / data.count, (double)scalarTime / simdTime, maxUlps);
+            free(scalarOut);
+            free(simdOut);
+        }
+
+        free(data.vectors);
+        free(data.matrices);
+    }
+
+    if (failed)
+        fprintf(stderr, "SIMD results differ from the scalar references by more than 4 ulps\n");
+    return failed ? 1 : 0;
+}
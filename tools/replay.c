@@ -0,0 +1,364 @@
+// Replays an event recording (see src/event_recording.h) on Linux with the null GL backend, for reproducible performance runs
+// Usage:
+//   Build the app with RECORD_EVENTS 1, then
+//   adb shell "run-as com.example.app cat files/events.rec" > events.rec
+//   tools/replay events.rec [--realtime] [--threaded] [--refresh-rate hz] [--telemetry telemetry.bin] [--gestures] [--touch-horizon ms] [--touch-max-prediction ms] > frames.csv
+// Prints one line of timings per frame, the telemetry summary goes to stderr
+// Frames go through the frame pipeline (see src/frame_pipeline.h) and are drawn against src/gl_null.h, with --threaded
+// on a render thread like THREADED_RENDERING does in the app
+// --refresh-rate is the display's of the recording (60 Hz by default), it sets the jank threshold and touch present time
+// With --gestures, logs the gestures recognized each frame
+// With --touch-horizon, also logs the error of predicting touches that far ahead, next to the error of not predicting at all
+// Always logs how far the resampled touches the game read were from the raw ones, fails when they were resampled before
+// their samples (the replayed clock does not match the event times)
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "common.h"
+#include "app_event.h"
+#include "event_recording.h"
+#include "frame_pipeline.h"
+#include "gl_null.h"
+#include "gl_state.h"
+#include "render_queue.h"
+#include "simulation.h"
+#include "telemetry.h"
+#include "timing.h"
+
+#define TOUCH_EVAL_QUEUE_SIZE 256
+
+// Resamplers fed with the motion events `horizonNs` late, predicting the events as they arrive
+typedef struct TouchEval
+{
+    int64_t horizonNs;
+    TouchResampler predicted;
+    TouchResampler held; // Prediction disabled, the baseline
+    TouchResamplerError predictedError;
+    TouchResamplerError heldError;
+
+    MotionEvent* queue; // Not fed yet, oldest first
+    int head;
+    int count;
+} TouchEval;
+
+// See FramePacket in src/activity.c
+typedef struct ReplayPacket
+{
+    GameFrame game;
+    uint64_t frameIndex;
+} ReplayPacket;
+
+typedef struct Replay
+{
+    bool realtime;
+    int64_t wallStart;
+
+    // The frame clock reads the recorded clock, the simulation steps exactly as during the recording
+    // Absolute like motion event times, gestures and resampled touches compare the two
+    Simulation sim;
+    int64_t clockTime;
+
+    FramePipeline* framePipeline;
+    ReplayPacket packets[FRAME_PIPELINE_PACKET_COUNT];
+    int stepCounts[TIME_FRAME_HISTORY]; // Of the frames not reported yet, by frame index
+
+    // Render side, see app_BindSurfaceGL()
+    bool gpuLoaded;
+    RenderQueue renderQueue;
+
+    bool logGestures;
+    TouchEval* touchEval; // NULL without --touch-horizon
+    TouchResamplerFrameError resampleError;
+} Replay;
+
+static int64_t replay_Now(void* userData)
+{
+    Replay* replay = userData;
+    return replay->clockTime;
+}
+
+static void replay_WaitUntil(Replay* replay, int64_t time)
+{
+    if (!replay->realtime)
+        return;
+
+    int64_t delay = replay->wallStart + time - time_Now();
+    if (delay > 0)
+        nanosleep(&(struct timespec){ delay / TIME_NS_PER_SECOND, delay % TIME_NS_PER_SECOND }, NULL);
+}
+
+static void touchEval_FeedHead(TouchEval* eval)
+{
+    const MotionEvent* motionEvent = &eval->queue[eval->head];
+    touchResampler_AddMotion(&eval->predicted, motionEvent);
+    touchResampler_AddMotion(&eval->held, motionEvent);
+    eval->head = (eval->head + 1) % TOUCH_EVAL_QUEUE_SIZE;
+    eval->count--;
+}
+
+static void touchEval_AddMotion(TouchEval* eval, const MotionEvent* motionEvent)
+{
+    // Every sample of the event is predicted at least horizonNs ahead
+    int64_t oldestTime = motionEvent->historySize > 0 ? motionEvent->historyTime[0] : motionEvent->eventTime;
+    while (eval->count > 0 && eval->queue[eval->head].eventTime <= oldestTime - eval->horizonNs)
+        touchEval_FeedHead(eval);
+
+    touchResampler_AddError(&eval->predicted, motionEvent, &eval->predictedError);
+    touchResampler_AddError(&eval->held, motionEvent, &eval->heldError);
+
+    if (eval->count == TOUCH_EVAL_QUEUE_SIZE)
+        touchEval_FeedHead(eval);
+    eval->queue[(eval->head + eval->count) % TOUCH_EVAL_QUEUE_SIZE] = *motionEvent;
+    eval->count++;
+}
+
+static void replay_LoadGPUData(void* userData)
+{
+    Replay* replay = userData;
+    if (replay->gpuLoaded)
+        return;
+
+    glState_Reset();
+    renderQueue_Init(&replay->renderQueue);
+    game_LoadGPUData(replay->sim.game);
+    replay->gpuLoaded = true;
+}
+
+static void replay_UnloadGPUData(void* userData)
+{
+    Replay* replay = userData;
+    if (!replay->gpuLoaded)
+        return;
+
+    game_UnloadGPUData(replay->sim.game);
+    renderQueue_Free(&replay->renderQueue);
+    replay->gpuLoaded = false;
+}
+
+static void replay_RenderFrame(void* packetPtr, void* userData)
+{
+    Replay* replay = userData;
+    const ReplayPacket* packet = packetPtr;
+
+    if (replay->gpuLoaded)
+    {
+        game_Draw(replay->sim.game, &packet->game, &replay->renderQueue);
+        renderQueue_Submit(&replay->renderQueue);
+    }
+    time_MarkPhase(packet->frameIndex, FramePhase_Swap);
+}
+
+// The simulation side of appThread_HandleEvents() and its GL calls, sound and ImGui are not replayed
+static bool replay_HandleEvent(Replay* replay, const Event* event)
+{
+    switch (event->type)
+    {
+        case EventType_SurfaceCreated:
+            if (replay->sim.game)
+                framePipeline_Run(replay->framePipeline, replay_LoadGPUData, replay);
+            break;
+
+        case EventType_Destroy:
+            framePipeline_Run(replay->framePipeline, replay_UnloadGPUData, replay);
+            break;
+
+        case EventType_DispatchMotionEvent:
+            if (replay->touchEval)
+                touchEval_AddMotion(replay->touchEval, &event->dispatchTouchEvent.motionEvent);
+            break;
+
+        default:
+            break;
+    }
+
+    simulation_HandleEvent(&replay->sim, event);
+    return event->type != EventType_Destroy;
+}
+
+static void replay_LogGestures(const GestureFrame* frame, uint64_t frameIndex)
+{
+    static const char* phaseStr[] = { "Began", "Changed", "Ended" };
+    for (int i = 0; i < frame->count; ++i)
+    {
+        const Gesture* g = &frame->gestures[i];
+        ALOGV("frame %llu: %s %s%s at (%.1f, %.1f) delta (%.1f, %.1f) scale %.3f velocity (%.0f, %.0f)",
+            (unsigned long long)frameIndex, gestureTypeStr[g->type], phaseStr[g->phase], g->canceled ? " canceled" : "",
+            g->x, g->y, g->dx, g->dy, g->scale, g->vx, g->vy);
+    }
+    if (frame->droppedCount)
+        ALOGE("frame %llu: %d gestures dropped", (unsigned long long)frameIndex, frame->droppedCount);
+}
+
+// Once the frame is rendered
+static void replay_ReportFrame(Replay* replay, uint64_t frameIndex)
+{
+    FrameTimestamps timestamps;
+    if (!time_GetFrame(frameIndex, &timestamps) || timestamps.phases[FramePhase_Swap] == 0)
+        return;
+
+    telemetry_Record(replay->sim.telemetry, &timestamps);
+
+    const int64_t* phases = timestamps.phases;
+    printf("%llu,%d,%.1f,%.1f,%.1f\n", (unsigned long long)frameIndex, replay->stepCounts[frameIndex % TIME_FRAME_HISTORY],
+        (phases[FramePhase_Poll] - phases[FramePhase_Begin]) / 1000.0,
+        (phases[FramePhase_Update] - phases[FramePhase_Poll]) / 1000.0,
+        (phases[FramePhase_Swap] - phases[FramePhase_Update]) / 1000.0);
+}
+
+static void replay_Frame(Replay* replay, uint64_t frameIndex)
+{
+    ReplayPacket* packet = framePipeline_AcquirePacket(replay->framePipeline);
+
+    // The frame that last used this packet is fully rendered
+    if (frameIndex > FRAME_PIPELINE_PACKET_COUNT)
+        replay_ReportFrame(replay, frameIndex - FRAME_PIPELINE_PACKET_COUNT);
+
+    simulation_Update(&replay->sim, &packet->game);
+    touchResampler_AddFrameError(&replay->sim.touchResampler, replay->sim.frameClock.lastTime + replay->sim.presentOffsetNs,
+        &replay->sim.touches, &replay->sim.gameInputs.touches, &replay->resampleError);
+    if (replay->logGestures)
+        replay_LogGestures(&replay->sim.gameInputs.gestures, frameIndex);
+    replay->stepCounts[frameIndex % TIME_FRAME_HISTORY] = replay->sim.gameInputs.stepCount;
+    time_MarkPhase(frameIndex, FramePhase_Update);
+    time_MarkPhase(frameIndex, FramePhase_ImGui); // No ImGui
+
+    packet->frameIndex = frameIndex;
+    framePipeline_Submit(replay->framePipeline);
+
+    // Events recorded before the next frame entry belong to the next frame
+    simulation_BeginFrame(&replay->sim);
+}
+
+int main(int argc, char** argv)
+{
+    const char* filename = NULL;
+    const char* telemetryFilename = NULL;
+    double touchHorizonMs = -1.0;
+    double touchMaxPredictionMs = 0.0;
+    double refreshRate = 60.0;
+    bool threaded = false;
+    Replay replay = { 0 };
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--realtime") == 0)
+            replay.realtime = true;
+        else if (strcmp(argv[i], "--threaded") == 0)
+            threaded = true;
+        else if (strcmp(argv[i], "--refresh-rate") == 0 && i + 1 < argc)
+            refreshRate = atof(argv[++i]);
+        else if (strcmp(argv[i], "--telemetry") == 0 && i + 1 < argc)
+            telemetryFilename = argv[++i];
+        else if (strcmp(argv[i], "--gestures") == 0)
+            replay.logGestures = true;
+        else if (strcmp(argv[i], "--touch-horizon") == 0 && i + 1 < argc)
+            touchHorizonMs = atof(argv[++i]);
+        else if (strcmp(argv[i], "--touch-max-prediction") == 0 && i + 1 < argc)
+            touchMaxPredictionMs = atof(argv[++i]);
+        else
+            filename = argv[i];
+    }
+
+    if (!filename)
+    {
+        fprintf(stderr, "usage: %s events.rec [--realtime] [--threaded] [--refresh-rate hz] [--telemetry telemetry.bin] [--gestures] [--touch-horizon ms] [--touch-max-prediction ms]\n", argv[0]);
+        return 1;
+    }
+
+    if (touchHorizonMs >= 0.0)
+    {
+        replay.touchEval = calloc(1, sizeof(TouchEval));
+        replay.touchEval->horizonNs = (int64_t)(touchHorizonMs * TIME_NS_PER_MS);
+        replay.touchEval->queue = calloc(TOUCH_EVAL_QUEUE_SIZE, sizeof(MotionEvent));
+        touchResampler_Init(&replay.touchEval->predicted, &(TouchResamplerDesc){ .maxPredictionNs = (int64_t)(touchMaxPredictionMs * TIME_NS_PER_MS) });
+        touchResampler_Init(&replay.touchEval->held, &(TouchResamplerDesc){ .maxPredictionNs = -1 });
+    }
+
+    EventPlayer* player = eventPlayer_Open(filename);
+    if (!player || !glNull_Load())
+        return 1;
+
+    // Same settings as the app, see TOUCH_PRESENT_OFFSET_FRAMES
+    int64_t framePeriodNs = (int64_t)(TIME_NS_PER_SECOND / (refreshRate > 0.0 ? refreshRate : 60.0));
+    simulation_Init(&replay.sim, &(SimulationDesc){
+        .now = replay_Now,
+        .nowUserData = &replay,
+        .framePeriodNs = framePeriodNs,
+        .presentOffsetNs = (threaded ? 2 : 1) * framePeriodNs,
+        .touchLatencyNs = 5 * TIME_NS_PER_MS,
+    });
+
+    FramePipelineDesc pipelineDesc = {
+        .threaded = threaded,
+        .render = replay_RenderFrame,
+        .userData = &replay,
+    };
+    for (int i = 0; i < FRAME_PIPELINE_PACKET_COUNT; ++i)
+        pipelineDesc.packets[i] = &replay.packets[i];
+    replay.framePipeline = framePipeline_Create(&pipelineDesc);
+    replay.wallStart = time_Now();
+
+    printf("frame,steps,poll_us,update_us,render_us\n");
+
+    int eventCount = 0;
+    bool running = true;
+    uint64_t frameIndex = time_BeginFrame();
+
+    EventRecordingEntry entry;
+    const void* data;
+    while (running && eventPlayer_Next(player, &entry, &data))
+    {
+        replay_WaitUntil(&replay, entry.time); // Relative to the recording start, like wallStart
+
+        if (entry.kind == EventRecordingKind_Event)
+        {
+            Event event;
+            event_Decode(&event, data);
+            running = replay_HandleEvent(&replay, &event);
+            eventCount++;
+        }
+        else if (entry.kind == EventRecordingKind_Frame)
+        {
+            time_MarkPhase(frameIndex, FramePhase_Poll);
+            replay.clockTime = eventPlayer_GetTime(player, &entry);
+            replay_Frame(&replay, frameIndex);
+            frameIndex = time_BeginFrame();
+        }
+    }
+
+    if (replay.sim.game)
+    {
+        ALOGE("Recording ended without a Destroy event");
+        framePipeline_Run(replay.framePipeline, replay_UnloadGPUData, &replay);
+    }
+
+    // Renders the last packets
+    framePipeline_Destroy(replay.framePipeline);
+    for (uint64_t i = frameIndex > FRAME_PIPELINE_PACKET_COUNT ? frameIndex - FRAME_PIPELINE_PACKET_COUNT : 0; i < frameIndex; ++i)
+        replay_ReportFrame(&replay, i);
+    for (int i = 0; i < FRAME_PIPELINE_PACKET_COUNT; ++i)
+        game_FreeFrame(&replay.packets[i].game);
+
+    ALOGV("Replayed %d events in %.3f s", eventCount, time_ToSeconds(time_Now() - replay.wallStart));
+    telemetry_Log(replay.sim.telemetry);
+    if (telemetryFilename)
+        telemetry_Save(replay.sim.telemetry, telemetryFilename);
+
+    touchResampler_LogFrameError(&replay.resampleError, "Resampled touches from the raw ones");
+
+    if (replay.touchEval)
+    {
+        ALOGV("Touch prediction %.1f ms ahead:", touchHorizonMs);
+        touchResampler_LogError(&replay.touchEval->predictedError, "  predicted");
+        touchResampler_LogError(&replay.touchEval->heldError, "  last sample");
+        free(replay.touchEval->queue);
+        free(replay.touchEval);
+    }
+
+    simulation_Terminate(&replay.sim);
+    eventPlayer_Close(player);
+    return replay.resampleError.staleCount ? 1 : 0;
+}
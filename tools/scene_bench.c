@@ -0,0 +1,222 @@
+// Measures the CPU cost of drawing 1 to 100k game objects, one draw per object against one instanced draw, on Linux
+// Usage:
+//   tools/scene_bench [--max-objects n] > scene.csv
+// Runs game_Update(), game_Draw() and the render queue submit against the null GL backend (see src/gl_null.h): submit
+// times are the cost of our own code and of the GL calls it makes, the driver work those calls trigger on a device
+// comes on top. Fails when the state changes counted by the null backend are not the expected ones
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "common.h"
+#include "gl_null.h"
+#include "gl_state.h"
+#include "job_system.h"
+#include "render_queue.h"
+#include "timing.h"
+
+#include "game.h"
+
+#define BENCH_MIN_FRAMES 10
+#define BENCH_MIN_TIME_NS (200 * TIME_NS_PER_MS) // Per object count and path
+
+typedef struct BenchResult
+{
+    int frameCount;
+    int64_t updateTime; // Total over frameCount
+    int64_t submitTime;
+    GLNullStats stats;
+} BenchResult;
+
+static BenchResult bench_Run(Game* game, GameInputs* inputs, GameFrame* frame, RenderQueue* queue)
+{
+    BenchResult result = { 0 };
+
+    // Warm up, grows the frame, the instance buffer and the queue
+    game_Update(game, inputs, frame);
+    game_Draw(game, frame, queue);
+    renderQueue_Submit(queue);
+    glNull_ResetStats();
+
+    int64_t benchStart = time_Now();
+    while (result.frameCount < BENCH_MIN_FRAMES || time_Now() - benchStart < BENCH_MIN_TIME_NS)
+    {
+        int64_t start = time_Now();
+        game_Update(game, inputs, frame);
+        int64_t updated = time_Now();
+        game_Draw(game, frame, queue);
+        renderQueue_Submit(queue);
+        int64_t submitted = time_Now();
+
+        result.updateTime += updated - start;
+        result.submitTime += submitted - updated;
+        result.frameCount++;
+    }
+    result.stats = glNull_GetStats();
+    return result;
+}
+
+// Whatever the object count, the program, the texture and the VAO stay bound from the warm up frame: with no ImGui pass
+// in between, the GL state shadow skips every bind
+static bool bench_CheckStateChanges(const char* path, int objectCount, const BenchResult* result)
+{
+    uint64_t frames = result->frameCount;
+    const GLNullStats* stats = &result->stats;
+    uint64_t expectedDraws = strcmp(path, "instanced") == 0 ? 1 : objectCount;
+    if (stats->programBinds == 0 && stats->textureBinds == 0 && stats->vertexArrayBinds == 0
+        && stats->drawCount == expectedDraws * frames)
+        return true;
+
+    fprintf(stderr, "%d objects, %s: %.1f program, %.1f texture and %.1f VAO binds and %.1f draws per frame, expected 0, 0, 0 and %d\n",
+        objectCount, path, stats->programBinds / (double)frames, stats->textureBinds / (double)frames,
+        stats->vertexArrayBinds / (double)frames, stats->drawCount / (double)frames, (int)expectedDraws);
+    return false;
+}
+
+typedef struct SortCheck
+{
+    int packetCount;
+    uint64_t drawsBeforeCallback;
+    int callbackCount;
+} SortCheck;
+
+static void sortCheck_Callback(void* userData, const void* data)
+{
+    SortCheck* check = userData;
+    check->drawsBeforeCallback = glNull_GetStats().drawCount;
+    check->callbackCount++;
+}
+
+// Draws of 4 programs and 8 textures appended in random order, plus a UI callback appended first: once sorted each
+// program is bound once, each of its textures once, and the callback runs after every draw
+static bool bench_CheckSorting(RenderQueue* queue)
+{
+    enum { PROGRAM_COUNT = 4, TEXTURE_COUNT = 8 };
+    SortCheck check = { .packetCount = 10000 };
+    bool used[PROGRAM_COUNT][TEXTURE_COUNT] = { { false } };
+    int usedCount = 0;
+
+    RenderPacket* callbackPacket = renderQueue_Append(queue, renderKey_Make(RenderPass_UI, 0, 0, 0.f));
+    callbackPacket->callback = sortCheck_Callback;
+    callbackPacket->userData = &check;
+
+    uint32_t random = 0x9E3779B9u;
+    for (int i = 0; i < check.packetCount; ++i)
+    {
+        random = random * 1664525u + 1013904223u;
+        int program = (random >> 8) % PROGRAM_COUNT;
+        int texture = (random >> 16) % TEXTURE_COUNT;
+        float depth = (random >> 24) / 16.f;
+        if (!used[program][texture])
+        {
+            used[program][texture] = true;
+            usedCount++;
+        }
+
+        // Names that do not follow the key order, only the grouping matters
+        RenderPacket* packet = renderQueue_Append(queue, renderKey_Make(RenderPass_Opaque, 100 - program, 200 + texture * 3, depth));
+        packet->program = 100 - program;
+        packet->texture = 200 + texture * 3;
+        packet->vao = 1;
+        packet->mode = GL_TRIANGLES;
+        packet->count = 3;
+    }
+
+    int64_t start = time_Now();
+    renderQueue_Sort(queue);
+    int64_t sortTime = time_Now() - start;
+    bool sorted = true;
+    for (int i = 1; i < queue->count; ++i)
+        sorted &= queue->items[i - 1].key <= queue->items[i].key;
+
+    glNull_ResetStats();
+    glState_ResetStats();
+    renderQueue_Submit(queue);
+    GLNullStats stats = glNull_GetStats();
+    GLStateStats stateStats = glState_GetStats();
+    fprintf(stderr, "render queue: %d packets sorted in %.1f us, %d state changes issued, %d skipped\n", queue->stats.packetCount,
+        sortTime / 1000.0, (int)stateStats.issuedCount, (int)stateStats.skippedCount);
+
+    if (sorted && stats.programBinds == PROGRAM_COUNT && stats.textureBinds == (uint64_t)usedCount
+        && stats.vertexArrayBinds == 1 && stats.drawCount == (uint64_t)check.packetCount
+        && check.callbackCount == 1 && check.drawsBeforeCallback == (uint64_t)check.packetCount)
+        return true;
+
+    fprintf(stderr, "render queue: sorted %d, %d program binds (expected %d), %d texture binds (expected %d), %d VAO binds, "
+        "%d draws, callback after %d draws\n", sorted, (int)stats.programBinds, PROGRAM_COUNT, (int)stats.textureBinds, usedCount,
+        (int)stats.vertexArrayBinds, (int)stats.drawCount, (int)check.drawsBeforeCallback);
+    return false;
+}
+
+static void bench_Print(const char* path, int objectCount, const BenchResult* result)
+{
+    double frames = result->frameCount;
+    printf("%d,%s,%.2f,%.2f,%.1f,%.1f,%.1f\n", objectCount, path,
+        result->updateTime / frames / 1000.0, result->submitTime / frames / 1000.0,
+        result->stats.callCount / frames, result->stats.drawCount / frames, result->stats.uploadBytes / frames / 1024.0);
+}
+
+int main(int argc, char** argv)
+{
+    int maxObjects = 100000;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--max-objects") == 0 && i + 1 < argc)
+            maxObjects = atoi(argv[++i]);
+        else
+        {
+            fprintf(stderr, "usage: %s [--max-objects n]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (!glNull_Load())
+        return 1;
+    glState_Reset();
+
+    JobSystem* jobSystem = jobSystem_Create(0);
+    Game* game = game_Init(jobSystem);
+    game_LoadGPUData(game);
+
+    GameInputs inputs = {
+        .displayWidth = 1920,
+        .displayHeight = 1080,
+        .deltaTime = 1.f / 60.f,
+        .stepCount = 1,
+        .alpha = 1.f,
+        .frameDeltaTime = 1.f / 60.f,
+    };
+    GameFrame frame = { 0 };
+    RenderQueue queue;
+    renderQueue_Init(&queue);
+    bool passed = bench_CheckSorting(&queue);
+
+    printf("objects,path,update_us,submit_us,gl_calls,draws,upload_kib\n");
+    for (int objectCount = 1; objectCount <= maxObjects; objectCount *= 10)
+    {
+        game_SetObjectCount(game, objectCount);
+
+        game_SetInstancing(game, false);
+        BenchResult perObject = bench_Run(game, &inputs, &frame, &queue);
+        game_SetInstancing(game, true);
+        BenchResult instanced = bench_Run(game, &inputs, &frame, &queue);
+        passed &= bench_CheckStateChanges("per_object", objectCount, &perObject);
+        passed &= bench_CheckStateChanges("instanced", objectCount, &instanced);
+
+        bench_Print("per_object", objectCount, &perObject);
+        bench_Print("instanced", objectCount, &instanced);
+        fflush(stdout);
+
+        fprintf(stderr, "%d objects: submit %.1f us -> %.1f us, %.0f -> %.0f GL calls per frame\n", objectCount,
+            perObject.submitTime / (double)perObject.frameCount / 1000.0, instanced.submitTime / (double)instanced.frameCount / 1000.0,
+            perObject.stats.callCount / (double)perObject.frameCount, instanced.stats.callCount / (double)instanced.frameCount);
+    }
+
+    renderQueue_Free(&queue);
+    game_FreeFrame(&frame);
+    game_UnloadGPUData(game);
+    game_Terminate(game);
+    jobSystem_Destroy(jobSystem);
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,75 @@
+// Reads a telemetry log saved by the app (see src/telemetry.h) and prints frame-time percentiles
+// Usage:
+//   adb shell "run-as com.example.app cat files/telemetry.bin" > telemetry.bin
+//   tools/telemetry_report telemetry.bin [--csv]
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "telemetry.h"
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s telemetry.bin [--csv]\n", argv[0]);
+        return 1;
+    }
+
+    FILE* file = fopen(argv[1], "rb");
+    if (!file)
+    {
+        fprintf(stderr, "cannot open '%s'\n", argv[1]);
+        return 1;
+    }
+
+    TelemetryFileHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != TELEMETRY_FILE_MAGIC)
+    {
+        fprintf(stderr, "'%s' is not a telemetry log\n", argv[1]);
+        return 1;
+    }
+
+    if (header.version != TELEMETRY_FILE_VERSION || header.recordSize != sizeof(TelemetryRecord))
+    {
+        fprintf(stderr, "unsupported telemetry log version %u (record size %u)\n", header.version, header.recordSize);
+        return 1;
+    }
+
+    TelemetryRecord* records = malloc((header.recordCount + 1) * sizeof(TelemetryRecord));
+    if (fread(records, sizeof(TelemetryRecord), header.recordCount, file) != header.recordCount)
+    {
+        fprintf(stderr, "truncated telemetry log\n");
+        return 1;
+    }
+    fclose(file);
+
+    if (argc > 2 && strcmp(argv[2], "--csv") == 0)
+    {
+        printf("frame_index,frame_us,poll_us,update_us,imgui_us,swap_us\n");
+        for (uint32_t i = 0; i < header.recordCount; ++i)
+        {
+            const TelemetryRecord* r = &records[i];
+            printf("%u,%u,%u,%u,%u,%u\n", r->frameIndex, r->frameUs, r->pollUs, r->updateUs, r->imguiUs, r->swapUs);
+        }
+        return 0;
+    }
+
+    TelemetryStats stats;
+    telemetry_ComputeStats(records, header.recordCount, header.targetFrameUs, &stats);
+
+    printf("%u frames, target %.2f ms\n", stats.frameCount, header.targetFrameUs / 1000.0);
+    printf("janks (> %.1fx target): %u in log, %u since start\n", TELEMETRY_JANK_FACTOR, stats.jankCount, header.totalJankCount);
+
+    static const char* metricNames[] = { "frame", "poll", "update", "imgui", "swap" };
+    printf("%-8s %9s %9s %9s %9s\n", "ms", "p50", "p95", "p99", "max");
+    for (int metric = 0; metric < TelemetryMetric_Count; ++metric)
+    {
+        const TelemetryPercentiles* p = &stats.metrics[metric];
+        printf("%-8s %9.2f %9.2f %9.2f %9.2f\n", metricNames[metric], p->p50 / 1000.0, p->p95 / 1000.0, p->p99 / 1000.0, p->max / 1000.0);
+    }
+
+    free(records);
+    return 0;
+}